@@ -5,6 +5,7 @@
 #include <mutex>
 
 #include "iomgr/io_buffer.h"
+#include "iomgr/io_buffer_pool.h"
 #include "iomgr/tcp/inet_address.h"
 #include "iomgr/tcp/tcp_client.h"
 
@@ -31,7 +32,7 @@ class HelloWorldClient {
         cv_.wait(lock);
       }
     }
-    RefPtr<IOBufferWithSize> buf = MakeRefCounted<IOBufferWithSize>(128);
+    RefPtr<IOBufferWithSize> buf = IOBufferPool::Get()->Alloc(128);
     StatusOr<int> status_or =
         client_->Read(buf.get(), buf->size(),
                       std::bind(&HelloWorldClient::OnReadCompleted, this,
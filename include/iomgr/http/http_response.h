@@ -31,8 +31,11 @@ class IOMGR_EXPORT HTTPResponse {
   void AddHeader(const Slice& key, const Slice& value);
 
   const std::string& body() const { return body_; }
+  std::string* mutable_body() { return &body_; }
   void AppendBody(const Slice& body) { body_.append(body.data(), body.size()); }
 
+  // The status line and headers, up to and including the empty line
+  std::string HeadersToString() const;
   std::string ToString() const;
 
  private:
@@ -3,6 +3,7 @@
 
 #include <map>
 #include <memory>
+#include <vector>
 
 #include "iomgr/export.h"
 #include "iomgr/status.h"
@@ -39,7 +40,7 @@ class IOMGR_EXPORT HTTPServer {
   bool HandleAcceptResult(Status status);
 
   std::unique_ptr<TCPServer> server_;
-  std::unique_ptr<TCPClient> accepted_socket_;
+  std::vector<std::unique_ptr<TCPClient>> accepted_sockets_;
   HTTPServer::Delegate* const delegate_;
 };
 
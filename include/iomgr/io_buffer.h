@@ -1,11 +1,15 @@
 #ifndef LIBIOMGR_INCLUDE_IO_BUFFER_H_
 #define LIBIOMGR_INCLUDE_IO_BUFFER_H_
 
+#include <stddef.h>
+#include <stdint.h>
+
 #include <memory>
 #include <string>
 
 #include "iomgr/export.h"
 #include "iomgr/ref_counted.h"
+#include "iomgr/status.h"
 
 namespace iomgr {
 
@@ -98,6 +102,40 @@ class IOMGR_EXPORT WrappedIOBuffer : public IOBuffer {
   ~WrappedIOBuffer() override;
 };
 
+// MappedFileIOBuffer maps a range of a file read-only, so that a blob on disk
+// can be written to sockets without being copied onto the heap. The pages
+// come from the page cache and are shared by every buffer mapping the same
+// file, and one buffer may be written to any number of connections at once.
+// Its data must not be written to.
+class IOMGR_EXPORT MappedFileIOBuffer : public IOBufferWithSize {
+ public:
+  enum Advice {
+    kNormal,
+    kSequential,
+    kRandom,
+    kWillNeed,
+    kDontNeed,
+  };
+
+  // Maps |length| bytes of |path| from |offset|, or up to the end of the file
+  // if |length| is zero. |offset| need not be aligned to a page.
+  static Status Map(const std::string& path, uint64_t offset, size_t length,
+                    RefPtr<MappedFileIOBuffer>* buffer);
+
+  // Passes |advice| on the whole mapping to madvise(2), e.g. kSequential
+  // before streaming it out, or kWillNeed to start reading it in.
+  Status Advise(Advice advice);
+
+ private:
+  MappedFileIOBuffer(void* mapping, size_t mapping_size, char* data,
+                     size_t size);
+  ~MappedFileIOBuffer() override;
+
+  // Starts at the page holding the first byte of data
+  void* mapping_;
+  size_t mapping_size_;
+};
+
 }  // namespace iomgr
 
 #endif  // LIBIOMGR_INCLUDE_IO_BUFFER_H_
\ No newline at end of file
@@ -0,0 +1,81 @@
+#ifndef LIBIOMGR_INCLUDE_IO_BUFFER_CHAIN_H_
+#define LIBIOMGR_INCLUDE_IO_BUFFER_CHAIN_H_
+
+#include <stddef.h>
+#include <sys/uio.h>
+
+#include <deque>
+#include <string>
+
+#include "iomgr/export.h"
+#include "iomgr/io_buffer.h"
+#include "iomgr/ref_slice.h"
+
+namespace iomgr {
+
+// IOBufferChain is a sequence of RefSlices, each one referring into a
+// refcounted IOBuffer. Appending, prepending, splitting and consuming only
+// move references around, so a message can be assembled from (or read into)
+// several buffers and handed to readv()/writev() without first copying it
+// into one contiguous buffer.
+//
+// An IOBufferChain is not thread-safe.
+class IOMGR_EXPORT IOBufferChain {
+ public:
+  IOBufferChain();
+  ~IOBufferChain();
+
+  IOBufferChain(IOBufferChain&& other);
+  IOBufferChain& operator=(IOBufferChain&& other);
+
+  IOBufferChain(const IOBufferChain&) = delete;
+  IOBufferChain& operator=(const IOBufferChain&) = delete;
+
+  // Adds |slice| to the end (Append) or to the front (Prepend) of the chain.
+  // Empty slices are ignored.
+  void Append(RefSlice slice);
+  void Prepend(RefSlice slice);
+  void Append(RefPtr<IOBuffer> buffer, size_t offset, size_t length) {
+    Append(RefSlice(std::move(buffer), offset, length));
+  }
+  void Prepend(RefPtr<IOBuffer> buffer, size_t offset, size_t length) {
+    Prepend(RefSlice(std::move(buffer), offset, length));
+  }
+
+  // Moves all segments of |other| to the end of this chain, leaving |other|
+  // empty.
+  void Append(IOBufferChain* other);
+
+  // Drops the first |bytes| bytes of the chain.
+  void Consume(size_t bytes);
+
+  // Moves the first |bytes| bytes of the chain to the end of |head|. A
+  // segment straddling the split point is shared by both chains.
+  void Split(size_t bytes, IOBufferChain* head);
+
+  void Clear();
+
+  // Total number of bytes in the chain
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  size_t num_segments() const { return segments_.size(); }
+  // The |i|th segment. It may be copied to keep its bytes alive after they
+  // are consumed from the chain.
+  const RefSlice& segment(size_t i) const;
+
+  // Describes the first |max_iov| segments in |iov| for readv()/writev().
+  // Returns the number of entries filled.
+  int FillIOVec(struct iovec* iov, int max_iov) const;
+
+  // Copies the whole chain into a string
+  std::string ToString() const;
+
+ private:
+  std::deque<RefSlice> segments_;
+  size_t size_;
+};
+
+}  // namespace iomgr
+
+#endif  // LIBIOMGR_INCLUDE_IO_BUFFER_CHAIN_H_
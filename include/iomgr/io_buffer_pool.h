@@ -0,0 +1,118 @@
+#ifndef LIBIOMGR_INCLUDE_IO_BUFFER_POOL_H_
+#define LIBIOMGR_INCLUDE_IO_BUFFER_POOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+
+#include "iomgr/export.h"
+#include "iomgr/io_buffer.h"
+
+namespace iomgr {
+
+class HugePageArena;
+class ResourceUser;
+
+// IOBufferPool hands out IOBufferWithSize objects whose bookkeeping and data
+// live in a single block, rounded up to a power-of-two size class. When the
+// last reference to a buffer is released, the block goes back to a cache of
+// the releasing thread (or to a shared free list if that cache is full)
+// instead of to malloc, so that steady-state reads and writes do not touch
+// the allocator at all.
+//
+// Typical usage:
+//   RefPtr<IOBufferWithSize> buf = IOBufferPool::Get()->Alloc(4096);
+//   client->Read(buf.get(), buf->size(), callback);
+class IOMGR_EXPORT IOBufferPool {
+ public:
+  // Smallest and largest pooled sizes. Larger requests are served by plain
+  // IOBufferWithSize objects and never cached.
+  static const size_t kMinBufferSize = 1 << 8;
+  static const size_t kMaxBufferSize = 1 << 20;
+
+  struct Stats {
+    // Allocations served from a cache
+    uint64_t hits;
+    // Allocations that had to call malloc
+    uint64_t misses;
+    // Bytes of blocks owned by live buffers
+    uint64_t bytes_in_use;
+    // Bytes of blocks kept in the caches for reuse
+    uint64_t bytes_cached;
+    // Bytes mapped by the huge page arena, and how many of them are backed
+    // by huge pages. Zero without UseHugePageArena().
+    uint64_t bytes_in_arena;
+    uint64_t bytes_huge_page_backed;
+  };
+
+  // The process-wide pool. It is never destroyed, so buffers may be released
+  // at any time, including during static destruction.
+  static IOBufferPool* Get();
+
+  IOBufferPool(const IOBufferPool&) = delete;
+  IOBufferPool& operator=(const IOBufferPool&) = delete;
+
+  // Returns a buffer of exactly |size| bytes. The block behind it holds the
+  // next power of two, so |size| should be chosen with that in mind.
+  RefPtr<IOBufferWithSize> Alloc(size_t size);
+  // Same as above, but the memory behind the buffer is charged to |user|
+  // until the buffer is released.
+  RefPtr<IOBufferWithSize> Alloc(size_t size, ResourceUser* user);
+
+  // Carves new blocks out of up to |max_bytes| of memory aligned to 2 MB
+  // huge pages, falling back to malloc once it is used up. Meant for
+  // high-throughput servers whose buffers would otherwise be scattered over
+  // many pages. Only the first call has an effect, and arena memory is never
+  // returned to the system, so it should be sized for the working set.
+  void UseHugePageArena(size_t max_bytes);
+
+  // With a huge page arena, this reads /proc/self/smaps and is not cheap
+  Stats GetStats() const;
+
+  // Returns the blocks cached by the calling thread and by the shared free
+  // lists to malloc. Caches of other threads are left alone.
+  void Trim();
+
+ private:
+  class PooledIOBuffer;
+  class LargeIOBuffer;
+  struct FreeList;
+  struct ThreadCache;
+  struct ThreadCacheList;
+
+  static const int kNumSizeClasses = 13;
+
+  IOBufferPool();
+  ~IOBufferPool();
+
+  static int SizeClass(size_t size);
+  static size_t BlockSize(int size_class);
+  // Size of a PooledIOBuffer, rounded up to keep the data aligned
+  static size_t ObjectSize();
+  static ThreadCache* GetThreadCache();
+
+  // Blocks of a new size class are taken from the arena if there is one
+  void* AllocBlock(int size_class);
+  void FreeBlock(void* block, int size_class);
+  void FreeToSystem(void* block, int size_class);
+  void AddThreadCache(ThreadCache* cache);
+  // Moves the blocks and counters of an exiting thread to the shared state.
+  void RemoveThreadCache(ThreadCache* cache);
+
+  std::unique_ptr<FreeList[]> free_lists_;
+  // All live thread caches, so that GetStats() can sum up their counters
+  std::unique_ptr<ThreadCacheList> thread_caches_;
+  // Counters not attributed to a live thread cache. The hot path only updates
+  // the counters of the calling thread's cache, which nobody else writes.
+  std::atomic<uint64_t> hits_;
+  std::atomic<uint64_t> misses_;
+  std::atomic<int64_t> bytes_in_use_;
+  std::atomic<uint64_t> bytes_allocated_;
+  std::atomic<HugePageArena*> arena_;
+};
+
+}  // namespace iomgr
+
+#endif  // LIBIOMGR_INCLUDE_IO_BUFFER_POOL_H_
@@ -7,6 +7,7 @@
 
 namespace iomgr {
 
+class IOManager;
 class TaskHandle;
 
 class IOMGR_EXPORT IOWatcher {
@@ -16,6 +17,14 @@ class IOMGR_EXPORT IOWatcher {
     kWatchRead = 1 << 0,
     kWatchWrite = 1 << 1,
     kWatchReadWrite = kWatchRead | kWatchWrite,
+    // With kWatchRead only, for an fd watched by several reactors: an event
+    // wakes one of them instead of all (EPOLLEXCLUSIVE). Must be given for
+    // the first watch of the fd in each reactor.
+    kWatchExclusive = 1 << 2,
+    // Alone, for messages on the error queue of a socket, e.g. MSG_ZEROCOPY
+    // completions. Reported with EPOLLERR, which also makes the fd readable
+    // and writable for the other watches.
+    kWatchError = 1 << 3,
   };
 
   static bool WatchFileDescriptor(int fd, int mode, IOWatcher* watcher,
@@ -23,6 +32,8 @@ class IOMGR_EXPORT IOWatcher {
 
   virtual void OnFileReadable(int fd) = 0;
   virtual void OnFileWritable(int fd) = 0;
+  // Only called for watches with kWatchError
+  virtual void OnFileError(int fd);
 
  protected:
   virtual ~IOWatcher();
@@ -49,6 +60,8 @@ class IOMGR_EXPORT IOWatcher::Controller {
   int fd_;
   int mode_;
   IOWatcher* watcher_;
+  // The IOManager watching |fd_|, if any
+  IOManager* iomgr_;
   std::unique_ptr<TaskHandle> task_;
 };
 
@@ -17,6 +17,13 @@ struct IOMGR_EXPORT DefaultDeleter {
   }
 };
 
+template <class T>
+struct RefPtr;
+
+template <class T>
+RefPtr<T> AdoptRef(T* obj);
+
+// RefCounted may be referenced and released from any thread.
 template <class T, typename Deleter = DefaultDeleter<T>>
 class IOMGR_EXPORT RefCounted {
  public:
@@ -27,12 +34,13 @@ class IOMGR_EXPORT RefCounted {
     return ref_count_.load(std::memory_order_acquire) == 1;
   }
   bool HasAtLeastOneRef() const {
-    return ref_count_.fetch_add(1, std::memory_order_relaxed) >= 1;
+    return ref_count_.load(std::memory_order_acquire) >= 1;
   }
 
-  void AddRef() { ref_count_.fetch_add(1, std::memory_order_relaxed); }
-  void Release() {
-    if (ref_count_.fetch_sub(1, std::memory_order_relaxed) == 1) {
+  void AddRef() const { ref_count_.fetch_add(1, std::memory_order_relaxed); }
+  void Release() const {
+    // Writes made through other references must be visible to the destructor
+    if (ref_count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
       Deleter::Destruct(static_cast<const T*>(this));
     }
   }
@@ -43,16 +51,60 @@ class IOMGR_EXPORT RefCounted {
 
  private:
   friend struct DefaultDeleter<T>;
+  template <class U>
+  friend RefPtr<U> AdoptRef(U* obj);
 
   template <typename U>
   static void DeleteInternal(const U* x) {
     delete x;
   }
 
+  // With no reference taken yet, nobody else may touch the count, so the
+  // first reference needs no RMW. A constructor may have taken some already.
+  void AdoptFirstRef() const {
+    if (ref_count_.load(std::memory_order_relaxed) == 0) {
+      ref_count_.store(1, std::memory_order_relaxed);
+    } else {
+      AddRef();
+    }
+  }
+
   mutable std::atomic<int> ref_count_{0};
 };
 
-template <typename T>
+// RefCountedThreadUnsafe is for objects that are referenced and released on
+// one thread only, such as buffers owned by a single connection. It spares
+// the atomic operations of RefCounted.
+template <class T>
+class IOMGR_EXPORT RefCountedThreadUnsafe {
+ public:
+  RefCountedThreadUnsafe(const RefCountedThreadUnsafe&) = delete;
+  RefCountedThreadUnsafe& operator=(const RefCountedThreadUnsafe&) = delete;
+
+  bool HasOneRef() const { return ref_count_ == 1; }
+  bool HasAtLeastOneRef() const { return ref_count_ >= 1; }
+
+  void AddRef() const { ++ref_count_; }
+  void Release() const {
+    if (--ref_count_ == 0) {
+      delete static_cast<const T*>(this);
+    }
+  }
+
+ protected:
+  explicit RefCountedThreadUnsafe() = default;
+  ~RefCountedThreadUnsafe() = default;
+
+ private:
+  template <class U>
+  friend RefPtr<U> AdoptRef(U* obj);
+
+  void AdoptFirstRef() const { AddRef(); }
+
+  mutable int ref_count_{0};
+};
+
+template <class T>
 struct RefPtr {
  public:
   RefPtr() = default;
@@ -111,24 +163,28 @@ struct RefPtr {
 
  private:
   template <class U>
-  friend class RefPtr;
+  friend struct RefPtr;
+  template <class U>
+  friend RefPtr<U> AdoptRef(U* obj);
 };
 
+// Takes the first reference of |obj|, which must be new, without the atomic
+// increment a RefPtr would do.
+template <class T>
+RefPtr<T> AdoptRef(T* obj) {
+  RefPtr<T> ret;
+  if (obj) {
+    obj->AdoptFirstRef();
+    ret.ptr_ = obj;
+  }
+  return ret;
+}
+
 template <class T, typename... Args>
 RefPtr<T> MakeRefCounted(Args&&... args) {
-  T* obj = new T(std::forward<Args>(args)...);
-  return RefPtr<T>(obj);
+  return AdoptRef(new T(std::forward<Args>(args)...));
 }
 
-// template <class T>
-// RefPtr<T> AdoptRef(T* obj) {
-//   DCHECK(obj);
-//   DCHECK(obj->HasOneRef());
-//   scoped_refptr<T> ret;
-//   ret.ptr_ = obj;
-//   return ret;
-// }
-
 }  // namespace iomgr
 
 #endif  // LIBIOMGR_INCLUDE_REF_COUNTED_H_
\ No newline at end of file
@@ -0,0 +1,126 @@
+// RefSlice is a Slice that owns a reference to the IOBuffer it points into.
+// Copying a RefSlice or taking a sub-slice of it only bumps the reference
+// count of the buffer, so pieces of a receive buffer can be kept (or handed
+// to another layer) after the read that filled it has completed, without
+// copying the bytes.
+//
+// The bytes themselves are shared, so a RefSlice must not be used to modify
+// the underlying buffer while other slices of it are alive.
+
+#ifndef LIBIOMGR_INCLUDE_REF_SLICE_H_
+#define LIBIOMGR_INCLUDE_REF_SLICE_H_
+
+#include <glog/logging.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <string>
+
+#include "iomgr/export.h"
+#include "iomgr/io_buffer.h"
+#include "iomgr/slice.h"
+
+namespace iomgr {
+
+class IOMGR_EXPORT RefSlice {
+ public:
+  // Create an empty slice
+  RefSlice() : buffer_(), offset_(0), size_(0) {}
+
+  // Create a slice that refers to |buffer|[offset, offset + size - 1]
+  RefSlice(RefPtr<IOBuffer> buffer, size_t offset, size_t size)
+      : buffer_(std::move(buffer)), offset_(offset), size_(size) {
+    DCHECK(buffer_ || size_ == 0);
+  }
+
+  // Create a slice that owns a copy of |data|
+  static RefSlice CopyFrom(const Slice& data) {
+    if (data.empty()) {
+      return RefSlice();
+    }
+    RefPtr<IOBufferWithSize> buffer =
+        MakeRefCounted<IOBufferWithSize>(data.size());
+    memcpy(buffer->data(), data.data(), data.size());
+    return RefSlice(std::move(buffer), 0, data.size());
+  }
+
+  // Intentionally copyable
+  RefSlice(const RefSlice&) = default;
+  RefSlice& operator=(const RefSlice&) = default;
+  RefSlice(RefSlice&&) = default;
+  RefSlice& operator=(RefSlice&&) = default;
+
+  // Return a pointer to the beginning of the referenced data
+  const char* data() const {
+    return buffer_ ? buffer_->data() + offset_ : "";
+  }
+
+  // Return the length (in bytes) of the referenced data
+  size_t size() const { return size_; }
+
+  // Return true iff the length of the referenced data is zero
+  bool empty() const { return size_ == 0; }
+
+  // The buffer holding the data, and where the data starts in it
+  const RefPtr<IOBuffer>& buffer() const { return buffer_; }
+  size_t offset() const { return offset_; }
+
+  // Return the |n|th byte in the referenced data
+  // REQUIRES: n < size()
+  char operator[](size_t n) const {
+    DCHECK_LT(n, size());
+    return data()[n];
+  }
+
+  // Return a non-owning view of the referenced data, valid while |*this| (or
+  // another slice of the same buffer) is alive
+  Slice slice() const { return Slice(data(), size_); }
+
+  // Return a slice sharing the same buffer that refers to the |n| bytes
+  // starting at |pos|
+  // REQUIRES: pos + n <= size()
+  RefSlice SubSlice(size_t pos, size_t n) const {
+    DCHECK_LE(pos + n, size());
+    return RefSlice(buffer_, offset_ + pos, n);
+  }
+
+  // Return a string that contains that copy of referenced data
+  std::string ToString() const { return std::string(data(), size_); }
+
+  // Change |*this| to refer to en empty array, releasing the buffer
+  void clear() {
+    buffer_ = nullptr;
+    offset_ = 0;
+    size_ = 0;
+  }
+
+  // Drop the first |n| bytes from |*this|
+  void remove_prefix(size_t n) {
+    DCHECK_LE(n, size());
+    offset_ += n;
+    size_ -= n;
+  }
+
+  // Drop the last |n| bytes from |*this|
+  void remove_suffix(size_t n) {
+    DCHECK_LE(n, size());
+    size_ -= n;
+  }
+
+ private:
+  RefPtr<IOBuffer> buffer_;
+  size_t offset_;
+  size_t size_;
+};
+
+inline bool operator==(const RefSlice& x, const RefSlice& y) {
+  return x.slice() == y.slice();
+}
+
+inline bool operator!=(const RefSlice& x, const RefSlice& y) {
+  return !(x == y);
+}
+
+}  // namespace iomgr
+
+#endif  // LIBIOMGR_INCLUDE_REF_SLICE_H_
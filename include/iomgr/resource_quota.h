@@ -0,0 +1,137 @@
+#ifndef LIBIOMGR_INCLUDE_RESOURCE_QUOTA_H_
+#define LIBIOMGR_INCLUDE_RESOURCE_QUOTA_H_
+
+#include <stddef.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+#include "iomgr/export.h"
+#include "iomgr/ref_counted.h"
+
+namespace iomgr {
+
+class ResourceUser;
+
+// ResourceQuota bounds the buffer memory held on behalf of a set of
+// connections. Every connection charges the quota through its own
+// ResourceUser, which may have a limit of its own.
+//
+// Going over a limit never fails an allocation that is already under way.
+// Instead, connections stop reading from their sockets until enough memory is
+// released, the IOBufferPool caches are trimmed, and the pressure callback is
+// told, so that the application can shed load.
+//
+// Typical usage:
+//   ResourceQuota::Get()->SetLimit(512 << 20);
+//   ResourceQuota::Get()->SetPerUserLimit(4 << 20);
+//   ResourceQuota::Get()->SetPressureCallback([](bool over_quota) {...});
+class IOMGR_EXPORT ResourceQuota {
+ public:
+  // Run with true when the quota goes over its limit and with false when it
+  // gets back under it. Posted to the TaskRunner.
+  using PressureCallback = std::function<void(bool over_quota)>;
+
+  // Limits of zero mean unlimited
+  ResourceQuota();
+  // All users of the quota, and the buffers charged to them, must be gone
+  ~ResourceQuota();
+
+  ResourceQuota(const ResourceQuota&) = delete;
+  ResourceQuota& operator=(const ResourceQuota&) = delete;
+
+  // The process-wide quota, used by connections unless told otherwise. It is
+  // unlimited until SetLimit() is called, and never destroyed.
+  static ResourceQuota* Get();
+
+  void SetLimit(size_t bytes);
+  // The limit given to users created after this call
+  void SetPerUserLimit(size_t bytes);
+  void SetPressureCallback(PressureCallback callback);
+
+  size_t limit() const { return limit_.load(std::memory_order_relaxed); }
+  size_t per_user_limit() const {
+    return per_user_limit_.load(std::memory_order_relaxed);
+  }
+  // Bytes charged by all users
+  size_t used() const { return used_.load(std::memory_order_relaxed); }
+  bool IsOverQuota() const;
+
+ private:
+  friend class ResourceUser;
+  struct State;
+
+  void Charge(size_t bytes);
+  void Uncharge(size_t bytes);
+  // Re-evaluates IsOverQuota() and acts on a change
+  void UpdatePressure();
+
+  std::atomic<size_t> limit_;
+  std::atomic<size_t> per_user_limit_;
+  std::atomic<size_t> used_;
+  // IsOverQuota() as of the last UpdatePressure()
+  std::atomic<bool> over_quota_;
+  // Pressure callback and blocked users
+  std::unique_ptr<State> state_;
+};
+
+// ResourceUser is the share of one connection in a ResourceQuota. Buffers
+// charged to it hold a reference, so it lives until the last of them is
+// released.
+class IOMGR_EXPORT ResourceUser : public RefCounted<ResourceUser> {
+ public:
+  // |quota| must outlive the user
+  explicit ResourceUser(ResourceQuota* quota);
+
+  ResourceUser(const ResourceUser&) = delete;
+  ResourceUser& operator=(const ResourceUser&) = delete;
+
+  ResourceQuota* quota() const { return quota_; }
+  size_t used() const { return used_.load(std::memory_order_relaxed); }
+  size_t limit() const { return limit_.load(std::memory_order_relaxed); }
+  // Zero means the user is bounded by the quota only
+  void set_limit(size_t bytes);
+
+  // Return true if the user or its quota is over its limit
+  bool IsOverQuota() const;
+
+  // Named apart from RefCounted::Release()
+  void Charge(size_t bytes);
+  void Uncharge(size_t bytes);
+
+  // Posts |callback| to the TaskRunner once IsOverQuota() is false, which may
+  // be right away. Only one wait may be pending, and it must be cancelled
+  // before the owner drops its reference.
+  void WaitForQuota(std::function<void()> callback);
+  // Once it returns, the callback does not run any more. If it is running on
+  // another thread, waits for it to return. It may be called from the
+  // callback itself.
+  void CancelWait();
+
+ private:
+  friend class RefCounted<ResourceUser>;
+  friend class ResourceQuota;
+
+  ~ResourceUser();
+
+  // Posts the pending wait if the user is back under quota. Requires the
+  // quota lock.
+  void MaybeResumeLocked();
+  void RunWaiter();
+
+  ResourceQuota* const quota_;
+  std::atomic<size_t> limit_;
+  std::atomic<size_t> used_;
+  // True while listed as blocked by the quota
+  std::atomic<bool> waiting_;
+  // Guarded by the quota lock
+  std::function<void()> waiter_;
+  bool resumed_;
+  // Number of callbacks running, guarded by the quota lock
+  int running_waiters_;
+};
+
+}  // namespace iomgr
+
+#endif  // LIBIOMGR_INCLUDE_RESOURCE_QUOTA_H_
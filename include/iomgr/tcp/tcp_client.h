@@ -1,6 +1,9 @@
 #ifndef LIBIOMGR_INCLUDE_TCP_TCP_CLIENT_H_
 #define LIBIOMGR_INCLUDE_TCP_TCP_CLIENT_H_
 
+#include <stddef.h>
+#include <stdint.h>
+
 #include <functional>
 #include <memory>
 
@@ -13,6 +16,9 @@
 namespace iomgr {
 
 class IOBuffer;
+class IOBufferChain;
+class RefSlice;
+class ResourceQuota;
 class InetAddress;
 
 class IOMGR_EXPORT TCPClient {
@@ -23,13 +29,57 @@ class IOMGR_EXPORT TCPClient {
           keep_alive(false, 0),
           connect_timeout(Time::Delta::Inifinite()),
           receive_buffer_size(0 /* no-setting */),
-          send_buffer_size(0 /* no-setting */) {}
+          send_buffer_size(0 /* no-setting */),
+          resource_quota(nullptr /* ResourceQuota::Get() */),
+          fast_open(false),
+          zerocopy(false) {}
 
     bool no_delay;
     std::pair<bool, int> keep_alive;
     Time::Delta connect_timeout;
     int receive_buffer_size;
     int send_buffer_size;
+    // Charged for the buffers allocated by ReadAutoSized() and ReadV(). While
+    // the connection is over quota, reads wait instead of touching the socket.
+    ResourceQuota* resource_quota;
+    // TCP Fast Open. Once the server has handed out a cookie, Connect()
+    // succeeds at once and the data of the first write goes out in the SYN,
+    // saving a round trip. Nothing is sent before that write, and connect
+    // errors are reported by it, so this is for protocols where the client
+    // speaks first. Without a cookie, the connect fetches one and completes
+    // as usual.
+    bool fast_open;
+    // Sends writes of |kZeroCopyMinBytes| or more with MSG_ZEROCOPY: the
+    // kernel sends from the pages of the buffers instead of copying them, and
+    // the client keeps a reference to the buffers until the kernel reports
+    // that it is done with them. Until then the buffers must not be changed,
+    // even after the write callback has run; RefCounted::HasOneRef() tells
+    // when the caller holds the last reference. Smaller writes are copied,
+    // pinning pages costs more than copying a few of them.
+    bool zerocopy;
+  };
+
+  static const size_t kZeroCopyMinBytes = 16 * 1024;
+
+  // Process-wide counters of connections made with Options::fast_open,
+  // updated when a connection is closed
+  struct FastOpenStats {
+    // Connections whose handshake completed
+    uint64_t attempts;
+    // Connections whose SYN data was acknowledged by the server
+    uint64_t succeeded;
+    // Connections that fell back to a normal handshake, e.g. the first to a
+    // server, or a server without Fast Open
+    uint64_t fell_back;
+  };
+
+  // Process-wide counters of writes sent with Options::zerocopy
+  struct ZeroCopyStats {
+    // Sends whose buffers the kernel has released
+    uint64_t completed;
+    // Completed sends whose data the kernel copied after all, e.g. over
+    // loopback or to a device without scatter-gather support
+    uint64_t copied;
   };
 
   TCPClient();
@@ -47,6 +97,9 @@ class IOMGR_EXPORT TCPClient {
                         const InetAddress* local,
                         std::unique_ptr<TCPClient>* client);
 
+  static FastOpenStats GetFastOpenStats();
+  static ZeroCopyStats GetZeroCopyStats();
+
   // Called to read data from connection, up to |buf_len| bytes.
   // Returns number of bytes read from connection, or zero if received EOF.
   // Otherwise, return Status::TryAgain() and read_callback will be run when
@@ -64,12 +117,77 @@ class IOMGR_EXPORT TCPClient {
   // Cancels a pending ReadIfReady()
   virtual Status CancelReadIfReady() = 0;
 
+  // Called to read data from connection into a buffer taken from IOBufferPool
+  // and sized by the client: it follows the sizes of recent reads, and jumps
+  // to the amount of queued data once reads keep filling their buffers. No
+  // buffer is taken while nothing is queued.
+  // Returns number of bytes read from connection, or zero if received EOF,
+  // and |data| then refers to the bytes read. Otherwise, return
+  // Status::TryAgain() and read_callback will be run after |data| is set.
+  virtual StatusOr<int> ReadAutoSized(RefSlice* data,
+                                      StatusOrIntCallback read_callback) = 0;
+
+  // Called to read data from connection with readv(), up to |max_bytes| bytes.
+  // The data lands in buffers taken from IOBufferPool that are appended to
+  // |chain|, so no contiguous buffer has to be sized up front. How much is
+  // read at a time is sized like ReadAutoSized().
+  // Returns number of bytes read from connection, or zero if received EOF.
+  // Otherwise, return Status::TryAgain() and read_callback will be run after
+  // data is appended to |chain|, which must stay alive until then.
+  virtual StatusOr<int> ReadV(IOBufferChain* chain, int max_bytes,
+                              StatusOrIntCallback read_callback) = 0;
+
   // Called to write data to connection, up to |buf_len| bytes.
   // Return number of bytes write to connection, or Status::TryAgain() if data
   // cannot be send immediately. And write_callback will be run when all data
   // have been send or an error occurs.
   virtual StatusOr<int> Write(IOBuffer* buf, int buf_len,
                               StatusOrIntCallback callback) = 0;
+
+  // Called to write the data of |chain| to connection with writev(). The bytes
+  // written are consumed from |chain|.
+  // Return number of bytes write to connection, or Status::TryAgain() if data
+  // cannot be send immediately. And write_callback will be run when some data
+  // have been send or an error occurs. |chain| must stay alive until then.
+  virtual StatusOr<int> WriteV(IOBufferChain* chain,
+                               StatusOrIntCallback write_callback) = 0;
+
+  // Called to queue |data| behind earlier queued writes, without waiting for
+  // them. The queue is flushed in order with writev() whenever the socket is
+  // writable. Each callback runs in queue order, once all of its data is
+  // written, with the size of the data or with the error that stopped the
+  // queue. A null callback is skipped, e.g. for all but the last segment of
+  // a message.
+  // May be called from any thread, but not while a Write() or WriteV() is
+  // pending. Callbacks may run on any thread, including the calling one
+  // before QueueWrite() returns. A callback may call Disconnect(), but must
+  // not destroy the client.
+  // Returns an error if an earlier queued write has failed.
+  virtual Status QueueWrite(RefSlice data, StatusOrIntCallback callback) = 0;
+
+  // Called to queue |length| bytes of the file |fd| from |offset|, like
+  // QueueWrite(), for static content or log shipping. The bytes go from the
+  // page cache to the socket with sendfile(), without passing through user
+  // space. |fd| must stay open until the callback runs, or until the client
+  // is disconnected; its file position is not used. The callback gets
+  // OutOfRange if the file ends before |length| bytes, which must fit in an
+  // int.
+  virtual Status SendFile(int fd, uint64_t offset, size_t length,
+                          StatusOrIntCallback callback) = 0;
+
+  // Bytes queued but not written yet, from files too
+  virtual size_t QueuedWriteBytes() const = 0;
+
+  // Runs |callback| with true once more than |bytes| are queued, and with
+  // false once the queue has drained to half of that, so that producers can
+  // pause instead of queueing without bound. Zero turns it off. Queued file
+  // bytes do not count, they take no memory.
+  // The callback never runs on two threads at once, and always alternates
+  // between true and false; a change undone before it could run is skipped.
+  // It may queue more writes.
+  virtual void SetWriteHighWater(size_t bytes,
+                                 std::function<void(bool above)> callback) = 0;
+
   virtual Status Disconnect() = 0;
   virtual bool IsConnected() const = 0;
   virtual Status GetLocalAddress(InetAddress* local) const = 0;
@@ -0,0 +1,84 @@
+#ifndef LIBIOMGR_INCLUDE_TCP_TCP_RELAY_H_
+#define LIBIOMGR_INCLUDE_TCP_TCP_RELAY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+
+#include "iomgr/callback.h"
+#include "iomgr/export.h"
+#include "iomgr/status.h"
+#include "iomgr/time.h"
+
+namespace iomgr {
+
+class TCPClient;
+
+// TCPRelay pipes two connected clients to each other, e.g. the two sides of
+// a proxy, until both have closed their write side.
+class IOMGR_EXPORT TCPRelay {
+ public:
+  struct Options {
+    Options() : splice(true), pipe_size(0), buffer_size(64 * 1024) {}
+
+    // Moves the bytes of each direction with splice() through a pipe, so
+    // that they never reach user space. Otherwise, or if the pipes cannot be
+    // made, each direction reads into a buffer and writes it back out.
+    bool splice;
+    // Capacity of the pipes, zero for the system default of 64 KB
+    int pipe_size;
+    // Size of the buffer of each direction when the bytes are copied
+    size_t buffer_size;
+  };
+
+  struct DirectionStats {
+    DirectionStats()
+        : bytes(0),
+          elapsed(Time::Delta::Zero()),
+          bytes_per_second(0),
+          closed(false) {}
+
+    uint64_t bytes;
+    // Since the relay started, until the direction was closed or until now
+    Time::Delta elapsed;
+    // |bytes| over |elapsed|
+    double bytes_per_second;
+    // True once the end of the stream was passed on
+    bool closed;
+  };
+
+  struct Stats {
+    // False if the bytes are copied
+    bool spliced;
+    DirectionStats first_to_second;
+    DirectionStats second_to_first;
+  };
+
+  TCPRelay();
+  virtual ~TCPRelay();
+
+  TCPRelay(const TCPRelay&) = delete;
+  TCPRelay& operator=(const TCPRelay&) = delete;
+
+  // Called to relay the bytes received by |first| to |second|, and the other
+  // way round. A side that sees the end of the stream shuts down the write
+  // side of the other, the opposite direction going on until it ends too.
+  // No more is read from a side than the other can take, so a slow reader
+  // stalls its peer through TCP flow control instead of filling memory.
+  // Both clients must be connected, with no read or write in progress, and
+  // are disconnected when the relay is destroyed.
+  // |done_callback| runs once, with Status::OK() after both directions
+  // closed, or with the first error. It may run on any thread, but must not
+  // destroy the relay.
+  static Status Start(std::unique_ptr<TCPClient> first,
+                      std::unique_ptr<TCPClient> second,
+                      const Options& options, StatusCallback done_callback,
+                      std::unique_ptr<TCPRelay>* relay);
+
+  virtual Stats GetStats() const = 0;
+};
+
+}  // namespace iomgr
+
+#endif  // LIBIOMGR_INCLUDE_TCP_TCP_RELAY_H_
@@ -1,14 +1,20 @@
 #ifndef LIBIOMGR_INCLUDE_TCP_TCP_SERVER_H_
 #define LIBIOMGR_INCLUDE_TCP_TCP_SERVER_H_
 
+#include <stddef.h>
+#include <stdint.h>
+
 #include <functional>
 #include <memory>
+#include <vector>
 
 #include "iomgr/export.h"
 #include "iomgr/status.h"
+#include "iomgr/time.h"
 
 namespace iomgr {
 
+class ResourceQuota;
 class TCPClient;
 class InetAddress;
 
@@ -16,12 +22,62 @@ class IOMGR_EXPORT TCPServer {
  public:
   using AcceptCallback = std::function<void(Status)>;
   struct Options {
-    Options() : reuse_address(false), backlog(5) {}
+    Options()
+        : reuse_address(false),
+          backlog(5),
+          resource_quota(nullptr /* ResourceQuota::Get() */),
+          reuse_port(false),
+          reactor(0),
+          steer_by_cpu(false),
+          fast_open_queue_length(0),
+          defer_accept(Time::Delta::Zero()),
+          reactors(1),
+          zerocopy(false) {}
     Options(bool reuse_address, int backlog)
-        : reuse_address(reuse_address), backlog(backlog) {}
+        : reuse_address(reuse_address),
+          backlog(backlog),
+          resource_quota(nullptr),
+          reuse_port(false),
+          reactor(0),
+          steer_by_cpu(false),
+          fast_open_queue_length(0),
+          defer_accept(Time::Delta::Zero()),
+          reactors(1),
+          zerocopy(false) {}
 
     bool reuse_address;
     int backlog;
+    // Quota of the accepted connections, see TCPClient::Options
+    ResourceQuota* resource_quota;
+    // Sets SO_REUSEPORT, so that several servers can listen on the same
+    // address and the kernel spreads new connections over them
+    bool reuse_port;
+    // Index of the reactor, i.e. poll thread, that watches the listening
+    // socket and the connections it accepts. 0 is the global reactor; the
+    // others are created on first use.
+    size_t reactor;
+    // ListenSharded() only: picks the shard of a connection by the CPU that
+    // received it, so that a shard sees the connections of the same RX
+    // queues. Without it the kernel picks by a hash of the addresses.
+    bool steer_by_cpu;
+    // Accepts TCP Fast Open with up to that many connections whose SYN data
+    // is not accepted yet, see TCPClient::Options::fast_open. Zero turns it
+    // off. The system must allow it too (net.ipv4.tcp_fastopen & 2).
+    int fast_open_queue_length;
+    // Accepts a connection only once its first data has arrived
+    // (TCP_DEFER_ACCEPT), so that the first read of an accepted connection
+    // rarely has to wait. The kernel holds handshake-only connections for
+    // about that long, in whole seconds, then drops them or hands them over
+    // without data. Zero turns it off.
+    Time::Delta defer_accept;
+    // Number of reactors, from |reactor| on, that watch the listening socket.
+    // With more than one, a connection wakes only one of them
+    // (EPOLLEXCLUSIVE) instead of all, and the accepted connections are
+    // spread over them in turn.
+    size_t reactors;
+    // Zero-copy writes on the accepted connections, see
+    // TCPClient::Options::zerocopy
+    bool zerocopy;
   };
 
   TCPServer();
@@ -32,11 +88,32 @@ class IOMGR_EXPORT TCPServer {
 
   static Status Listen(const InetAddress& local, const Options& options,
                        std::unique_ptr<TCPServer>* server);
+  // Called to open |shards| servers on the same address with SO_REUSEPORT,
+  // server i on reactor |options.reactor| + i, so that accepts and the IO of
+  // the accepted connections spread over as many poll threads. A port of 0
+  // is picked once and shared.
+  static Status ListenSharded(const InetAddress& local, const Options& options,
+                              size_t shards,
+                              std::vector<std::unique_ptr<TCPServer>>* servers);
   virtual Status Accept(std::unique_ptr<TCPClient>* socket,
                         AcceptCallback callback) = 0;
   virtual Status Accept(std::unique_ptr<TCPClient>* socket,
                         AcceptCallback callback, InetAddress* address) = 0;
+  // Called to accept up to |max_sockets| pending connections at once, which
+  // are appended to |sockets|. Returns OK if any connection was accepted
+  // right away. Otherwise returns TryAgain and runs |callback| once some are
+  // accepted, or with the error. Draining the backlog per wakeup saves a
+  // trip through the task queue per connection during connection storms.
+  // Remote addresses are available from TCPClient::GetRemoteAddress().
+  virtual Status AcceptMany(size_t max_sockets,
+                            std::vector<std::unique_ptr<TCPClient>>* sockets,
+                            AcceptCallback callback) = 0;
   virtual Status GetLocalAddress(InetAddress* address) const = 0;
+  // Number of connections accepted so far, e.g. to see how the kernel spreads
+  // connections over shards
+  virtual uint64_t accepted_connections() const = 0;
+  // Number of accepted connections whose SYN carried data with TCP Fast Open
+  virtual uint64_t fast_open_connections() const = 0;
 };
 
 }  // namespace iomgr
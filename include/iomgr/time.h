@@ -85,6 +85,11 @@ class IOMGR_EXPORT Time {
   // CLOCK_MONOTONIC flag
   static Time Now();
 
+  // Like Now(), but read from CLOCK_MONOTONIC_COARSE. It is several times
+  // cheaper and only as precise as the kernel tick (typically 1-4ms), so it
+  // suits timeouts that do not need better resolution.
+  static Time NowCoarse();
+
   // Creates a new Time with an internal value of 0.  IsInitialized()
   // will return false for these times.
   static Time Zero() { return Time(0); }
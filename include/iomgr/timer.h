@@ -10,25 +10,80 @@
 
 namespace iomgr {
 
-class TaskHandle;
+class TimerManager;
 
 class IOMGR_EXPORT Timer {
  public:
   class IOMGR_EXPORT Controller;
 
+  // What a repeating timer does when one or more periods have been missed
+  // (e.g. the poll thread was busy) by the time it expires.
+  enum CatchUpPolicy {
+    // Run the closure once and schedule the next expiry on the first period
+    // boundary after now.
+    kSkipMissed,
+    // Run the closure once for every missed period.
+    kFireAll,
+  };
+
+  // Where the closure of an expired timer runs.
+  enum Dispatch {
+    // On a TaskRunner worker. All timers expiring in the same reactor
+    // iteration are run by a single task.
+    kPostTask,
+    // Directly on the poll thread, right after the timers are checked. The
+    // closure must be short and must not block.
+    kRunInline,
+  };
+
+  struct Options {
+    Options()
+        : catch_up_policy(kSkipMissed),
+          slack(Time::Delta::Zero()),
+          dispatch(kPostTask) {}
+
+    CatchUpPolicy catch_up_policy;
+    // How much later than requested the timer may expire. A non-zero slack
+    // lets the deadline be rounded up so that timers armed at slightly
+    // different times expire together in a single reactor wakeup.
+    Time::Delta slack;
+    Dispatch dispatch;
+  };
+
   Timer(const Timer&) = delete;
   Timer& operator=(const Timer&) = delete;
 
   static void Start(Time::Delta delay, Closure closure,
                     Timer::Controller* controller);
+  static void Start(Time::Delta delay, Closure closure,
+                    Timer::Controller* controller, const Options& options);
+  // Same as above, on the timers of one reactor rather than the global one.
+  // The timer expires on the poll thread of that reactor, and only its
+  // locks are taken, which keeps the reactors of a sharded server apart.
+  static void Start(TimerManager* manager, Time::Delta delay, Closure closure,
+                    Timer::Controller* controller,
+                    const Options& options = Options());
+
+  // Runs |closure| every |period| until the timer is cancelled. Expiries are
+  // scheduled against the original deadline (deadline + n * period), so the
+  // timer does not drift, and the timer is rescheduled in place without going
+  // through Start() again.
+  static void StartRepeating(Time::Delta period, Closure closure,
+                             Timer::Controller* controller,
+                             const Options& options = Options());
+  static void StartRepeating(TimerManager* manager, Time::Delta period,
+                             Closure closure, Timer::Controller* controller,
+                             const Options& options = Options());
 
   Time deadline() const { return deadline_; }
   bool pending() const { return pending_; }
+  bool repeating() const { return !period_.IsZero(); }
 
  private:
   friend class Controller;
   friend class TimerHeap;
   friend class TimerHeapTest;
+  friend class TimerHeapBenchmark;
   friend class TimerManager;
 
   Timer();
@@ -36,8 +91,19 @@ class IOMGR_EXPORT Timer {
 
   Time deadline_;
   bool pending_;
+  // Zero for one-shot timers
+  Time::Delta period_;
+  CatchUpPolicy catch_up_policy_;
+  Dispatch dispatch_;
+  Time::Delta slack_;
+  // The manager the timer was last armed on
+  TimerManager* manager_;
   uint32_t heap_index_;
+  // The closure of a one-shot timer, moved out when it expires
   Closure closure_;
+  // The closure of a repeating timer, shared with every expiry so that
+  // expiring does not copy it
+  std::shared_ptr<const Closure> repeating_closure_;
   Controller* controller_;
   struct {
     Timer* le_next;
@@ -54,17 +120,24 @@ class IOMGR_EXPORT Timer::Controller {
   Controller& operator=(const Controller&) = delete;
 
   void Cancel();
+  // Moves the deadline of the pending timer to |delay| from now, keeping its
+  // closure and options. A later deadline is applied lazily: the timer stays
+  // where it is and is only requeued when the old deadline is reached, which
+  // makes pushing an idle timeout forward on every read cheap. Returns false
+  // if the timer is not pending.
+  bool Reset(Time::Delta delay);
 
   Time deadline() const { return timer_.deadline(); }
   bool pending() const { return timer_.pending(); }
+  bool repeating() const { return timer_.repeating(); }
 
  private:
   friend class TimerManager;
+  friend class TimerManagerTest;
 
   Timer* timer() { return &timer_; }
 
   Timer timer_;
-  std::unique_ptr<TaskHandle> scheduled_;
 };
 
 }  // namespace iomgr
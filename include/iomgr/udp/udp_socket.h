@@ -0,0 +1,115 @@
+#ifndef LIBIOMGR_INCLUDE_UDP_UDP_SOCKET_H_
+#define LIBIOMGR_INCLUDE_UDP_UDP_SOCKET_H_
+
+#include <stddef.h>
+
+#include <memory>
+#include <vector>
+
+#include "iomgr/callback.h"
+#include "iomgr/export.h"
+#include "iomgr/ref_slice.h"
+#include "iomgr/status.h"
+#include "iomgr/statusor.h"
+#include "iomgr/tcp/inet_address.h"
+
+namespace iomgr {
+
+class ResourceQuota;
+
+// UDPSocket reads and writes batches of datagrams, one recvmmsg() or
+// sendmmsg() per batch, for high packet rates such as telemetry ingestion.
+class IOMGR_EXPORT UDPSocket {
+ public:
+  struct Options {
+    Options()
+        : reuse_address(false),
+          reuse_port(false),
+          receive_buffer_size(0 /* no-setting */),
+          send_buffer_size(0 /* no-setting */),
+          max_datagram_size(2048),
+          gro(false),
+          resource_quota(nullptr /* ResourceQuota::Get() */) {}
+
+    bool reuse_address;
+    // Lets several sockets bind the same port, the kernel spreading the
+    // flows over them
+    bool reuse_port;
+    int receive_buffer_size;
+    int send_buffer_size;
+    // Room for each datagram read, longer ones are truncated. A batch is read
+    // into a pooled buffer of the batch size times this, once the socket has
+    // a datagram, and each datagram is copied out into a buffer of its own
+    // size, so that it does not hold on to the memory of the batch.
+    size_t max_datagram_size;
+    // UDP_GRO: the kernel may hand over consecutive datagrams of a sender
+    // as one Datagram with |segment_size| set, so that a single read moves
+    // dozens of them. Each read then has room for kMaxGROSize bytes.
+    bool gro;
+    // Charged for the buffers of the datagrams read. While the socket is over
+    // quota, reads wait and datagrams stay queued in the socket, where the
+    // kernel drops new ones once its receive buffer is full.
+    ResourceQuota* resource_quota;
+  };
+
+  struct Datagram {
+    Datagram() : data(), address(), segment_size(0), truncated(false) {}
+    Datagram(RefSlice data, const InetAddress& address)
+        : data(std::move(data)),
+          address(address),
+          segment_size(0),
+          truncated(false) {}
+
+    RefSlice data;
+    // Source of a datagram read, destination of one written
+    InetAddress address;
+    // Zero if |data| is one datagram. Otherwise |data| holds several, of
+    // |segment_size| bytes each but the last, which may be shorter: read
+    // with Options::gro, or written with UDP_SEGMENT (GSO), the kernel or
+    // the NIC cutting |data| into up to kMaxSegments datagrams.
+    size_t segment_size;
+    // Set on a datagram read if it did not fit in Options::max_datagram_size
+    // bytes, or kMaxGROSize with GRO, and |data| holds only its head
+    bool truncated;
+  };
+
+  // Datagrams read or written per call at most
+  static const size_t kMaxBatch = 64;
+  // Limits of a Datagram with |segment_size| set
+  static const size_t kMaxGROSize = 64 * 1024;
+  static const size_t kMaxSegments = 64;
+
+  UDPSocket();
+  virtual ~UDPSocket();
+
+  UDPSocket(const UDPSocket&) = delete;
+  UDPSocket& operator=(const UDPSocket&) = delete;
+
+  // Called to open a socket bound to |local|. A zero port picks one, see
+  // GetLocalAddress().
+  static Status Bind(const InetAddress& local, const Options& options,
+                     std::unique_ptr<UDPSocket>* socket);
+
+  // Called to read up to |max_datagrams| datagrams, appended to |datagrams|.
+  // Returns the number of datagrams read. Otherwise, return
+  // Status::TryAgain() and read_callback will be run after datagrams are
+  // appended to |datagrams|, which must stay alive until then.
+  virtual StatusOr<int> ReadBatch(std::vector<Datagram>* datagrams,
+                                  size_t max_datagrams,
+                                  StatusOrIntCallback read_callback) = 0;
+
+  // Called to write the datagrams of |datagrams|, which are erased from it
+  // once written.
+  // Return number of datagrams written, or Status::TryAgain() if none can
+  // be sent immediately. And write_callback will be run when some have been
+  // sent or an error occurs. |datagrams| must stay alive until then.
+  virtual StatusOr<int> WriteBatch(std::vector<Datagram>* datagrams,
+                                   StatusOrIntCallback write_callback) = 0;
+
+  virtual Status GetLocalAddress(InetAddress* local) const = 0;
+  virtual Status Close() = 0;
+};
+
+}  // namespace iomgr
+
+#endif  // LIBIOMGR_INCLUDE_UDP_UDP_SOCKET_H_
@@ -6,6 +6,7 @@
 #include "iomgr/http/http_request.h"
 #include "iomgr/io_buffer.h"
 #include "iomgr/ref_counted.h"
+#include "iomgr/ref_slice.h"
 #include "iomgr/tcp/inet_address.h"
 #include "iomgr/tcp/tcp_client.h"
 #include "threading/task_runner.h"
@@ -13,8 +14,6 @@
 
 namespace iomgr {
 
-static const int kBufferSize = 1024;
-
 class InternalRequest {
  public:
   InternalRequest(const InetAddress& remote, const Slice& request_text,
@@ -22,12 +21,11 @@ class InternalRequest {
       : remote_(remote),
         parser_(response),
         on_done_(on_done),
-        incoming_(MakeRefCounted<GrowableIOBuffer>()),
+        incoming_(),
         outgoing_(MakeRefCounted<DrainableIOBuffer>(
             MakeRefCounted<StringIOBuffer>(
                 std::string(request_text.data(), request_text.size())),
             request_text.size())) {
-    incoming_->SetCapacity(kBufferSize);
     outgoing_->SetOffset(0);
 
     TaskRunner::Get()->PostTask(std::bind(&InternalRequest::DoConnect, this));
@@ -51,7 +49,8 @@ class InternalRequest {
   std::unique_ptr<TCPClient> tcp_;
   bool have_read_byte_;
   HTTPClient::RequestCb on_done_;
-  RefPtr<GrowableIOBuffer> incoming_;
+  // The bytes of the last read, sized by the TCP client
+  RefSlice incoming_;
   RefPtr<DrainableIOBuffer> outgoing_;
 };
 
@@ -107,14 +106,10 @@ void InternalRequest::OnWriteCompleted(StatusOr<int> write_or) {
 void InternalRequest::DoReadLoop() {
   bool read_more;
   do {
-    if (incoming_->RemainingCapacity() == 0) {
-      incoming_->SetCapacity(incoming_->capacity() * 2);
-    }
-
     StatusOr<int> read_or =
-        tcp_->Read(incoming_.get(), incoming_->RemainingCapacity(),
-                   std::bind(&InternalRequest::OnReadCompleted, this,
-                             std::placeholders::_1));
+        tcp_->ReadAutoSized(&incoming_,
+                            std::bind(&InternalRequest::OnReadCompleted, this,
+                                      std::placeholders::_1));
     if (read_or.status().IsTryAgain()) {
       return;
     }
@@ -136,7 +131,9 @@ bool InternalRequest::HandleReadResult(StatusOr<int> read_or) {
 
   size_t bytes = read_or.value();
   if (bytes > 0) {
-    if (!parser_.Parse(Slice(incoming_->data(), bytes), nullptr)) {
+    bool parsed = parser_.Parse(incoming_.slice(), nullptr);
+    incoming_.clear();
+    if (!parsed) {
       Finish(Status::IOError("Failed to parse incoming data"));
       return false;
     }
@@ -69,7 +69,7 @@ void HTTPResponse::AddHeader(const Slice& key, const Slice& value) {
                       std::string(value.data(), value.size())});
 }
 
-std::string HTTPResponse::ToString() const {
+std::string HTTPResponse::HeadersToString() const {
   std::string ret;
   ret.append(VersionName(version_))
       .append(" ")
@@ -80,8 +80,11 @@ std::string HTTPResponse::ToString() const {
     ret.append(header.key).append(": ").append(header.value).append(kCRLF);
   }
   ret.append(kCRLF);
-  ret.append(body_);
   return ret;
 }
 
+std::string HTTPResponse::ToString() const {
+  return HeadersToString().append(body_);
+}
+
 }  // namespace iomgr
@@ -26,6 +26,11 @@ TEST(HTTPResponse, ToString) {
       "\r\n"
       "something",
       resp.ToString());
+  EXPECT_EQ(
+      "HTTP/1.1 404 Not Found\r\n"
+      "Hello: World\r\n"
+      "\r\n",
+      resp.HeadersToString());
 }
 
 }  // namespace iomgr
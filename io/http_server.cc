@@ -3,6 +3,8 @@
 #include "iomgr/http/http_request.h"
 #include "iomgr/http/http_response.h"
 #include "iomgr/io_buffer.h"
+#include "iomgr/io_buffer_chain.h"
+#include "iomgr/ref_slice.h"
 #include "iomgr/tcp/inet_address.h"
 #include "iomgr/tcp/tcp_client.h"
 #include "iomgr/tcp/tcp_server.h"
@@ -11,7 +13,11 @@
 
 namespace iomgr {
 
-static const int kBufferSize = 1024;
+// Upper bound of bytes taken from the socket by one ReadV(). Below it the
+// TCP client sizes each read from the previous ones.
+static const int kMaxReadBytes = 64 * 1024;
+// Connections taken from the listen backlog per wakeup
+static const size_t kMaxAcceptBatch = 64;
 
 class InternalResponse {
  public:
@@ -26,10 +32,10 @@ class InternalResponse {
   // Return true if need to read more data
   bool HandleReadResult(StatusOr<int> read_or);
 
-  void DoWriteLoop();
   void OnWriteCompleted(StatusOr<int> write_or);
 
-  void SendResponse(const HTTPResponse& response);
+  // The body of |response| is moved into the write queue of the connection
+  void SendResponse(HTTPResponse* response);
 
   void Finish(Status status);
 
@@ -38,8 +44,7 @@ class InternalResponse {
   HTTPParser<HTTPRequest> parser_;
   HTTPServer::Delegate* const delegate_;
   size_t received_body_bytes_;
-  RefPtr<GrowableIOBuffer> incoming_;
-  RefPtr<DrainableIOBuffer> outgoint_;
+  IOBufferChain incoming_;
 };
 
 InternalResponse::InternalResponse(std::unique_ptr<TCPClient> tcp,
@@ -47,24 +52,18 @@ InternalResponse::InternalResponse(std::unique_ptr<TCPClient> tcp,
     : tcp_(std::move(tcp)),
       parser_(&request_),
       delegate_(CHECK_NOTNULL(delegate)),
-      received_body_bytes_(-1),
-      incoming_(MakeRefCounted<GrowableIOBuffer>()) {
-  incoming_->SetCapacity(kBufferSize);
-
+      received_body_bytes_(0),
+      incoming_() {
   TaskRunner::Get()->PostTask(std::bind(&InternalResponse::DoReadLoop, this));
 }
 
 void InternalResponse::DoReadLoop() {
   bool read_more;
   do {
-    if (incoming_->RemainingCapacity() == 0) {
-      incoming_->SetCapacity(incoming_->capacity() * 2);
-    }
-
     StatusOr<int> read_or =
-        tcp_->Read(incoming_.get(), incoming_->RemainingCapacity(),
-                   std::bind(&InternalResponse::OnReadCompleted, this,
-                             std::placeholders::_1));
+        tcp_->ReadV(&incoming_, kMaxReadBytes,
+                    std::bind(&InternalResponse::OnReadCompleted, this,
+                              std::placeholders::_1));
     if (read_or.status().IsTryAgain()) {
       return;
     }
@@ -86,68 +85,71 @@ bool InternalResponse::HandleReadResult(StatusOr<int> read_or) {
   size_t bytes = read_or.value();
 
   if (bytes > 0) {
-    size_t start_of_body = 0;
-    if (!parser_.Parse(Slice(incoming_->data(), bytes), &start_of_body)) {
-      Finish(Status::IOError("Failed to parse incomming data"));
-      return false;
-    }
-    if (start_of_body != 0) {
-      received_body_bytes_ = bytes - start_of_body;
+    // The parser copies what it keeps, so the segments are dropped afterwards
+    for (size_t i = 0; i < incoming_.num_segments(); ++i) {
+      Slice segment = incoming_.segment(i).slice();
+      bool had_all_headers = parser_.RecievedAllHeaders();
+      size_t start_of_body = 0;
+      if (!parser_.Parse(segment, &start_of_body)) {
+        Finish(Status::IOError("Failed to parse incomming data"));
+        return false;
+      }
+      if (had_all_headers) {
+        received_body_bytes_ += segment.size();
+      } else if (parser_.RecievedAllHeaders()) {
+        received_body_bytes_ = segment.size() - start_of_body;
+      }
     }
+    incoming_.Clear();
     if (parser_.RecievedAllHeaders()) {
       if (request_.content_length() == -1 ||
           received_body_bytes_ > request_.content_length()) {
-        SendResponse(HTTPResponse::BadRequest());
+        HTTPResponse response = HTTPResponse::BadRequest();
+        SendResponse(&response);
         return false;
       } else if (received_body_bytes_ == request_.content_length()) {
         HTTPResponse response;
         delegate_->OnHTTPRequest(request_, response);
-        SendResponse(response);
+        SendResponse(&response);
         return false;
       }
     }
   } else if (bytes == 0) {
-    SendResponse(HTTPResponse::BadRequest());
+    HTTPResponse response = HTTPResponse::BadRequest();
+    SendResponse(&response);
     return false;
   }
   return true;
 }
 
-void InternalResponse::DoWriteLoop() {
-  outgoint_->SetOffset(0);
-  while (outgoint_->BytesRemaining()) {
-    StatusOr<int> write_or =
-        tcp_->Write(outgoint_.get(), outgoint_->BytesRemaining(),
-                    std::bind(&InternalResponse::OnWriteCompleted, this,
-                              std::placeholders::_1));
-    if (write_or.ok()) {
-      outgoint_->DidConsume(write_or.value());
-      continue;
-    }
-    if (write_or.status().IsTryAgain()) {
-      return;
-    } else {
-      Finish(write_or.status());
-    }
-  }
-  if (outgoint_->BytesRemaining() == 0) {
-    Finish(Status());
-  }
-}
-
 void InternalResponse::OnWriteCompleted(StatusOr<int> write_or) {
-  if (write_or.ok()) {
-    DoWriteLoop();
-  } else {
-    Finish(write_or.status());
-  }
+  // Runs inside the write queue of |tcp_|, which must not be destroyed there
+  TaskRunner::Get()->PostTask(
+      std::bind(&InternalResponse::Finish, this, write_or.status()));
 }
 
-void InternalResponse::SendResponse(const HTTPResponse& response) {
-  std::string msg = response.ToString();
-  outgoint_ = MakeRefCounted<DrainableIOBuffer>(
-      MakeRefCounted<StringIOBuffer>(msg), msg.size());
-  DoWriteLoop();
+void InternalResponse::SendResponse(HTTPResponse* response) {
+  std::unique_ptr<std::string> body(new std::string);
+  body->swap(*response->mutable_body());
+  RefPtr<StringIOBuffer> headers =
+      MakeRefCounted<StringIOBuffer>(response->HeadersToString());
+  RefPtr<StringIOBuffer> body_buf =
+      MakeRefCounted<StringIOBuffer>(std::move(body));
+
+  // Completion is reported by the last write only
+  StatusOrIntCallback write_callback = std::bind(
+      &InternalResponse::OnWriteCompleted, this, std::placeholders::_1);
+  bool has_body = body_buf->size() > 0;
+  Status status =
+      tcp_->QueueWrite(RefSlice(headers, 0, headers->size()),
+                       has_body ? nullptr : write_callback);
+  if (status.ok() && has_body) {
+    status = tcp_->QueueWrite(RefSlice(body_buf, 0, body_buf->size()),
+                              write_callback);
+  }
+  if (!status.ok()) {
+    Finish(status);
+  }
 }
 
 void InternalResponse::Finish(Status status) {
@@ -171,8 +173,8 @@ HTTPServer::~HTTPServer() = default;
 void HTTPServer::DoAcceptLoop() {
   bool accept_more;
   do {
-    Status status = server_->Accept(
-        &accepted_socket_,
+    Status status = server_->AcceptMany(
+        kMaxAcceptBatch, &accepted_sockets_,
         std::bind(&HTTPServer::OnAcceptCompleted, this, std::placeholders::_1));
     if (status.ok()) {
       accept_more = HandleAcceptResult(status);
@@ -194,8 +196,10 @@ bool HTTPServer::HandleAcceptResult(Status status) {
   if (!status.ok()) {
     return false;
   }
-  InternalResponse* response =
-      new InternalResponse(std::move(accepted_socket_), delegate_);
+  for (std::unique_ptr<TCPClient>& socket : accepted_sockets_) {
+    new InternalResponse(std::move(socket), delegate_);
+  }
+  accepted_sockets_.clear();
   return true;
 }
 
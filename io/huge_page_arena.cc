@@ -0,0 +1,165 @@
+#include "io/huge_page_arena.h"
+
+#include <errno.h>
+#include <glog/logging.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include <algorithm>
+
+namespace iomgr {
+
+namespace {
+
+const size_t kAlignment = 16;
+
+}  // namespace
+
+HugePageArena::HugePageArena(size_t max_bytes)
+    : max_bytes_(max_bytes / kChunkSize * kChunkSize),
+      mutex_(),
+      chunks_(),
+      next_(nullptr),
+      end_(nullptr),
+      free_blocks_() {}
+
+HugePageArena::~HugePageArena() {
+  for (const Chunk& chunk : chunks_) {
+    munmap(chunk.base, kChunkSize);
+  }
+}
+
+void* HugePageArena::Alloc(size_t size) {
+  size = RoundUp(size);
+  if (size > kChunkSize) {
+    return nullptr;
+  }
+
+  MutexLock lock(&mutex_);
+  auto it = free_blocks_.find(size);
+  if (it != free_blocks_.end() && !it->second.empty()) {
+    void* block = it->second.back();
+    it->second.pop_back();
+    return block;
+  }
+
+  if (static_cast<size_t>(end_ - next_) < size) {
+    if ((chunks_.size() + 1) * kChunkSize > max_bytes_) {
+      return nullptr;
+    }
+    bool hugetlb = false;
+    char* base = MapChunk(&hugetlb);
+    if (!base) {
+      return nullptr;
+    }
+    // The tail of the previous chunk is given up
+    chunks_.push_back({base, hugetlb});
+    next_ = base;
+    end_ = base + kChunkSize;
+  }
+  void* block = next_;
+  next_ += size;
+  return block;
+}
+
+void HugePageArena::Free(void* block, size_t size) {
+  DCHECK(block);
+  MutexLock lock(&mutex_);
+  free_blocks_[RoundUp(size)].push_back(block);
+}
+
+HugePageArena::Stats HugePageArena::GetStats() const {
+  Stats stats;
+  stats.bytes_mapped = 0;
+  stats.bytes_hugetlb = 0;
+  {
+    MutexLock lock(&mutex_);
+    for (const Chunk& chunk : chunks_) {
+      stats.bytes_mapped += kChunkSize;
+      if (chunk.hugetlb) {
+        stats.bytes_hugetlb += kChunkSize;
+      }
+    }
+  }
+  stats.bytes_transparent = TransparentHugePageBytes();
+  return stats;
+}
+
+size_t HugePageArena::RoundUp(size_t size) {
+  return (size + kAlignment - 1) & ~(kAlignment - 1);
+}
+
+char* HugePageArena::MapChunk(bool* hugetlb) {
+  void* ptr = mmap(nullptr, kChunkSize, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (ptr != MAP_FAILED) {
+    *hugetlb = true;
+    return static_cast<char*>(ptr);
+  }
+
+  // No huge pages reserved. Map twice the size and keep an aligned chunk, so
+  // that transparent huge pages can back it.
+  ptr = mmap(nullptr, 2 * kChunkSize, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (ptr == MAP_FAILED) {
+    LOG(ERROR) << "Failed to map an arena chunk: " << strerror(errno);
+    return nullptr;
+  }
+  char* raw = static_cast<char*>(ptr);
+  uintptr_t aligned =
+      (reinterpret_cast<uintptr_t>(raw) + kChunkSize - 1) & ~(kChunkSize - 1);
+  char* base = reinterpret_cast<char*>(aligned);
+  if (base > raw) {
+    munmap(raw, base - raw);
+  }
+  munmap(base + kChunkSize, raw + 2 * kChunkSize - (base + kChunkSize));
+  // Fails harmlessly on kernels without transparent huge pages
+  madvise(base, kChunkSize, MADV_HUGEPAGE);
+  *hugetlb = false;
+  return base;
+}
+
+uint64_t HugePageArena::TransparentHugePageBytes() const {
+  std::vector<Chunk> chunks;
+  {
+    MutexLock lock(&mutex_);
+    chunks = chunks_;
+  }
+  if (chunks.empty()) {
+    return 0;
+  }
+
+  FILE* file = fopen("/proc/self/smaps", "r");
+  if (!file) {
+    return 0;
+  }
+  uint64_t total = 0;
+  // Bytes of the current mapping that belong to the arena. The kernel may
+  // merge chunks with each other, or with neighbouring mappings.
+  uint64_t overlap = 0;
+  char line[256];
+  while (fgets(line, sizeof(line), file)) {
+    unsigned long start;
+    unsigned long end;
+    unsigned long kb;
+    if (sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+      overlap = 0;
+      for (const Chunk& chunk : chunks) {
+        uintptr_t base = reinterpret_cast<uintptr_t>(chunk.base);
+        if (chunk.hugetlb || base + kChunkSize <= start || base >= end) {
+          continue;
+        }
+        overlap += std::min<uintptr_t>(base + kChunkSize, end) -
+                   std::max<uintptr_t>(base, start);
+      }
+    } else if (overlap != 0 &&
+               sscanf(line, "AnonHugePages: %lu kB", &kb) == 1) {
+      total += std::min<uint64_t>(kb * 1024, overlap);
+    }
+  }
+  fclose(file);
+  return total;
+}
+
+}  // namespace iomgr
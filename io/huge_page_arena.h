@@ -0,0 +1,75 @@
+#ifndef LIBIOMGR_IO_HUGE_PAGE_ARENA_H_
+#define LIBIOMGR_IO_HUGE_PAGE_ARENA_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <vector>
+
+#include "util/sync.h"
+
+namespace iomgr {
+
+// HugePageArena carves blocks out of 2 MB chunks aligned to huge pages, so
+// that buffers touched together share few TLB entries. A chunk is mapped with
+// MAP_HUGETLB when the system has huge pages reserved, and otherwise with
+// normal pages advised with MADV_HUGEPAGE, which transparent huge pages may
+// or may not back.
+//
+// Freed blocks are kept for allocations of the same size; the memory goes
+// back to the system only when the arena is destroyed.
+class HugePageArena {
+ public:
+  static const size_t kChunkSize = 2 << 20;
+
+  struct Stats {
+    // Bytes of all mapped chunks
+    uint64_t bytes_mapped;
+    // Bytes of chunks mapped with MAP_HUGETLB
+    uint64_t bytes_hugetlb;
+    // Bytes of the other chunks backed by transparent huge pages, as
+    // reported by /proc/self/smaps
+    uint64_t bytes_transparent;
+  };
+
+  // Maps no more than |max_bytes|, rounded down to whole chunks
+  explicit HugePageArena(size_t max_bytes);
+  ~HugePageArena();
+
+  HugePageArena(const HugePageArena&) = delete;
+  HugePageArena& operator=(const HugePageArena&) = delete;
+
+  // Returns a 16-byte aligned block of |size| bytes, or nullptr when
+  // |size| exceeds a chunk or the arena is full.
+  void* Alloc(size_t size);
+  // |size| must be the size passed to Alloc()
+  void Free(void* block, size_t size);
+
+  // Reads /proc/self/smaps for |bytes_transparent|, so it is not cheap
+  Stats GetStats() const;
+
+ private:
+  struct Chunk {
+    char* base;
+    bool hugetlb;
+  };
+
+  static size_t RoundUp(size_t size);
+  // Returns nullptr if the chunk could not be mapped at all
+  static char* MapChunk(bool* hugetlb);
+  uint64_t TransparentHugePageBytes() const;
+
+  const size_t max_bytes_;
+  mutable Mutex mutex_;
+  std::vector<Chunk> chunks_;
+  // Free space at the end of the last chunk
+  char* next_;
+  char* end_;
+  // Freed blocks by size
+  std::map<size_t, std::vector<void*>> free_blocks_;
+};
+
+}  // namespace iomgr
+
+#endif  // LIBIOMGR_IO_HUGE_PAGE_ARENA_H_
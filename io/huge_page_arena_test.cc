@@ -0,0 +1,64 @@
+#include "io/huge_page_arena.h"
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace iomgr {
+
+static const size_t kChunkSize = HugePageArena::kChunkSize;
+
+TEST(HugePageArena, Alloc) {
+  HugePageArena arena(4 << 20);
+  EXPECT_EQ(0u, arena.GetStats().bytes_mapped);
+
+  char* a = static_cast<char*>(arena.Alloc(100));
+  char* b = static_cast<char*>(arena.Alloc(100));
+  ASSERT_TRUE(a);
+  ASSERT_TRUE(b);
+  // Carved from one chunk aligned to a huge page
+  EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(a) % kChunkSize);
+  EXPECT_EQ(a + 112, b);
+  memset(a, 'x', 100);
+  memset(b, 'y', 100);
+  EXPECT_EQ(kChunkSize, arena.GetStats().bytes_mapped);
+}
+
+TEST(HugePageArena, ReuseFreedBlock) {
+  HugePageArena arena(2 << 20);
+  void* block = arena.Alloc(4096);
+  arena.Free(block, 4096);
+  EXPECT_NE(block, arena.Alloc(8192));
+  EXPECT_EQ(block, arena.Alloc(4096));
+}
+
+TEST(HugePageArena, Full) {
+  HugePageArena arena(2 << 20);
+  EXPECT_TRUE(arena.Alloc(1 << 20));
+  EXPECT_FALSE(arena.Alloc(kChunkSize + 1));
+  // The second block does not fit in what is left of the only chunk
+  EXPECT_FALSE(arena.Alloc((1 << 20) + 16));
+  EXPECT_EQ(kChunkSize, arena.GetStats().bytes_mapped);
+
+  HugePageArena empty(1 << 20);
+  EXPECT_FALSE(empty.Alloc(16));
+}
+
+TEST(HugePageArena, Stats) {
+  HugePageArena arena(8 << 20);
+  for (int i = 0; i < 4; ++i) {
+    memset(arena.Alloc(kChunkSize), 0, kChunkSize);
+  }
+  HugePageArena::Stats stats = arena.GetStats();
+  EXPECT_EQ(8u << 20, stats.bytes_mapped);
+  // How much is backed depends on the system, but never more than mapped
+  EXPECT_LE(stats.bytes_hugetlb + stats.bytes_transparent, stats.bytes_mapped);
+}
+
+}  // namespace iomgr
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -1,6 +1,14 @@
 #include "iomgr/io_buffer.h"
 
+#include <errno.h>
+#include <fcntl.h>
 #include <glog/logging.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "util/os_error.h"
+#include "util/scoped_fd.h"
 
 namespace iomgr {
 
@@ -92,4 +100,86 @@ WrappedIOBuffer::WrappedIOBuffer(const char* data)
 
 WrappedIOBuffer::~WrappedIOBuffer() { data_ = nullptr; }
 
+Status MappedFileIOBuffer::Map(const std::string& path, uint64_t offset,
+                               size_t length,
+                               RefPtr<MappedFileIOBuffer>* buffer) {
+  DCHECK(buffer);
+  ScopedFD fd(::open(path.c_str(), O_RDONLY | O_CLOEXEC));
+  if (fd < 0) {
+    return MapSystemError(errno);
+  }
+  struct stat st;
+  if (::fstat(fd, &st) < 0) {
+    return MapSystemError(errno);
+  }
+  uint64_t file_size = st.st_size;
+  if (offset > file_size || length > file_size - offset) {
+    return Status::OutOfRange("MAP PAST END OF FILE");
+  }
+  if (length == 0) {
+    length = file_size - offset;
+  }
+  if (length == 0) {
+    // mmap(2) refuses empty mappings
+    *buffer = AdoptRef(new MappedFileIOBuffer(nullptr, 0, nullptr, 0));
+    return Status::OK();
+  }
+
+  static const uint64_t kPageSize = sysconf(_SC_PAGESIZE);
+  uint64_t map_offset = offset & ~(kPageSize - 1);
+  size_t mapping_size = length + (offset - map_offset);
+  void* mapping = ::mmap(nullptr, mapping_size, PROT_READ, MAP_SHARED,
+                         fd, map_offset);
+  if (mapping == MAP_FAILED) {
+    return MapSystemError(errno);
+  }
+  // The mapping stays valid after the file is closed
+  char* data = static_cast<char*>(mapping) + (offset - map_offset);
+  *buffer =
+      AdoptRef(new MappedFileIOBuffer(mapping, mapping_size, data, length));
+  return Status::OK();
+}
+
+Status MappedFileIOBuffer::Advise(Advice advice) {
+  if (!mapping_) {
+    return Status::OK();
+  }
+  int flag = MADV_NORMAL;
+  switch (advice) {
+    case kNormal:
+      flag = MADV_NORMAL;
+      break;
+    case kSequential:
+      flag = MADV_SEQUENTIAL;
+      break;
+    case kRandom:
+      flag = MADV_RANDOM;
+      break;
+    case kWillNeed:
+      flag = MADV_WILLNEED;
+      break;
+    case kDontNeed:
+      flag = MADV_DONTNEED;
+      break;
+  }
+  if (::madvise(mapping_, mapping_size_, flag) < 0) {
+    return MapSystemError(errno);
+  }
+  return Status::OK();
+}
+
+MappedFileIOBuffer::MappedFileIOBuffer(void* mapping, size_t mapping_size,
+                                       char* data, size_t size)
+    : IOBufferWithSize(data, size),
+      mapping_(mapping),
+      mapping_size_(mapping_size) {}
+
+MappedFileIOBuffer::~MappedFileIOBuffer() {
+  // The data belongs to the mapping
+  data_ = nullptr;
+  if (mapping_) {
+    ::munmap(mapping_, mapping_size_);
+  }
+}
+
 }  // namespace iomgr
\ No newline at end of file
@@ -0,0 +1,122 @@
+#include "iomgr/io_buffer_chain.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+
+namespace iomgr {
+
+IOBufferChain::IOBufferChain() : segments_(), size_(0) {}
+
+IOBufferChain::~IOBufferChain() = default;
+
+IOBufferChain::IOBufferChain(IOBufferChain&& other)
+    : segments_(std::move(other.segments_)), size_(other.size_) {
+  other.segments_.clear();
+  other.size_ = 0;
+}
+
+IOBufferChain& IOBufferChain::operator=(IOBufferChain&& other) {
+  if (this != &other) {
+    segments_ = std::move(other.segments_);
+    size_ = other.size_;
+    other.segments_.clear();
+    other.size_ = 0;
+  }
+  return *this;
+}
+
+void IOBufferChain::Append(RefSlice slice) {
+  if (slice.empty()) {
+    return;
+  }
+  size_ += slice.size();
+  segments_.push_back(std::move(slice));
+}
+
+void IOBufferChain::Prepend(RefSlice slice) {
+  if (slice.empty()) {
+    return;
+  }
+  size_ += slice.size();
+  segments_.push_front(std::move(slice));
+}
+
+void IOBufferChain::Append(IOBufferChain* other) {
+  DCHECK(other);
+  DCHECK_NE(this, other);
+  if (segments_.empty()) {
+    segments_.swap(other->segments_);
+  } else {
+    for (RefSlice& segment : other->segments_) {
+      segments_.push_back(std::move(segment));
+    }
+    other->segments_.clear();
+  }
+  size_ += other->size_;
+  other->size_ = 0;
+}
+
+void IOBufferChain::Consume(size_t bytes) {
+  DCHECK_LE(bytes, size_);
+  size_ -= bytes;
+  while (bytes > 0) {
+    RefSlice& front = segments_.front();
+    if (bytes < front.size()) {
+      front.remove_prefix(bytes);
+      return;
+    }
+    bytes -= front.size();
+    segments_.pop_front();
+  }
+}
+
+void IOBufferChain::Split(size_t bytes, IOBufferChain* head) {
+  DCHECK(head);
+  DCHECK_NE(this, head);
+  DCHECK_LE(bytes, size_);
+  size_ -= bytes;
+  head->size_ += bytes;
+  while (bytes > 0) {
+    RefSlice& front = segments_.front();
+    if (bytes < front.size()) {
+      head->segments_.push_back(front.SubSlice(0, bytes));
+      front.remove_prefix(bytes);
+      return;
+    }
+    bytes -= front.size();
+    head->segments_.push_back(std::move(front));
+    segments_.pop_front();
+  }
+}
+
+void IOBufferChain::Clear() {
+  segments_.clear();
+  size_ = 0;
+}
+
+const RefSlice& IOBufferChain::segment(size_t i) const {
+  DCHECK_LT(i, segments_.size());
+  return segments_[i];
+}
+
+int IOBufferChain::FillIOVec(struct iovec* iov, int max_iov) const {
+  int count = std::min<size_t>(max_iov, segments_.size());
+  for (int i = 0; i < count; ++i) {
+    const RefSlice& segment = segments_[i];
+    iov[i].iov_base = const_cast<char*>(segment.data());
+    iov[i].iov_len = segment.size();
+  }
+  return count;
+}
+
+std::string IOBufferChain::ToString() const {
+  std::string ret;
+  ret.reserve(size_);
+  for (const RefSlice& segment : segments_) {
+    ret.append(segment.data(), segment.size());
+  }
+  return ret;
+}
+
+}  // namespace iomgr
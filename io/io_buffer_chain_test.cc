@@ -0,0 +1,143 @@
+#include "iomgr/io_buffer_chain.h"
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace iomgr {
+
+namespace {
+
+RefPtr<IOBuffer> MakeBuffer(const std::string& s) {
+  return MakeRefCounted<StringIOBuffer>(s);
+}
+
+}  // namespace
+
+TEST(IOBufferChain, Empty) {
+  IOBufferChain chain;
+  EXPECT_TRUE(chain.empty());
+  EXPECT_EQ(0u, chain.size());
+  EXPECT_EQ(0u, chain.num_segments());
+  EXPECT_EQ("", chain.ToString());
+
+  chain.Append(MakeBuffer("abc"), 1, 0);
+  EXPECT_TRUE(chain.empty());
+  EXPECT_EQ(0u, chain.num_segments());
+}
+
+TEST(IOBufferChain, AppendPrepend) {
+  IOBufferChain chain;
+  chain.Append(MakeBuffer("hello"), 0, 5);
+  chain.Append(MakeBuffer("--world--"), 2, 5);
+  chain.Prepend(MakeBuffer(">> "), 0, 3);
+  EXPECT_EQ(13u, chain.size());
+  EXPECT_EQ(3u, chain.num_segments());
+  EXPECT_EQ(">> helloworld", chain.ToString());
+  EXPECT_EQ("world", chain.segment(2).ToString());
+}
+
+TEST(IOBufferChain, SharesBuffer) {
+  RefPtr<IOBuffer> buffer = MakeBuffer("abcdef");
+  IOBufferChain chain;
+  chain.Append(buffer, 0, 3);
+  chain.Append(buffer, 3, 3);
+  EXPECT_EQ(buffer->data(), chain.segment(0).data());
+  EXPECT_EQ(buffer->data() + 3, chain.segment(1).data());
+  EXPECT_EQ("abcdef", chain.ToString());
+}
+
+TEST(IOBufferChain, AppendChain) {
+  IOBufferChain a;
+  a.Append(MakeBuffer("foo"), 0, 3);
+  IOBufferChain b;
+  b.Append(MakeBuffer("bar"), 0, 3);
+  b.Append(MakeBuffer("baz"), 0, 3);
+
+  a.Append(&b);
+  EXPECT_TRUE(b.empty());
+  EXPECT_EQ(0u, b.num_segments());
+  EXPECT_EQ(9u, a.size());
+  EXPECT_EQ("foobarbaz", a.ToString());
+
+  IOBufferChain c;
+  c.Append(&a);
+  EXPECT_TRUE(a.empty());
+  EXPECT_EQ("foobarbaz", c.ToString());
+}
+
+TEST(IOBufferChain, Consume) {
+  IOBufferChain chain;
+  chain.Append(MakeBuffer("abc"), 0, 3);
+  chain.Append(MakeBuffer("defg"), 0, 4);
+
+  chain.Consume(0);
+  EXPECT_EQ("abcdefg", chain.ToString());
+  chain.Consume(2);
+  EXPECT_EQ(2u, chain.num_segments());
+  EXPECT_EQ("cdefg", chain.ToString());
+  chain.Consume(1);
+  EXPECT_EQ(1u, chain.num_segments());
+  EXPECT_EQ("defg", chain.ToString());
+  chain.Consume(4);
+  EXPECT_TRUE(chain.empty());
+  EXPECT_EQ(0u, chain.num_segments());
+}
+
+TEST(IOBufferChain, Split) {
+  IOBufferChain chain;
+  chain.Append(MakeBuffer("abc"), 0, 3);
+  chain.Append(MakeBuffer("defg"), 0, 4);
+
+  IOBufferChain head;
+  chain.Split(5, &head);
+  EXPECT_EQ("abcde", head.ToString());
+  EXPECT_EQ(2u, head.num_segments());
+  EXPECT_EQ("fg", chain.ToString());
+  EXPECT_EQ(1u, chain.num_segments());
+  // The straddling segment is shared, not copied
+  EXPECT_EQ(head.segment(1).data() + 2, chain.segment(0).data());
+
+  chain.Split(2, &head);
+  EXPECT_EQ("abcdefg", head.ToString());
+  EXPECT_TRUE(chain.empty());
+}
+
+TEST(IOBufferChain, FillIOVec) {
+  IOBufferChain chain;
+  chain.Append(MakeBuffer("abc"), 1, 2);
+  chain.Append(MakeBuffer("defg"), 0, 4);
+  chain.Append(MakeBuffer("h"), 0, 1);
+
+  struct iovec iov[2];
+  ASSERT_EQ(2, chain.FillIOVec(iov, 2));
+  EXPECT_EQ("bc", std::string(static_cast<char*>(iov[0].iov_base),
+                              iov[0].iov_len));
+  EXPECT_EQ("defg", std::string(static_cast<char*>(iov[1].iov_base),
+                                iov[1].iov_len));
+
+  chain.Consume(6);
+  ASSERT_EQ(1, chain.FillIOVec(iov, 2));
+  EXPECT_EQ("h", std::string(static_cast<char*>(iov[0].iov_base),
+                             iov[0].iov_len));
+}
+
+TEST(IOBufferChain, Move) {
+  IOBufferChain chain;
+  chain.Append(MakeBuffer("abc"), 0, 3);
+  IOBufferChain moved(std::move(chain));
+  EXPECT_TRUE(chain.empty());
+  EXPECT_EQ("abc", moved.ToString());
+
+  chain = std::move(moved);
+  EXPECT_TRUE(moved.empty());
+  EXPECT_EQ("abc", chain.ToString());
+}
+
+}  // namespace iomgr
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
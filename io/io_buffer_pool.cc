@@ -0,0 +1,365 @@
+#include "iomgr/io_buffer_pool.h"
+
+#include <glog/logging.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <new>
+#include <vector>
+
+#include "io/huge_page_arena.h"
+#include "iomgr/resource_quota.h"
+#include "util/sync.h"
+
+namespace iomgr {
+
+namespace {
+
+// Every block starts with a header recording its size class and where it
+// came from, followed by the PooledIOBuffer object and then by the data.
+struct BlockHeader {
+  int size_class;
+  bool in_arena;
+};
+
+const size_t kBlockAlignment = 16;
+const size_t kHeaderSize =
+    (sizeof(BlockHeader) + kBlockAlignment - 1) & ~(kBlockAlignment - 1);
+
+// Bytes a thread keeps cached per size class. The shared free list of a size
+// class holds up to |kSharedCacheFactor| times as much.
+const size_t kThreadCacheBytes = 256 * 1024;
+const size_t kSharedCacheFactor = 8;
+
+size_t ThreadCacheCapacity(size_t buffer_size) {
+  return std::max<size_t>(2, kThreadCacheBytes / buffer_size);
+}
+
+// Adds |value| to a counter that only the calling thread writes, without the
+// cost of an atomic read-modify-write.
+template <typename T>
+void AddOwned(std::atomic<T>* counter, T value) {
+  counter->store(counter->load(std::memory_order_relaxed) + value,
+                 std::memory_order_relaxed);
+}
+
+}  // namespace
+
+class IOBufferPool::PooledIOBuffer : public IOBufferWithSize {
+ public:
+  PooledIOBuffer(char* data, size_t size, ResourceUser* user, size_t charged)
+      : IOBufferWithSize(data, size), user_(user), charged_(charged) {
+    if (user_) {
+      user_->Charge(charged_);
+    }
+  }
+
+  // Called by the deleting destructor once the last reference is released.
+  // Returns the whole block to the pool instead of freeing it.
+  static void operator delete(void* ptr) {
+    char* block = static_cast<char*>(ptr) - kHeaderSize;
+    int size_class = reinterpret_cast<BlockHeader*>(block)->size_class;
+    IOBufferPool::Get()->FreeBlock(block, size_class);
+  }
+
+ private:
+  ~PooledIOBuffer() override {
+    // The data belongs to the block
+    data_ = nullptr;
+    if (user_) {
+      user_->Uncharge(charged_);
+    }
+  }
+
+  RefPtr<ResourceUser> user_;
+  size_t charged_;
+};
+
+// A buffer above the largest size class, allocated directly but still
+// charged to a ResourceUser.
+class IOBufferPool::LargeIOBuffer : public IOBufferWithSize {
+ public:
+  LargeIOBuffer(size_t size, ResourceUser* user)
+      : IOBufferWithSize(size), user_(user) {
+    user_->Charge(size_);
+  }
+
+ private:
+  ~LargeIOBuffer() override { user_->Uncharge(size_); }
+
+  RefPtr<ResourceUser> user_;
+};
+
+struct IOBufferPool::FreeList {
+  Mutex mutex;
+  std::vector<void*> blocks;
+};
+
+struct IOBufferPool::ThreadCache {
+  ThreadCache() : hits(0), bytes_in_use(0) {}
+
+  std::vector<void*> blocks[kNumSizeClasses];
+  // Written by the owning thread only, read by GetStats()
+  std::atomic<uint64_t> hits;
+  std::atomic<int64_t> bytes_in_use;
+};
+
+struct IOBufferPool::ThreadCacheList {
+  Mutex mutex;
+  std::vector<ThreadCache*> caches;
+};
+
+IOBufferPool* IOBufferPool::Get() {
+  // Leaked on purpose, see the comment in the header.
+  static IOBufferPool* s_pool = new IOBufferPool;
+  return s_pool;
+}
+
+IOBufferPool::IOBufferPool()
+    : free_lists_(new FreeList[kNumSizeClasses]),
+      thread_caches_(new ThreadCacheList),
+      hits_(0),
+      misses_(0),
+      bytes_in_use_(0),
+      bytes_allocated_(0),
+      arena_(nullptr) {}
+
+IOBufferPool::~IOBufferPool() = default;
+
+RefPtr<IOBufferWithSize> IOBufferPool::Alloc(size_t size) {
+  return Alloc(size, nullptr);
+}
+
+RefPtr<IOBufferWithSize> IOBufferPool::Alloc(size_t size, ResourceUser* user) {
+  if (size > kMaxBufferSize) {
+    if (user) {
+      return MakeRefCounted<LargeIOBuffer>(size, user);
+    }
+    return MakeRefCounted<IOBufferWithSize>(size);
+  }
+  int size_class = SizeClass(size);
+  char* block = static_cast<char*>(AllocBlock(size_class));
+  reinterpret_cast<BlockHeader*>(block)->size_class = size_class;
+  char* data = block + kHeaderSize + ObjectSize();
+  // The whole data area of the block is charged, not just |size|
+  return RefPtr<IOBufferWithSize>(
+      ::new (block + kHeaderSize)
+          PooledIOBuffer(data, size, user, kMinBufferSize << size_class));
+}
+
+IOBufferPool::Stats IOBufferPool::GetStats() const {
+  Stats stats;
+  stats.hits = hits_.load(std::memory_order_relaxed);
+  stats.misses = misses_.load(std::memory_order_relaxed);
+  int64_t in_use = bytes_in_use_.load(std::memory_order_relaxed);
+  {
+    MutexLock lock(&thread_caches_->mutex);
+    for (ThreadCache* cache : thread_caches_->caches) {
+      stats.hits += cache->hits.load(std::memory_order_relaxed);
+      in_use += cache->bytes_in_use.load(std::memory_order_relaxed);
+    }
+  }
+  uint64_t allocated = bytes_allocated_.load(std::memory_order_relaxed);
+  // The counters are not read atomically together
+  stats.bytes_in_use = std::max<int64_t>(in_use, 0);
+  stats.bytes_cached =
+      allocated > stats.bytes_in_use ? allocated - stats.bytes_in_use : 0;
+
+  stats.bytes_in_arena = 0;
+  stats.bytes_huge_page_backed = 0;
+  HugePageArena* arena = arena_.load(std::memory_order_acquire);
+  if (arena) {
+    HugePageArena::Stats arena_stats = arena->GetStats();
+    stats.bytes_in_arena = arena_stats.bytes_mapped;
+    stats.bytes_huge_page_backed =
+        arena_stats.bytes_hugetlb + arena_stats.bytes_transparent;
+  }
+  return stats;
+}
+
+void IOBufferPool::UseHugePageArena(size_t max_bytes) {
+  HugePageArena* arena = new HugePageArena(max_bytes);
+  HugePageArena* expected = nullptr;
+  if (!arena_.compare_exchange_strong(expected, arena,
+                                      std::memory_order_acq_rel)) {
+    delete arena;
+  }
+}
+
+void IOBufferPool::Trim() {
+  ThreadCache* cache = GetThreadCache();
+  for (int i = 0; i < kNumSizeClasses; ++i) {
+    std::vector<void*> blocks;
+    if (cache) {
+      blocks.swap(cache->blocks[i]);
+    }
+    {
+      MutexLock lock(&free_lists_[i].mutex);
+      blocks.insert(blocks.end(), free_lists_[i].blocks.begin(),
+                    free_lists_[i].blocks.end());
+      free_lists_[i].blocks.clear();
+      free_lists_[i].blocks.shrink_to_fit();
+    }
+    for (void* block : blocks) {
+      FreeToSystem(block, i);
+    }
+  }
+}
+
+int IOBufferPool::SizeClass(size_t size) {
+  int size_class = 0;
+  while ((kMinBufferSize << size_class) < size) {
+    ++size_class;
+  }
+  DCHECK_LT(size_class, kNumSizeClasses);
+  return size_class;
+}
+
+size_t IOBufferPool::BlockSize(int size_class) {
+  return kHeaderSize + ObjectSize() + (kMinBufferSize << size_class);
+}
+
+size_t IOBufferPool::ObjectSize() {
+  return (sizeof(PooledIOBuffer) + kBlockAlignment - 1) &
+         ~(kBlockAlignment - 1);
+}
+
+IOBufferPool::ThreadCache* IOBufferPool::GetThreadCache() {
+  // Plain values, so that they can still be read when buffers are released
+  // by thread_local destructors running after |reaper|.
+  static thread_local ThreadCache* cache = nullptr;
+  static thread_local bool exited = false;
+
+  // Hands the cached blocks of an exiting thread over to the shared lists.
+  struct Reaper {
+    ~Reaper() {
+      ThreadCache* dying = cache;
+      cache = nullptr;
+      exited = true;
+      Get()->RemoveThreadCache(dying);
+      delete dying;
+    }
+  };
+
+  if (cache == nullptr && !exited) {
+    cache = new ThreadCache;
+    Get()->AddThreadCache(cache);
+    static thread_local Reaper reaper;
+  }
+  return cache;
+}
+
+void* IOBufferPool::AllocBlock(int size_class) {
+  int64_t block_size = BlockSize(size_class);
+  ThreadCache* cache = GetThreadCache();
+  if (cache) {
+    AddOwned(&cache->bytes_in_use, block_size);
+    if (!cache->blocks[size_class].empty()) {
+      AddOwned<uint64_t>(&cache->hits, 1);
+      void* block = cache->blocks[size_class].back();
+      cache->blocks[size_class].pop_back();
+      return block;
+    }
+  } else {
+    bytes_in_use_.fetch_add(block_size, std::memory_order_relaxed);
+  }
+
+  void* block = nullptr;
+  {
+    FreeList* free_list = &free_lists_[size_class];
+    MutexLock lock(&free_list->mutex);
+    if (!free_list->blocks.empty()) {
+      block = free_list->blocks.back();
+      free_list->blocks.pop_back();
+    }
+  }
+  if (block) {
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    return block;
+  }
+
+  misses_.fetch_add(1, std::memory_order_relaxed);
+  bytes_allocated_.fetch_add(block_size, std::memory_order_relaxed);
+  HugePageArena* arena = arena_.load(std::memory_order_acquire);
+  if (arena) {
+    block = arena->Alloc(block_size);
+    if (block) {
+      static_cast<BlockHeader*>(block)->in_arena = true;
+      return block;
+    }
+  }
+  block = malloc(block_size);
+  CHECK(block) << "Out of memory";
+  static_cast<BlockHeader*>(block)->in_arena = false;
+  return block;
+}
+
+void IOBufferPool::FreeBlock(void* block, int size_class) {
+  int64_t block_size = BlockSize(size_class);
+  size_t capacity = ThreadCacheCapacity(kMinBufferSize << size_class);
+  ThreadCache* cache = GetThreadCache();
+  if (cache) {
+    AddOwned(&cache->bytes_in_use, -block_size);
+    if (cache->blocks[size_class].size() < capacity) {
+      cache->blocks[size_class].push_back(block);
+      return;
+    }
+  } else {
+    bytes_in_use_.fetch_sub(block_size, std::memory_order_relaxed);
+  }
+  {
+    FreeList* free_list = &free_lists_[size_class];
+    MutexLock lock(&free_list->mutex);
+    if (free_list->blocks.size() < capacity * kSharedCacheFactor) {
+      free_list->blocks.push_back(block);
+      return;
+    }
+  }
+  FreeToSystem(block, size_class);
+}
+
+void IOBufferPool::FreeToSystem(void* block, int size_class) {
+  size_t block_size = BlockSize(size_class);
+  bytes_allocated_.fetch_sub(block_size, std::memory_order_relaxed);
+  if (static_cast<BlockHeader*>(block)->in_arena) {
+    // Kept by the arena for the next block of this size
+    arena_.load(std::memory_order_relaxed)->Free(block, block_size);
+    return;
+  }
+  free(block);
+}
+
+void IOBufferPool::AddThreadCache(ThreadCache* cache) {
+  MutexLock lock(&thread_caches_->mutex);
+  thread_caches_->caches.push_back(cache);
+}
+
+void IOBufferPool::RemoveThreadCache(ThreadCache* cache) {
+  {
+    MutexLock lock(&thread_caches_->mutex);
+    std::vector<ThreadCache*>* caches = &thread_caches_->caches;
+    caches->erase(std::find(caches->begin(), caches->end(), cache));
+    hits_.fetch_add(cache->hits.load(std::memory_order_relaxed),
+                    std::memory_order_relaxed);
+    bytes_in_use_.fetch_add(cache->bytes_in_use.load(std::memory_order_relaxed),
+                            std::memory_order_relaxed);
+  }
+  for (int i = 0; i < kNumSizeClasses; ++i) {
+    size_t capacity =
+        ThreadCacheCapacity(kMinBufferSize << i) * kSharedCacheFactor;
+    std::vector<void*>* blocks = &cache->blocks[i];
+    {
+      MutexLock lock(&free_lists_[i].mutex);
+      while (!blocks->empty() && free_lists_[i].blocks.size() < capacity) {
+        free_lists_[i].blocks.push_back(blocks->back());
+        blocks->pop_back();
+      }
+    }
+    for (void* block : *blocks) {
+      FreeToSystem(block, i);
+    }
+    blocks->clear();
+  }
+}
+
+}  // namespace iomgr
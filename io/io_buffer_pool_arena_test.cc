@@ -0,0 +1,44 @@
+#include "iomgr/io_buffer_pool.h"
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include <vector>
+
+namespace iomgr {
+
+// The arena stays for the rest of the process once enabled, so this test has
+// a process of its own
+TEST(IOBufferPool, HugePageArena) {
+  IOBufferPool* pool = IOBufferPool::Get();
+  EXPECT_EQ(0u, pool->GetStats().bytes_in_arena);
+  pool->Trim();
+  pool->UseHugePageArena(4 << 20);
+
+  RefPtr<IOBufferWithSize> buf = pool->Alloc(64 * 1024);
+  memset(buf->data(), 'x', buf->size());
+  IOBufferPool::Stats stats = pool->GetStats();
+  EXPECT_EQ(2u << 20, stats.bytes_in_arena);
+  EXPECT_LE(stats.bytes_huge_page_backed, stats.bytes_in_arena);
+
+  // Blocks trimmed back to the arena are reused
+  char* data = buf->data();
+  buf = nullptr;
+  pool->Trim();
+  EXPECT_EQ(data, pool->Alloc(64 * 1024)->data());
+
+  // Beyond the arena, blocks come from malloc
+  std::vector<RefPtr<IOBufferWithSize>> bufs;
+  for (int i = 0; i < 8; ++i) {
+    bufs.push_back(pool->Alloc(1 << 20));
+  }
+  EXPECT_EQ(4u << 20, pool->GetStats().bytes_in_arena);
+}
+
+}  // namespace iomgr
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
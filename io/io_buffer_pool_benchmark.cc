@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "iomgr/io_buffer_pool.h"
+#include "iomgr/time.h"
+
+namespace iomgr {
+
+static const int kIterations = 1000 * 1000;
+// Buffers kept alive at once, like reads in flight on many connections
+static const int kInFlight = 64;
+
+template <typename Allocate>
+void Measure(const char* name, int num_threads, Allocate allocate) {
+  Time start = Time::Now();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&allocate]() {
+      std::vector<RefPtr<IOBufferWithSize>> in_flight(kInFlight);
+      for (int i = 0; i < kIterations; ++i) {
+        in_flight[i % kInFlight] = allocate();
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  Time::Delta elapsed = Time::Now() - start;
+  printf("%-12s %d threads %8.1f ns/alloc\n", name, num_threads,
+         elapsed.ToMicroseconds() * 1000.0 / kIterations);
+}
+
+// A proxy moving large transfers through many buffers: each buffer is filled
+// and then read back, in an order unrelated to where the buffers live.
+void MeasureTransfer(const char* name) {
+  const size_t kBufferSize = 64 * 1024;
+  const int kBuffers = 2048;
+  const int kRounds = 20;
+
+  std::vector<RefPtr<IOBufferWithSize>> buffers;
+  for (int i = 0; i < kBuffers; ++i) {
+    buffers.push_back(IOBufferPool::Get()->Alloc(kBufferSize));
+  }
+  std::vector<int> order(kBuffers);
+  for (int i = 0; i < kBuffers; ++i) {
+    order[i] = i;
+  }
+  std::shuffle(order.begin(), order.end(), std::mt19937(0));
+  std::vector<char> source(kBufferSize, 'x');
+
+  uint64_t sum = 0;
+  Time start = Time::Now();
+  for (int round = 0; round < kRounds; ++round) {
+    for (int i : order) {
+      char* data = buffers[i]->data();
+      memcpy(data, source.data(), kBufferSize);
+      // Touch every 64th byte, as a parser skimming the data would
+      for (size_t j = 0; j < kBufferSize; j += 64) {
+        sum += data[j];
+      }
+    }
+  }
+  Time::Delta elapsed = Time::Now() - start;
+  double bytes = static_cast<double>(kBufferSize) * kBuffers * kRounds;
+  IOBufferPool::Stats stats = IOBufferPool::Get()->GetStats();
+  printf("%-12s %8.1f MB/s, %lu of %lu arena bytes on huge pages (%lu)\n",
+         name, bytes / elapsed.ToMicroseconds(),
+         static_cast<unsigned long>(stats.bytes_huge_page_backed),
+         static_cast<unsigned long>(stats.bytes_in_arena),
+         static_cast<unsigned long>(sum % 10));
+}
+
+}  // namespace iomgr
+
+int main(int argc, char** argv) {
+  using iomgr::IOBufferPool;
+  using iomgr::IOBufferWithSize;
+  using iomgr::MakeRefCounted;
+
+  for (size_t size = 256; size <= 64 * 1024; size *= 16) {
+    printf("buffer size %zu\n", size);
+    for (int threads = 1; threads <= 4; threads *= 4) {
+      iomgr::Measure("malloc", threads, [size]() {
+        return MakeRefCounted<IOBufferWithSize>(size);
+      });
+      iomgr::Measure("pool", threads,
+                     [size]() { return IOBufferPool::Get()->Alloc(size); });
+    }
+  }
+  IOBufferPool::Stats stats = IOBufferPool::Get()->GetStats();
+  printf("pool hits %lu misses %lu cached %lu bytes\n",
+         static_cast<unsigned long>(stats.hits),
+         static_cast<unsigned long>(stats.misses),
+         static_cast<unsigned long>(stats.bytes_cached));
+
+  printf("large transfer\n");
+  IOBufferPool::Get()->Trim();
+  iomgr::MeasureTransfer("pool");
+  IOBufferPool::Get()->Trim();
+  IOBufferPool::Get()->UseHugePageArena(256 << 20);
+  iomgr::MeasureTransfer("pool+arena");
+  return 0;
+}
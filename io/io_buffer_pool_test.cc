@@ -0,0 +1,71 @@
+#include "iomgr/io_buffer_pool.h"
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include <thread>
+
+namespace iomgr {
+
+TEST(IOBufferPool, Alloc) {
+  RefPtr<IOBufferWithSize> buf = IOBufferPool::Get()->Alloc(1000);
+  ASSERT_TRUE(buf);
+  EXPECT_EQ(1000u, buf->size());
+  memset(buf->data(), 'x', buf->size());
+}
+
+TEST(IOBufferPool, ReuseReleasedBuffer) {
+  IOBufferPool* pool = IOBufferPool::Get();
+  char* data = pool->Alloc(4096)->data();
+
+  IOBufferPool::Stats before = pool->GetStats();
+  RefPtr<IOBufferWithSize> buf = pool->Alloc(4000);
+  IOBufferPool::Stats after = pool->GetStats();
+  // The same size class is served from the thread cache
+  EXPECT_EQ(data, buf->data());
+  EXPECT_EQ(before.hits + 1, after.hits);
+  EXPECT_EQ(before.misses, after.misses);
+  EXPECT_GT(after.bytes_in_use, before.bytes_in_use);
+}
+
+TEST(IOBufferPool, Oversized) {
+  IOBufferPool* pool = IOBufferPool::Get();
+  IOBufferPool::Stats before = pool->GetStats();
+  RefPtr<IOBufferWithSize> buf =
+      pool->Alloc(IOBufferPool::kMaxBufferSize + 1);
+  EXPECT_EQ(IOBufferPool::kMaxBufferSize + 1, buf->size());
+  buf = nullptr;
+  IOBufferPool::Stats after = pool->GetStats();
+  EXPECT_EQ(before.hits, after.hits);
+  EXPECT_EQ(before.misses, after.misses);
+  EXPECT_EQ(before.bytes_cached, after.bytes_cached);
+}
+
+TEST(IOBufferPool, ReleaseOnAnotherThread) {
+  IOBufferPool* pool = IOBufferPool::Get();
+  RefPtr<IOBufferWithSize> buf = pool->Alloc(256);
+  std::thread releaser([&buf]() { buf = nullptr; });
+  releaser.join();
+  EXPECT_FALSE(buf);
+  // The exiting thread handed its cache over to the shared free list
+  IOBufferPool::Stats before = pool->GetStats();
+  std::thread allocator([pool]() { pool->Alloc(256); });
+  allocator.join();
+  EXPECT_EQ(before.hits + 1, pool->GetStats().hits);
+}
+
+TEST(IOBufferPool, Trim) {
+  IOBufferPool* pool = IOBufferPool::Get();
+  pool->Alloc(64 * 1024);
+  EXPECT_GT(pool->GetStats().bytes_cached, 0u);
+  pool->Trim();
+  EXPECT_EQ(0u, pool->GetStats().bytes_cached);
+}
+
+}  // namespace iomgr
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,96 @@
+#include "iomgr/io_buffer.h"
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+
+namespace iomgr {
+
+class MappedFileIOBufferTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    char path[] = "/tmp/mapped_file_io_buffer_XXXXXX";
+    fd_ = ::mkstemp(path);
+    ASSERT_GE(fd_, 0);
+    path_ = path;
+    for (int i = 0; i < 3 * 4096; ++i) {
+      content_.push_back('a' + i % 26);
+    }
+    ASSERT_EQ(static_cast<ssize_t>(content_.size()),
+              ::write(fd_, content_.data(), content_.size()));
+  }
+
+  void TearDown() override {
+    ::close(fd_);
+    ::unlink(path_.c_str());
+  }
+
+  int fd_;
+  std::string path_;
+  std::string content_;
+};
+
+TEST_F(MappedFileIOBufferTest, MapWholeFile) {
+  RefPtr<MappedFileIOBuffer> buffer;
+  ASSERT_TRUE(MappedFileIOBuffer::Map(path_, 0, 0, &buffer).ok());
+  ASSERT_EQ(content_.size(), buffer->size());
+  EXPECT_EQ(content_, std::string(buffer->data(), buffer->size()));
+  EXPECT_TRUE(buffer->Advise(MappedFileIOBuffer::kSequential).ok());
+  EXPECT_TRUE(buffer->Advise(MappedFileIOBuffer::kWillNeed).ok());
+}
+
+TEST_F(MappedFileIOBufferTest, MapUnalignedRange) {
+  RefPtr<MappedFileIOBuffer> buffer;
+  ASSERT_TRUE(MappedFileIOBuffer::Map(path_, 4000, 5000, &buffer).ok());
+  ASSERT_EQ(5000u, buffer->size());
+  EXPECT_EQ(content_.substr(4000, 5000),
+            std::string(buffer->data(), buffer->size()));
+
+  ASSERT_TRUE(MappedFileIOBuffer::Map(path_, 5000, 0, &buffer).ok());
+  EXPECT_EQ(content_.substr(5000),
+            std::string(buffer->data(), buffer->size()));
+}
+
+TEST_F(MappedFileIOBufferTest, MapPastEnd) {
+  RefPtr<MappedFileIOBuffer> buffer;
+  EXPECT_TRUE(
+      MappedFileIOBuffer::Map(path_, 0, content_.size() + 1, &buffer)
+          .IsOutOfRange());
+  EXPECT_TRUE(MappedFileIOBuffer::Map(path_, content_.size() + 1, 0, &buffer)
+                  .IsOutOfRange());
+  EXPECT_FALSE(buffer);
+
+  // Mapping the end of the file gives an empty buffer
+  ASSERT_TRUE(
+      MappedFileIOBuffer::Map(path_, content_.size(), 0, &buffer).ok());
+  EXPECT_EQ(0u, buffer->size());
+  EXPECT_TRUE(buffer->Advise(MappedFileIOBuffer::kDontNeed).ok());
+}
+
+TEST_F(MappedFileIOBufferTest, MapMissingFile) {
+  RefPtr<MappedFileIOBuffer> buffer;
+  EXPECT_FALSE(
+      MappedFileIOBuffer::Map(path_ + ".missing", 0, 0, &buffer).ok());
+  EXPECT_FALSE(buffer);
+}
+
+TEST_F(MappedFileIOBufferTest, SharesPageCache) {
+  RefPtr<MappedFileIOBuffer> a;
+  RefPtr<MappedFileIOBuffer> b;
+  ASSERT_TRUE(MappedFileIOBuffer::Map(path_, 0, 0, &a).ok());
+  ASSERT_TRUE(MappedFileIOBuffer::Map(path_, 4096, 4096, &b).ok());
+  // Both map the pages the file was written to
+  ASSERT_EQ(1, ::pwrite(fd_, "!", 1, 4096));
+  EXPECT_EQ('!', a->data()[4096]);
+  EXPECT_EQ('!', b->data()[0]);
+}
+
+}  // namespace iomgr
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
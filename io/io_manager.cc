@@ -5,6 +5,7 @@
 #include "threading/task_handle.h"
 #include "threading/task_runner.h"
 #include "threading/thread.h"
+#include "timer/clock.h"
 #include "timer/timer_manager.h"
 
 namespace iomgr {
@@ -35,18 +36,43 @@ class WakeupWatcher : public IOWatcher {
 };
 
 IOManager* IOManager::Get() {
+  // The poll thread posts to the TaskRunner until the IOManager is destroyed,
+  // so the TaskRunner has to be constructed first to be destroyed last.
+  TaskRunner::Get();
   static IOManager s_iomgr;
   return &s_iomgr;
 }
 
+IOManager* IOManager::Get(size_t index) {
+  if (index == 0) {
+    return Get();
+  }
+  // Constructed after the global IOManager, and its TaskRunner, to be
+  // destroyed before them.
+  Get();
+  static Mutex s_mutex;
+  static std::vector<std::unique_ptr<IOManager>> s_iomgrs;
+  MutexLock lock(&s_mutex);
+  if (s_iomgrs.size() < index) {
+    s_iomgrs.resize(index);
+  }
+  if (!s_iomgrs[index - 1]) {
+    s_iomgrs[index - 1].reset(new IOManager);
+  }
+  return s_iomgrs[index - 1].get();
+}
+
 IOManager::IOManager()
     : mutex_(),
       stopped_(false),
       poller_(kMaxPollEvents),
       wakeup_fd_(-1),
       fd_controllers_(),
+      timer_manager_(this),
       poll_thread_(),
-      wakeup_controller_() {
+      wakeup_controller_(),
+      wakeups_per_second_(0),
+      loop_time_us_(0) {
   StatusOr<int> eventfd = FileOp::eventfd(0, /* non_blocking */ true);
   DCHECK(eventfd.ok());
   wakeup_fd_.reset(eventfd.value());
@@ -73,13 +99,19 @@ bool IOManager::WatchFileDescriptor(int fd, int mode, IOWatcher* watcher,
   DCHECK(watcher);
   DCHECK(controller);
   DCHECK(mode == IOWatcher::kWatchRead || mode == IOWatcher::kWatchWrite ||
-         mode == IOWatcher::kWatchReadWrite);
+         mode == IOWatcher::kWatchReadWrite ||
+         mode == (IOWatcher::kWatchRead | IOWatcher::kWatchExclusive) ||
+         mode == IOWatcher::kWatchError);
 
   MutexLock lock(&mutex_);
   if (controller->fd() != -1 && controller->fd() != fd) {
     LOG(ERROR) << "Cannot use the same IOWatchController on two different FDs";
     return false;
   }
+  if (controller->iomgr_ && controller->iomgr_ != this) {
+    LOG(ERROR) << "Cannot use the same IOWatchController on two IOManagers";
+    return false;
+  }
 
   StopWatchingFileDescriptorNoLock(controller);
 
@@ -101,6 +133,7 @@ bool IOManager::WatchFileDescriptor(int fd, int mode, IOWatcher* watcher,
   controller->fd_ = fd;
   controller->mode_ = mode;
   controller->watcher_ = watcher;
+  controller->iomgr_ = this;
   fd_ctrl->mode |= mode;
   fd_ctrl->controllers.push_back(controller);
   return true;
@@ -118,9 +151,24 @@ void IOManager::Wakeup() {
   }
 }
 
+bool IOManager::IsOnPollThread() const {
+  return poll_thread_ && poll_thread_->get_id() == CurrentThread::get_id();
+}
+
 void IOManager::Run() {
+  uint64_t wakeups = 0;
+  Time window_start = UpdateLoopTime();
   while (true) {
-    Time::Delta timeout = TimerManager::Get()->TimerCheck();
+    // The clock is read once per iteration; timers and the wakeup statistics
+    // share that reading.
+    Time now = UpdateLoopTime();
+    if (now - window_start >= Time::Delta::FromSeconds(1)) {
+      wakeups_per_second_.store(wakeups * 1000000 /
+                                (now - window_start).ToMicroseconds());
+      wakeups = 0;
+      window_start = now;
+    }
+    Time::Delta timeout = timer_manager_.TimerCheck(now);
     if (timeout.IsInfinite()) {
       timeout = Time::Delta::FromMilliseconds(-1);
     } else if (timeout < Time::Delta::Zero()) {
@@ -135,6 +183,7 @@ void IOManager::Run() {
       LOG(ERROR) << "Failed to poll: " << status.ToString();
       return;
     }
+    ++wakeups;
     TaskRunner* runner = TaskRunner::Get();
     for (auto& event : io_events) {
       FDAndControllers* fd_ctrl =
@@ -156,6 +205,12 @@ void IOManager::Run() {
   }
 }
 
+Time IOManager::UpdateLoopTime() {
+  Time now = Clock::Now();
+  loop_time_us_.store(now.ToDebuggingValue(), std::memory_order_relaxed);
+  return now;
+}
+
 void IOManager::HandleIO(int fd, IOWatcher* watcher, int ready) {
   DCHECK_NE(-1, fd);
   DCHECK(watcher);
@@ -167,6 +222,9 @@ void IOManager::HandleIO(int fd, IOWatcher* watcher, int ready) {
   if (ready & IOWatcher::kWatchRead) {
     watcher->OnFileReadable(fd);
   }
+  if (ready & IOWatcher::kWatchError) {
+    watcher->OnFileError(fd);
+  }
 }
 
 bool IOManager::StopWatchingFileDescriptorNoLock(
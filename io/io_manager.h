@@ -1,24 +1,57 @@
 #ifndef LIBIOMGR_IO_IO_MANAGER_H_
 #define LIBIOMGR_IO_IO_MANAGER_H_
 
+#include <atomic>
 #include <set>
 #include <vector>
 
 #include "io/io_poller.h"
 #include "iomgr/io_watcher.h"
+#include "timer/timer_manager.h"
 #include "util/scoped_fd.h"
 #include "util/sync.h"
 
 namespace iomgr {
 
+// IOManager is a reactor: it owns a poll thread that dispatches IO events
+// and expires the timers of its own TimerManager. Get() returns the global
+// reactor used by the public API; more reactors can be created to spread
+// connections over several poll threads.
 class IOManager {
  public:
   static IOManager* Get();
+  // Reactor |index| of a process-wide set, for servers that spread their
+  // sockets over several poll threads. Reactor 0 is Get(); the others are
+  // created on first use and live as long as Get().
+  static IOManager* Get(size_t index);
+
+  IOManager();
+  ~IOManager();
+
+  IOManager(const IOManager&) = delete;
+  IOManager& operator=(const IOManager&) = delete;
 
   bool WatchFileDescriptor(int fd, int mode, IOWatcher* watcher,
                            IOWatcher::Controller* controller);
   bool StopWatchingFileDescriptor(IOWatcher::Controller* controller);
   void Wakeup();
+  // Returns true if called from the poll thread of this IOManager.
+  bool IsOnPollThread() const;
+
+  // Timers armed here expire on the poll thread of this IOManager.
+  TimerManager* timer_manager() { return &timer_manager_; }
+
+  // The time read at the top of the current poll iteration, without a system
+  // call. It is exact on the poll thread until it goes back to poll, and a
+  // lower bound of the current time anywhere else.
+  Time loop_time() const {
+    return Time::Zero() + Time::Delta::FromMicroseconds(
+                              loop_time_us_.load(std::memory_order_relaxed));
+  }
+
+  // Number of times the poll thread returned from the poller during the last
+  // full second, whether because of IO, an expired timer or a Wakeup().
+  uint64_t wakeups_per_second() const { return wakeups_per_second_.load(); }
 
  private:
   friend class IOManagerTest;
@@ -43,10 +76,9 @@ class IOManager {
 
   class PollThread;
 
-  IOManager();
-  ~IOManager();
-
   void Run();
+  // Reads Clock::Now() and publishes it as the loop time.
+  Time UpdateLoopTime();
   static void HandleIO(int fd, IOWatcher* watcher, int ready);
   bool StopWatchingFileDescriptorNoLock(IOWatcher::Controller* controller);
 
@@ -55,8 +87,11 @@ class IOManager {
   IOPoller poller_;
   ScopedFD wakeup_fd_;
   FDToControllers fd_controllers_;
+  TimerManager timer_manager_;
   std::unique_ptr<PollThread> poll_thread_;
   IOWatcher::Controller wakeup_controller_;
+  std::atomic<uint64_t> wakeups_per_second_;
+  std::atomic<int64_t> loop_time_us_;
 };
 
 }  // namespace iomgr
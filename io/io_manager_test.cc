@@ -3,6 +3,7 @@
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
+#include "iomgr/timer.h"
 #include "util/file_op.h"
 #include "util/notification.h"
 
@@ -93,6 +94,103 @@ TEST_F(IOManagerTest, StopWatchingFileDescriptorAgain) {
   CheckRemoved(iomgr);
 }
 
+TEST_F(IOManagerTest, GlobalTimerManager) {
+  EXPECT_EQ(IOManager::Get()->timer_manager(), TimerManager::Get());
+  EXPECT_FALSE(IOManager::Get()->IsOnPollThread());
+}
+
+void RecordPollThread(IOManager* iomgr, bool* on_poll_thread,
+                      Notification* notification) {
+  *on_poll_thread = iomgr->IsOnPollThread();
+  notification->Notify();
+}
+
+TEST_F(IOManagerTest, OwnTimerManager) {
+  IOManager iomgr;
+  EXPECT_NE(IOManager::Get()->timer_manager(), iomgr.timer_manager());
+
+  bool on_poll_thread = false;
+  Notification notification;
+  Timer::Controller controller;
+  Timer::Options options;
+  options.dispatch = Timer::kRunInline;
+  iomgr.timer_manager()->TimerInit(
+      Time::Delta::FromMilliseconds(10), Time::Delta::Zero(), options,
+      std::bind(RecordPollThread, &iomgr, &on_poll_thread, &notification),
+      &controller);
+  notification.WaitForNotification();
+  EXPECT_TRUE(on_poll_thread);
+  EXPECT_FALSE(controller.pending());
+}
+
+void RecordReactor(IOManager* reactor, bool* on_reactor, bool* on_global,
+                   Notification* notification) {
+  *on_reactor = reactor->IsOnPollThread();
+  *on_global = IOManager::Get()->IsOnPollThread();
+  notification->Notify();
+}
+
+TEST_F(IOManagerTest, TimerOnReactor) {
+  IOManager* reactor = IOManager::Get(1);
+  bool on_reactor = false;
+  bool on_global = true;
+  Notification notification;
+  Timer::Controller controller;
+  Timer::Options options;
+  options.dispatch = Timer::kRunInline;
+  Timer::Start(reactor->timer_manager(), Time::Delta::FromMilliseconds(10),
+               std::bind(RecordReactor, reactor, &on_reactor, &on_global,
+                         &notification),
+               &controller, options);
+  notification.WaitForNotification();
+  EXPECT_TRUE(on_reactor);
+  EXPECT_FALSE(on_global);
+  EXPECT_FALSE(controller.pending());
+}
+
+void ArmOnPollThread(IOManager* iomgr, Timer::Controller* controller,
+                     Time* loop_time, Notification* notification) {
+  *loop_time = iomgr->loop_time();
+  iomgr->timer_manager()->TimerInit(Time::Delta::FromSeconds(10), []() {},
+                                    controller);
+  notification->Notify();
+}
+
+TEST_F(IOManagerTest, LoopTime) {
+  IOManager iomgr;
+  Time loop_time = Time::Zero();
+  Notification notification;
+  Timer::Controller controller;
+  Timer::Controller armed;
+  Timer::Options options;
+  options.dispatch = Timer::kRunInline;
+  iomgr.timer_manager()->TimerInit(
+      Time::Delta::FromMilliseconds(10), Time::Delta::Zero(), options,
+      std::bind(ArmOnPollThread, &iomgr, &armed, &loop_time, &notification),
+      &controller);
+  notification.WaitForNotification();
+  EXPECT_LE(loop_time, Time::Now());
+  // A timer armed on the poll thread counts from the loop time
+  EXPECT_EQ(loop_time + Time::Delta::FromSeconds(10), armed.deadline());
+  armed.Cancel();
+}
+
+TEST_F(IOManagerTest, WatchOnOwnIOManager) {
+  IOManager iomgr;
+  Notification notification;
+  ReadWatcher watcher(&notification);
+  IOWatcher::Controller controller;
+  EXPECT_TRUE(iomgr.WatchFileDescriptor(eventfd(), IOWatcher::kWatchRead,
+                                        &watcher, &controller));
+  // A controller stays bound to the IOManager watching its fd
+  EXPECT_FALSE(IOManager::Get()->WatchFileDescriptor(
+      eventfd(), IOWatcher::kWatchRead, &watcher, &controller));
+  TriggerReadable();
+  notification.WaitForNotification();
+  EXPECT_TRUE(controller.StopWatching());
+  CheckRemoved(&iomgr);
+}
+
 }  // namespace iomgr
 
 int main(int argc, char** argv) {
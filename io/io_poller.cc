@@ -5,6 +5,7 @@
 #include <unistd.h>
 
 #include "iomgr/io_watcher.h"
+#include "timer/clock.h"
 #include "util/file_op.h"
 #include "util/os_error.h"
 
@@ -45,12 +46,18 @@ Status IOPoller::Poll(Time::Delta timeout, std::vector<IOEvent>* io_events) {
   int rc = -1;
   io_events->clear();
   std::vector<struct epoll_event> events(max_poll_size_);
+  // The clock is only needed to shorten a finite wait after EINTR, so an
+  // infinite or zero timeout costs no clock read at all.
+  const bool track_time = remaining_time > Time::Delta::Zero();
   do {
-    Time start = Time::Now();
+    Time start = track_time ? Clock::Now() : Time::Zero();
     rc = epoll_wait(epoll_fd_, events.data(), max_poll_size_,
                     remaining_time.ToMilliseconds());
     if (rc < 0 && errno == EINTR) {
-      Time end = Time::Now();
+      if (!track_time) {
+        continue;
+      }
+      Time end = Clock::Now();
       Time::Delta waited = end - start;
       if (waited < remaining_time) {
         remaining_time = remaining_time - waited;
@@ -71,6 +78,10 @@ Status IOPoller::Poll(Time::Delta timeout, std::vector<IOEvent>* io_events) {
       if (events[i].events & (EPOLLOUT | EPOLLERR | EPOLLHUP | EPOLLPRI)) {
         io_event.ready |= IOWatcher::kWatchWrite;
       }
+      // Always reported, there is no flag to ask for it
+      if (events[i].events & EPOLLERR) {
+        io_event.ready |= IOWatcher::kWatchError;
+      }
       if (io_event.ready) {
         io_events->push_back(io_event);
       }
@@ -88,6 +99,10 @@ Status IOPoller::InvokeControl(int op, int fd, int mode, void* file_ctx) const {
   if (mode & IOWatcher::kWatchWrite) {
     events |= EPOLLOUT;
   }
+  // Only allowed when the fd is added
+  if ((mode & IOWatcher::kWatchExclusive) && op == EPOLL_CTL_ADD) {
+    events |= EPOLLEXCLUSIVE;
+  }
 
   struct epoll_event event;
   memset(&event, 0, sizeof(event));
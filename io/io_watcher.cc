@@ -13,7 +13,9 @@ bool IOWatcher::WatchFileDescriptor(int fd, int mode, IOWatcher* watcher,
   DCHECK(watcher);
   DCHECK(controller);
   DCHECK(mode == IOWatcher::kWatchRead || mode == IOWatcher::kWatchWrite ||
-         mode == IOWatcher::kWatchReadWrite);
+         mode == IOWatcher::kWatchReadWrite ||
+         mode == (IOWatcher::kWatchRead | IOWatcher::kWatchExclusive) ||
+         mode == IOWatcher::kWatchError);
 
   return IOManager::Get()->WatchFileDescriptor(fd, mode, watcher, controller);
 }
@@ -21,9 +23,11 @@ bool IOWatcher::WatchFileDescriptor(int fd, int mode, IOWatcher* watcher,
 /// IOWatcher
 IOWatcher::~IOWatcher() = default;
 
+void IOWatcher::OnFileError(int fd) { DCHECK(false) << "NOTREACHED"; }
+
 // IOWatcher::Controller
 IOWatcher::Controller::Controller()
-    : fd_(-1), mode_(0), watcher_(nullptr), task_(nullptr) {}
+    : fd_(-1), mode_(0), watcher_(nullptr), iomgr_(nullptr), task_(nullptr) {}
 
 IOWatcher::Controller::~Controller() { DCHECK(StopWatching()); }
 
@@ -31,11 +35,13 @@ void IOWatcher::Controller::reset() {
   fd_ = -1;
   mode_ = 0;
   watcher_ = nullptr;
+  iomgr_ = nullptr;
   task_.reset();
 }
 
 bool IOWatcher::Controller::StopWatching() {
-  return IOManager::Get()->StopWatchingFileDescriptor(this);
+  // A controller that never watched anything has nothing to stop.
+  return iomgr_ == nullptr || iomgr_->StopWatchingFileDescriptor(this);
 }
 
 }  // namespace iomgr
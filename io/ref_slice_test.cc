@@ -0,0 +1,82 @@
+#include "iomgr/ref_slice.h"
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "iomgr/io_buffer_chain.h"
+
+namespace iomgr {
+
+TEST(RefSlice, Empty) {
+  RefSlice slice;
+  EXPECT_TRUE(slice.empty());
+  EXPECT_EQ(0u, slice.size());
+  EXPECT_FALSE(slice.buffer());
+  EXPECT_EQ("", slice.ToString());
+  EXPECT_TRUE(RefSlice::CopyFrom(Slice()).empty());
+}
+
+TEST(RefSlice, SharesBuffer) {
+  RefPtr<IOBuffer> buffer = MakeRefCounted<StringIOBuffer>("hello world");
+  RefSlice slice(buffer, 0, 11);
+  EXPECT_EQ(buffer->data(), slice.data());
+  EXPECT_EQ(Slice("hello world"), slice.slice());
+
+  RefSlice world = slice.SubSlice(6, 5);
+  EXPECT_EQ(buffer->data() + 6, world.data());
+  EXPECT_EQ(6u, world.offset());
+  EXPECT_EQ("world", world.ToString());
+  EXPECT_EQ('w', world[0]);
+  EXPECT_EQ(buffer.get(), world.buffer().get());
+}
+
+TEST(RefSlice, OutlivesOriginal) {
+  RefSlice world;
+  const char* data = nullptr;
+  {
+    RefPtr<IOBuffer> buffer = MakeRefCounted<StringIOBuffer>("hello world");
+    data = buffer->data() + 6;
+    world = RefSlice(buffer, 0, 11).SubSlice(6, 5);
+  }
+  // The buffer is kept alive by |world|
+  EXPECT_EQ(data, world.data());
+  EXPECT_EQ("world", world.ToString());
+  EXPECT_TRUE(world.buffer()->HasOneRef());
+}
+
+TEST(RefSlice, RemovePrefixSuffix) {
+  RefSlice slice = RefSlice::CopyFrom("<hello>");
+  slice.remove_prefix(1);
+  slice.remove_suffix(1);
+  EXPECT_EQ("hello", slice.ToString());
+  EXPECT_EQ(1u, slice.offset());
+
+  slice.clear();
+  EXPECT_TRUE(slice.empty());
+  EXPECT_FALSE(slice.buffer());
+}
+
+TEST(RefSlice, Compare) {
+  EXPECT_EQ(RefSlice::CopyFrom("abc"), RefSlice::CopyFrom("abc"));
+  EXPECT_NE(RefSlice::CopyFrom("abc"), RefSlice::CopyFrom("abd"));
+  EXPECT_NE(RefSlice::CopyFrom("abc"), RefSlice());
+}
+
+TEST(RefSlice, KeepSegmentOfChain) {
+  IOBufferChain chain;
+  chain.Append(RefSlice::CopyFrom("header"));
+  chain.Append(RefSlice::CopyFrom("body"));
+
+  RefSlice body = chain.segment(1);
+  chain.Clear();
+  EXPECT_EQ("body", body.ToString());
+}
+
+}  // namespace iomgr
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
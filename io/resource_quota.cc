@@ -0,0 +1,236 @@
+#include "iomgr/resource_quota.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "iomgr/io_buffer_pool.h"
+#include "threading/task_runner.h"
+#include "util/sync.h"
+
+namespace iomgr {
+
+struct ResourceQuota::State {
+  State() : mutex(), waiter_done(&mutex), pressure_callback(), waiters() {}
+
+  Mutex mutex;
+  // Signalled when a user callback returns
+  CondVar waiter_done;
+  PressureCallback pressure_callback;
+  // Users waiting for the quota to get back under its limit
+  std::vector<ResourceUser*> waiters;
+};
+
+// The user whose callback runs on this thread, if any
+static thread_local const ResourceUser* s_running_user = nullptr;
+
+ResourceQuota::ResourceQuota()
+    : limit_(0),
+      per_user_limit_(0),
+      used_(0),
+      over_quota_(false),
+      state_(new State) {}
+
+ResourceQuota::~ResourceQuota() {
+  DCHECK(state_->waiters.empty());
+  DCHECK_EQ(0u, used());
+}
+
+ResourceQuota* ResourceQuota::Get() {
+  // Leaked on purpose, buffers charged to it may be released during static
+  // destruction.
+  static ResourceQuota* s_quota = new ResourceQuota;
+  return s_quota;
+}
+
+void ResourceQuota::SetLimit(size_t bytes) {
+  limit_.store(bytes, std::memory_order_relaxed);
+  UpdatePressure();
+}
+
+void ResourceQuota::SetPerUserLimit(size_t bytes) {
+  per_user_limit_.store(bytes, std::memory_order_relaxed);
+}
+
+void ResourceQuota::SetPressureCallback(PressureCallback callback) {
+  MutexLock lock(&state_->mutex);
+  state_->pressure_callback = std::move(callback);
+}
+
+bool ResourceQuota::IsOverQuota() const {
+  size_t limit = this->limit();
+  return limit != 0 && used_.load() >= limit;
+}
+
+void ResourceQuota::Charge(size_t bytes) {
+  size_t used = used_.fetch_add(bytes) + bytes;
+  size_t limit = this->limit();
+  if (limit != 0 && used >= limit &&
+      !over_quota_.load(std::memory_order_relaxed)) {
+    UpdatePressure();
+  }
+}
+
+void ResourceQuota::Uncharge(size_t bytes) {
+  size_t used = used_.fetch_sub(bytes) - bytes;
+  if (over_quota_.load(std::memory_order_relaxed) && used < limit()) {
+    UpdatePressure();
+  }
+}
+
+void ResourceQuota::UpdatePressure() {
+  bool over;
+  bool changed;
+  PressureCallback callback;
+  {
+    MutexLock lock(&state_->mutex);
+    over = IsOverQuota();
+    changed = over != over_quota_.load(std::memory_order_relaxed);
+    over_quota_.store(over, std::memory_order_relaxed);
+    if (changed) {
+      callback = state_->pressure_callback;
+    }
+    if (!over) {
+      // Also done without a change: a user may have started waiting between
+      // going over and this update.
+      std::vector<ResourceUser*> waiters;
+      waiters.swap(state_->waiters);
+      for (ResourceUser* user : waiters) {
+        user->MaybeResumeLocked();
+        if (user->waiting_) {
+          state_->waiters.push_back(user);
+        }
+      }
+    }
+  }
+
+  if (changed && over) {
+    // Cached blocks count against nobody, but they are memory all the same
+    IOBufferPool::Get()->Trim();
+  }
+  if (callback) {
+    TaskRunner::Get()->PostTask(std::bind(callback, over));
+  }
+}
+
+ResourceUser::ResourceUser(ResourceQuota* quota)
+    : quota_(CHECK_NOTNULL(quota)),
+      limit_(quota->per_user_limit()),
+      used_(0),
+      waiting_(false),
+      waiter_(),
+      resumed_(false),
+      running_waiters_(0) {}
+
+ResourceUser::~ResourceUser() {
+  DCHECK(!waiting_);
+  DCHECK_EQ(0, running_waiters_);
+  DCHECK_EQ(0u, used());
+}
+
+void ResourceUser::set_limit(size_t bytes) {
+  limit_.store(bytes, std::memory_order_relaxed);
+  MutexLock lock(&quota_->state_->mutex);
+  MaybeResumeLocked();
+}
+
+bool ResourceUser::IsOverQuota() const {
+  size_t limit = this->limit();
+  return (limit != 0 && used_.load() >= limit) || quota_->IsOverQuota();
+}
+
+void ResourceUser::Charge(size_t bytes) {
+  used_.fetch_add(bytes);
+  quota_->Charge(bytes);
+}
+
+void ResourceUser::Uncharge(size_t bytes) {
+  DCHECK_LE(bytes, used());
+  used_.fetch_sub(bytes);
+  quota_->Uncharge(bytes);
+  if (waiting_) {
+    MutexLock lock(&quota_->state_->mutex);
+    MaybeResumeLocked();
+  }
+}
+
+void ResourceUser::WaitForQuota(std::function<void()> callback) {
+  DCHECK(callback);
+  MutexLock lock(&quota_->state_->mutex);
+  DCHECK(!waiter_) << "Only one wait may be pending";
+  waiter_ = std::move(callback);
+  resumed_ = false;
+  // Listed before IsOverQuota() is checked, so that a concurrent Uncharge()
+  // either sees |waiting_| or is seen by the check.
+  waiting_ = true;
+  quota_->state_->waiters.push_back(this);
+  MaybeResumeLocked();
+}
+
+void ResourceUser::CancelWait() {
+  MutexLock lock(&quota_->state_->mutex);
+  // The owner may be torn down once this returns, so callbacks running on
+  // other threads must be done with it. The one running on this thread is
+  // the caller.
+  int own = s_running_user == this ? 1 : 0;
+  while (true) {
+    waiter_ = nullptr;
+    resumed_ = false;
+    if (waiting_) {
+      std::vector<ResourceUser*>* waiters = &quota_->state_->waiters;
+      waiters->erase(std::find(waiters->begin(), waiters->end(), this));
+      waiting_ = false;
+    }
+    if (running_waiters_ <= own) {
+      return;
+    }
+    // A running callback may start another wait before it returns
+    quota_->state_->waiter_done.Wait();
+  }
+}
+
+void ResourceUser::MaybeResumeLocked() {
+  if (!waiter_ || resumed_ || IsOverQuota()) {
+    return;
+  }
+  resumed_ = true;
+  if (waiting_) {
+    std::vector<ResourceUser*>* waiters = &quota_->state_->waiters;
+    auto it = std::find(waiters->begin(), waiters->end(), this);
+    // Already taken off the list by UpdatePressure()
+    if (it != waiters->end()) {
+      waiters->erase(it);
+    }
+    waiting_ = false;
+  }
+  // The owner keeps a reference while waiting, so one can be added here
+  RefPtr<ResourceUser> self(this);
+  TaskRunner::Get()->PostTask([self]() { self->RunWaiter(); });
+}
+
+void ResourceUser::RunWaiter() {
+  std::function<void()> waiter;
+  {
+    MutexLock lock(&quota_->state_->mutex);
+    if (!resumed_) {
+      // Cancelled after being posted
+      return;
+    }
+    resumed_ = false;
+    waiter = std::move(waiter_);
+    waiter_ = nullptr;
+    ++running_waiters_;
+  }
+
+  const ResourceUser* previous = s_running_user;
+  s_running_user = this;
+  waiter();
+  s_running_user = previous;
+
+  MutexLock lock(&quota_->state_->mutex);
+  --running_waiters_;
+  quota_->state_->waiter_done.SignalAll();
+}
+
+}  // namespace iomgr
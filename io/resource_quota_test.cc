@@ -0,0 +1,220 @@
+#include "iomgr/resource_quota.h"
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <vector>
+
+#include "iomgr/io_buffer_pool.h"
+#include "util/notification.h"
+#include "util/sync.h"
+
+namespace iomgr {
+
+TEST(ResourceQuota, ChargeBuffers) {
+  ResourceQuota quota;
+  RefPtr<ResourceUser> a = MakeRefCounted<ResourceUser>(&quota);
+  RefPtr<ResourceUser> b = MakeRefCounted<ResourceUser>(&quota);
+
+  RefPtr<IOBufferWithSize> buf1 = IOBufferPool::Get()->Alloc(4000, a.get());
+  RefPtr<IOBufferWithSize> buf2 = IOBufferPool::Get()->Alloc(100, b.get());
+  // Whole size classes are charged
+  EXPECT_EQ(4096u, a->used());
+  EXPECT_EQ(256u, b->used());
+  EXPECT_EQ(4096u + 256u, quota.used());
+
+  size_t large = IOBufferPool::kMaxBufferSize + 1;
+  RefPtr<IOBufferWithSize> buf3 = IOBufferPool::Get()->Alloc(large, a.get());
+  EXPECT_EQ(4096u + large, a->used());
+
+  buf1 = nullptr;
+  buf3 = nullptr;
+  EXPECT_EQ(0u, a->used());
+  EXPECT_EQ(256u, quota.used());
+  buf2 = nullptr;
+  EXPECT_EQ(0u, quota.used());
+}
+
+TEST(ResourceQuota, UserOutlivesOwner) {
+  ResourceQuota quota;
+  RefPtr<IOBufferWithSize> buf;
+  {
+    RefPtr<ResourceUser> user = MakeRefCounted<ResourceUser>(&quota);
+    buf = IOBufferPool::Get()->Alloc(1024, user.get());
+  }
+  EXPECT_EQ(1024u, quota.used());
+  buf = nullptr;
+  EXPECT_EQ(0u, quota.used());
+}
+
+TEST(ResourceQuota, PerUserLimit) {
+  ResourceQuota quota;
+  quota.SetPerUserLimit(8192);
+  RefPtr<ResourceUser> a = MakeRefCounted<ResourceUser>(&quota);
+  RefPtr<ResourceUser> b = MakeRefCounted<ResourceUser>(&quota);
+  EXPECT_EQ(8192u, a->limit());
+
+  RefPtr<IOBufferWithSize> buf = IOBufferPool::Get()->Alloc(8192, a.get());
+  EXPECT_TRUE(a->IsOverQuota());
+  EXPECT_FALSE(b->IsOverQuota());
+  EXPECT_FALSE(quota.IsOverQuota());
+
+  a->set_limit(0);
+  EXPECT_FALSE(a->IsOverQuota());
+}
+
+TEST(ResourceQuota, GlobalLimit) {
+  ResourceQuota quota;
+  quota.SetLimit(8192);
+  RefPtr<ResourceUser> a = MakeRefCounted<ResourceUser>(&quota);
+  RefPtr<ResourceUser> b = MakeRefCounted<ResourceUser>(&quota);
+
+  RefPtr<IOBufferWithSize> buf1 = IOBufferPool::Get()->Alloc(4096, a.get());
+  EXPECT_FALSE(quota.IsOverQuota());
+  RefPtr<IOBufferWithSize> buf2 = IOBufferPool::Get()->Alloc(4096, b.get());
+  EXPECT_TRUE(quota.IsOverQuota());
+  EXPECT_TRUE(a->IsOverQuota());
+  EXPECT_TRUE(b->IsOverQuota());
+
+  buf1 = nullptr;
+  EXPECT_FALSE(quota.IsOverQuota());
+  EXPECT_FALSE(b->IsOverQuota());
+}
+
+TEST(ResourceQuota, WaitForQuota) {
+  ResourceQuota quota;
+  quota.SetPerUserLimit(4096);
+  RefPtr<ResourceUser> user = MakeRefCounted<ResourceUser>(&quota);
+
+  // Under quota, the callback is posted right away
+  Notification under;
+  user->WaitForQuota(std::bind(&Notification::Notify, &under));
+  under.WaitForNotification();
+
+  RefPtr<IOBufferWithSize> buf = IOBufferPool::Get()->Alloc(4096, user.get());
+  Notification released;
+  user->WaitForQuota(std::bind(&Notification::Notify, &released));
+  EXPECT_FALSE(released.HasBeenNotified());
+  buf = nullptr;
+  released.WaitForNotification();
+}
+
+TEST(ResourceQuota, WaitForGlobalQuota) {
+  ResourceQuota quota;
+  quota.SetLimit(4096);
+  RefPtr<ResourceUser> a = MakeRefCounted<ResourceUser>(&quota);
+  RefPtr<ResourceUser> b = MakeRefCounted<ResourceUser>(&quota);
+
+  RefPtr<IOBufferWithSize> buf = IOBufferPool::Get()->Alloc(4096, a.get());
+  Notification released;
+  b->WaitForQuota(std::bind(&Notification::Notify, &released));
+  EXPECT_FALSE(released.HasBeenNotified());
+  // Memory released by another user wakes |b|
+  buf = nullptr;
+  released.WaitForNotification();
+}
+
+TEST(ResourceQuota, CancelWait) {
+  ResourceQuota quota;
+  quota.SetPerUserLimit(4096);
+  RefPtr<ResourceUser> user = MakeRefCounted<ResourceUser>(&quota);
+
+  RefPtr<IOBufferWithSize> buf = IOBufferPool::Get()->Alloc(4096, user.get());
+  user->WaitForQuota([]() { FAIL() << "Cancelled wait was run"; });
+  user->CancelWait();
+  buf = nullptr;
+
+  // A new wait can be started after cancelling
+  Notification notification;
+  user->WaitForQuota(std::bind(&Notification::Notify, &notification));
+  notification.WaitForNotification();
+}
+
+TEST(ResourceQuota, CancelWaitWhileRunning) {
+  ResourceQuota quota;
+  quota.SetPerUserLimit(4096);
+  RefPtr<ResourceUser> user = MakeRefCounted<ResourceUser>(&quota);
+
+  Notification started;
+  std::atomic<bool> done(false);
+  RefPtr<IOBufferWithSize> buf;
+  user->WaitForQuota([&user, &started, &done, &buf]() {
+    started.Notify();
+    usleep(100 * 1000);
+    // Like a read that goes over quota and waits again
+    buf = IOBufferPool::Get()->Alloc(4096, user.get());
+    user->WaitForQuota([]() { FAIL() << "Cancelled wait was run"; });
+    done = true;
+  });
+  started.WaitForNotification();
+  // The owner may be torn down once it returns
+  user->CancelWait();
+  EXPECT_TRUE(done);
+
+  // The wait started by the callback is cancelled too
+  buf = nullptr;
+  usleep(10 * 1000);
+}
+
+TEST(ResourceQuota, CancelWaitFromCallback) {
+  ResourceQuota quota;
+  RefPtr<ResourceUser> user = MakeRefCounted<ResourceUser>(&quota);
+
+  Notification cancelled;
+  user->WaitForQuota([&user, &cancelled]() {
+    user->CancelWait();
+    cancelled.Notify();
+  });
+  cancelled.WaitForNotification();
+  // Waits for the callback to return before |quota| goes away
+  user->CancelWait();
+}
+
+TEST(ResourceQuota, PressureCallback) {
+  ResourceQuota quota;
+  RefPtr<ResourceUser> user = MakeRefCounted<ResourceUser>(&quota);
+
+  Mutex mutex;
+  std::vector<bool> pressure;
+  Notification over;
+  Notification under;
+  quota.SetPressureCallback([&](bool over_quota) {
+    MutexLock lock(&mutex);
+    pressure.push_back(over_quota);
+    over_quota ? over.Notify() : under.Notify();
+  });
+
+  RefPtr<IOBufferWithSize> buf = IOBufferPool::Get()->Alloc(4096, user.get());
+  quota.SetLimit(4096);
+  over.WaitForNotification();
+  buf = nullptr;
+  under.WaitForNotification();
+
+  MutexLock lock(&mutex);
+  ASSERT_EQ(2u, pressure.size());
+  EXPECT_TRUE(pressure[0]);
+  EXPECT_FALSE(pressure[1]);
+}
+
+TEST(ResourceQuota, TrimPoolWhenOverQuota) {
+  IOBufferPool* pool = IOBufferPool::Get();
+  // Leave a block in the cache of this thread
+  pool->Alloc(64 * 1024);
+  uint64_t cached = pool->GetStats().bytes_cached;
+  EXPECT_LE(64u * 1024, cached);
+
+  ResourceQuota quota;
+  quota.SetLimit(4096);
+  RefPtr<ResourceUser> user = MakeRefCounted<ResourceUser>(&quota);
+  RefPtr<IOBufferWithSize> buf = pool->Alloc(4096, user.get());
+  EXPECT_GE(cached - 64 * 1024, pool->GetStats().bytes_cached);
+}
+
+}  // namespace iomgr
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
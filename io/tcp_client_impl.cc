@@ -1,6 +1,18 @@
 #include "io/tcp_client_impl.h"
 
+#include <errno.h>
+#include <limits.h>
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include "io/io_manager.h"
 #include "iomgr/io_buffer.h"
+#include "iomgr/io_buffer_chain.h"
+#include "iomgr/io_buffer_pool.h"
+#include "iomgr/ref_slice.h"
+#include "iomgr/resource_quota.h"
 #include "iomgr/timer.h"
 #include "util/file_op.h"
 #include "util/os_error.h"
@@ -9,6 +21,64 @@
 
 namespace iomgr {
 
+// ReadV() reads into pooled buffers of |kReadVSegmentSize| bytes, and at most
+// |kMaxIOVecs| segments are handed to readv()/writev() at a time.
+static const size_t kReadVSegmentSize = 16 * 1024;
+static const int kMaxIOVecs = 64;
+
+// Auto-sized reads start at |kInitialReadSize| and are rounded up to a power
+// of two in [kMinReadSize, kMaxReadSize], so that whole IOBufferPool blocks
+// are used.
+static const size_t kInitialReadSize = 4096;
+static const size_t kMinReadSize = IOBufferPool::kMinBufferSize;
+static const size_t kMaxReadSize = IOBufferPool::kMaxBufferSize;
+// With one sample per update, the new average is the mean of the previous
+// average and the last read.
+static const double kReadSizePersistence = 0.5;
+
+// A disconnected socket with zero-copy sends in flight is kept open for that
+// long at most, waiting for the kernel to release their buffers
+static const Time::Delta kZeroCopyLingerTimeout = Time::Delta::FromSeconds(60);
+
+// Counters of TCPClient::GetFastOpenStats()
+static std::atomic<uint64_t> s_fast_open_attempts(0);
+static std::atomic<uint64_t> s_fast_open_succeeded(0);
+
+const size_t TCPClient::kZeroCopyMinBytes;
+
+// Total length of |iov|
+static size_t IOVecBytes(const struct iovec* iov, int iovcnt) {
+  size_t bytes = 0;
+  for (int i = 0; i < iovcnt; ++i) {
+    bytes += iov[i].iov_len;
+  }
+  return bytes;
+}
+
+// Shortens |iov| to |max_bytes| in all. Returns the number of entries left.
+static int TrimIOVec(struct iovec* iov, int iovcnt, size_t max_bytes) {
+  for (int i = 0; i < iovcnt; ++i) {
+    if (iov[i].iov_len >= max_bytes) {
+      iov[i].iov_len = max_bytes;
+      return max_bytes > 0 ? i + 1 : i;
+    }
+    max_bytes -= iov[i].iov_len;
+  }
+  return iovcnt;
+}
+
+// The buffers holding the first |bytes| bytes of |chain|
+static std::vector<RefPtr<IOBuffer>> HeadBuffers(const IOBufferChain& chain,
+                                                 size_t bytes) {
+  std::vector<RefPtr<IOBuffer>> buffers;
+  for (size_t i = 0; bytes > 0; ++i) {
+    const RefSlice& segment = chain.segment(i);
+    buffers.push_back(segment.buffer());
+    bytes -= std::min(bytes, segment.size());
+  }
+  return buffers;
+}
+
 TCPClient::TCPClient() = default;
 
 TCPClient::~TCPClient() = default;
@@ -53,6 +123,15 @@ Status TCPClient::Connect(const InetAddress& remote, const Options& options,
       !(status = socket->SetSendBufferSize(options.send_buffer_size)).ok()) {
     return status;
   }
+  if (options.resource_quota) {
+    socket->SetResourceQuota(options.resource_quota);
+  }
+  if (options.fast_open && !(status = socket->SetFastOpenConnect()).ok()) {
+    return status;
+  }
+  if (options.zerocopy && !(status = socket->EnableZeroCopy()).ok()) {
+    return status;
+  }
 
   status = socket->Connect(remote, options.connect_timeout,
                            std::move(connect_callback));
@@ -60,21 +139,62 @@ Status TCPClient::Connect(const InetAddress& remote, const Options& options,
   return status;
 }
 
+TCPClient::FastOpenStats TCPClient::GetFastOpenStats() {
+  FastOpenStats stats;
+  // Loaded in the reverse order of the updates, so that the successes
+  // never outnumber the attempts
+  stats.succeeded = s_fast_open_succeeded.load(std::memory_order_acquire);
+  stats.attempts = s_fast_open_attempts.load(std::memory_order_acquire);
+  stats.fell_back = stats.attempts - stats.succeeded;
+  return stats;
+}
+
+TCPClient::ZeroCopyStats TCPClient::GetZeroCopyStats() {
+  return ZeroCopyTracker::GetStats();
+}
+
 TCPClientImpl::TCPClientImpl()
     : socket_fd_(-1),
+      io_manager_(IOManager::Get()),
       connect_timeout_controller_(),
       connect_socket_controller_(),
       connect_callback_(),
       connect_state_(kNone),
+      fast_open_(false),
       read_socket_controller_(),
       read_buf_(),
       read_buf_len_(0),
+      read_slice_(nullptr),
+      read_chain_(nullptr),
+      read_chain_max_bytes_(0),
+      resource_user_(MakeRefCounted<ResourceUser>(ResourceQuota::Get())),
+      read_size_stats_(kInitialReadSize, 0, kReadSizePersistence),
+      last_read_filled_(false),
       read_callback_(),
       read_if_ready_callback_(),
       write_socket_controller_(),
       write_buf_(),
       write_buf_len_(0),
+      write_chain_(nullptr),
       write_callback_(),
+      write_queue_mutex_(),
+      write_queue_(),
+      queued_writes_(),
+      queued_files_(0),
+      queued_file_bytes_(0),
+      write_queue_flushing_(false),
+      write_queue_flusher_(Thread::invalid_id),
+      write_queue_idle_(&write_queue_mutex_),
+      write_queue_watching_(false),
+      write_queue_writable_(false),
+      write_queue_error_(),
+      write_high_water_(0),
+      write_high_water_callback_(),
+      above_write_high_water_(false),
+      reported_above_write_high_water_(false),
+      write_high_water_reporting_(false),
+      zero_copy_(),
+      error_socket_controller_(),
       local_address_(),
       remote_address_() {}
 
@@ -120,6 +240,18 @@ Status TCPClientImpl::Bind(const InetAddress& local) {
 
 Status TCPClientImpl::AdoptConnectedSocket(int socket,
                                            const InetAddress& remote) {
+  DCHECK_NE(-1, socket);
+
+  Status status = FileOp::set_non_blocking(socket);
+  if (!status.ok()) {
+    FileOp::close(socket);
+    return status;
+  }
+  return AdoptNonBlockingSocket(socket, remote);
+}
+
+Status TCPClientImpl::AdoptNonBlockingSocket(int socket,
+                                             const InetAddress& remote) {
   DCHECK_EQ(-1, socket_fd_);
   DCHECK_NE(-1, socket);
   DCHECK(!remote_address_);
@@ -129,16 +261,10 @@ Status TCPClientImpl::AdoptConnectedSocket(int socket,
     return Status::InvalidArg("Address is invalid");
   }
 
-  Status status = FileOp::set_non_blocking(socket);
-  if (!status.ok()) {
-    FileOp::close(socket);
-    return status;
-  }
-
   socket_fd_.reset(socket);
   remote_address_.reset(new SockaddrStorage(address));
   connect_state_ = kConnected;
-  return status;
+  return Status();
 }
 
 Status TCPClientImpl::Connect(const InetAddress& remote,
@@ -168,32 +294,40 @@ Status TCPClientImpl::Connect(const InetAddress& remote,
     return status;
   }
 
+  // Stored first, the connect may complete before WatchFileDescriptor()
+  // returns.
+  connect_callback_ = std::move(connect_callback);
   if (!connect_timeout.IsInfinite()) {
-    Timer::Start(connect_timeout,
+    Timer::Start(io_manager_->timer_manager(), connect_timeout,
                  std::bind(&TCPClientImpl::OnConnectTimeout, this),
                  &connect_timeout_controller_);
   }
 
-  if (!IOWatcher::WatchFileDescriptor(socket_fd_, IOWatcher::kWatchWrite, this,
-                                      &connect_socket_controller_)) {
+  if (!io_manager_->WatchFileDescriptor(socket_fd_, IOWatcher::kWatchWrite,
+                                        this, &connect_socket_controller_)) {
     LOG(ERROR) << "WatchFileIO failed on connect";
+    connect_timeout_controller_.Cancel();
+    connect_callback_ = nullptr;
     connect_state_ = kNone;
     return MapSystemError(errno);
   }
-
-  connect_callback_ = std::move(connect_callback);
   return Status::TryAgain("CONNECT PENDING");
 }
 
 StatusOr<int> TCPClientImpl::Read(IOBuffer* buf, int buf_len,
                                   StatusOrIntCallback read_callback) {
+  // Set up before ReadIfReady(), RetryRead() may run as soon as the socket is
+  // watched.
+  read_buf_ = buf;
+  read_buf_len_ = buf_len;
+  read_callback_ = std::move(read_callback);
   StatusOr<int> ret = ReadIfReady(
       buf, buf_len,
       std::bind(&TCPClientImpl::RetryRead, this, std::placeholders::_1));
-  if (ret.status().IsTryAgain()) {
-    read_buf_ = buf;
-    read_buf_len_ = buf_len;
-    read_callback_ = std::move(read_callback);
+  if (!ret.status().IsTryAgain()) {
+    read_buf_ = nullptr;
+    read_buf_len_ = 0;
+    read_callback_ = nullptr;
   }
   return ret;
 }
@@ -210,15 +344,7 @@ StatusOr<int> TCPClientImpl::ReadIfReady(IOBuffer* buf, int buf_len,
   if (!ret.status().IsTryAgain()) {
     return ret;
   }
-
-  if (!IOWatcher::WatchFileDescriptor(socket_fd_, IOWatcher::kWatchRead, this,
-                                      &read_socket_controller_)) {
-    LOG(ERROR) << "WatchFileIO failed on read";
-    return MapSystemError(errno);
-  }
-
-  read_if_ready_callback_ = std::move(read_callback);
-  return Status::TryAgain("READ PENDING");
+  return WatchForRead(std::move(read_callback));
 }
 
 Status TCPClientImpl::CancelReadIfReady() {
@@ -226,11 +352,63 @@ Status TCPClientImpl::CancelReadIfReady() {
 
   bool ok = read_socket_controller_.StopWatching();
   DCHECK(ok);
+  resource_user_->CancelWait();
 
   read_if_ready_callback_ = nullptr;
   return Status();
 }
 
+StatusOr<int> TCPClientImpl::ReadAutoSized(RefSlice* data,
+                                           StatusOrIntCallback read_callback) {
+  DCHECK_NE(-1, socket_fd_);
+  DCHECK_EQ(kConnected, connect_state_);  // connect done
+  DCHECK(!read_if_ready_callback_);       // no read pending
+  DCHECK(read_callback);                  // callback is valid
+  DCHECK(data);                           // data is valid
+
+  StatusOr<int> read_or = DoReadAutoSized(data);
+  if (!read_or.status().IsTryAgain()) {
+    return read_or;
+  }
+
+  read_slice_ = data;
+  read_callback_ = std::move(read_callback);
+  Status status = WatchForRead(std::bind(&TCPClientImpl::RetryReadAutoSized,
+                                         this, std::placeholders::_1));
+  if (!status.IsTryAgain()) {
+    read_slice_ = nullptr;
+    read_callback_ = nullptr;
+  }
+  return status;
+}
+
+StatusOr<int> TCPClientImpl::ReadV(IOBufferChain* chain, int max_bytes,
+                                   StatusOrIntCallback read_callback) {
+  DCHECK_NE(-1, socket_fd_);
+  DCHECK_EQ(kConnected, connect_state_);  // connect done
+  DCHECK(!read_if_ready_callback_);       // no read pending
+  DCHECK(read_callback);                  // callback is valid
+  DCHECK(chain);                          // chain is valid
+  DCHECK_LT(0, max_bytes);                // max_bytes is valid
+
+  StatusOr<int> read_or = DoReadV(chain, max_bytes);
+  if (!read_or.status().IsTryAgain()) {
+    return read_or;
+  }
+
+  read_chain_ = chain;
+  read_chain_max_bytes_ = max_bytes;
+  read_callback_ = std::move(read_callback);
+  Status status = WatchForRead(
+      std::bind(&TCPClientImpl::RetryReadV, this, std::placeholders::_1));
+  if (!status.IsTryAgain()) {
+    read_chain_ = nullptr;
+    read_chain_max_bytes_ = 0;
+    read_callback_ = nullptr;
+  }
+  return status;
+}
+
 StatusOr<int> TCPClientImpl::Write(IOBuffer* buf, int buf_len,
                                    StatusOrIntCallback write_callback) {
   DCHECK_NE(-1, socket_fd_);
@@ -244,30 +422,173 @@ StatusOr<int> TCPClientImpl::Write(IOBuffer* buf, int buf_len,
     return write_or;
   }
 
-  if (!IOWatcher::WatchFileDescriptor(socket_fd_, IOWatcher::kWatchWrite, this,
-                                      &write_socket_controller_)) {
-    LOG(ERROR) << "WatchFileIO failed on write";
-    return MapSystemError(errno);
-  }
-
   write_buf_ = buf;
   write_buf_len_ = buf_len;
-  write_callback_ = write_callback;
+  return WatchForWrite(std::move(write_callback));
+}
 
-  return Status::TryAgain("WRITE PENDING");
+StatusOr<int> TCPClientImpl::WriteV(IOBufferChain* chain,
+                                    StatusOrIntCallback write_callback) {
+  DCHECK_NE(-1, socket_fd_);
+  DCHECK_EQ(kConnected, connect_state_);  // connect done
+  DCHECK(!write_callback_);               // No writing pending
+  DCHECK(write_callback);                 // callback is valid
+  DCHECK(chain && !chain->empty());       // chain is valid
+
+  StatusOr<int> write_or = DoWriteV(chain);
+  if (!write_or.status().IsTryAgain()) {
+    return write_or;
+  }
+
+  write_chain_ = chain;
+  return WatchForWrite(std::move(write_callback));
+}
+
+Status TCPClientImpl::QueueWrite(RefSlice data, StatusOrIntCallback callback) {
+  // |write_callback_| belongs to the thread doing Write() or WriteV(), so
+  // whether one is pending cannot be checked from here.
+  DCHECK_NE(-1, socket_fd_);
+  DCHECK_EQ(kConnected, connect_state_);  // connect done
+  DCHECK(!data.empty());                  // data is valid
+
+  size_t size = data.size();
+  return AddToWriteQueue({size, size, std::move(callback), -1, 0},
+                         std::move(data));
+}
+
+Status TCPClientImpl::SendFile(int fd, uint64_t offset, size_t length,
+                               StatusOrIntCallback callback) {
+  DCHECK_NE(-1, socket_fd_);
+  DCHECK_EQ(kConnected, connect_state_);  // connect done
+  DCHECK_NE(-1, fd);                      // fd is valid
+  DCHECK_LT(0u, length);                  // length is valid
+  DCHECK_LE(length, static_cast<size_t>(INT_MAX));
+
+  return AddToWriteQueue({length, length, std::move(callback), fd, offset},
+                         RefSlice());
+}
+
+Status TCPClientImpl::AddToWriteQueue(QueuedWrite write, RefSlice data) {
+  bool flush = false;
+  bool high_water_changed = false;
+  {
+    MutexLock lock(&write_queue_mutex_);
+    if (!write_queue_error_.ok()) {
+      return write_queue_error_;
+    }
+    if (write.file_fd != -1) {
+      ++queued_files_;
+      queued_file_bytes_ += write.size;
+    }
+    queued_writes_.push_back(std::move(write));
+    write_queue_.Append(std::move(data));
+    if (write_high_water_ != 0 && !above_write_high_water_ &&
+        write_queue_.size() > write_high_water_) {
+      above_write_high_water_ = true;
+      high_water_changed = true;
+    }
+    // Otherwise another thread is flushing, or the socket is full
+    if (!write_queue_flushing_ && !write_queue_watching_) {
+      write_queue_flushing_ = true;
+      write_queue_flusher_ = CurrentThread::get_id();
+      flush = true;
+    }
+  }
+
+  if (high_water_changed) {
+    ReportWriteHighWater();
+  }
+  if (flush) {
+    FlushWriteQueue();
+  }
+  return Status::OK();
+}
+
+size_t TCPClientImpl::QueuedWriteBytes() const {
+  MutexLock lock(&write_queue_mutex_);
+  return write_queue_.size() + queued_file_bytes_;
+}
+
+void TCPClientImpl::SetWriteHighWater(
+    size_t bytes, std::function<void(bool above)> callback) {
+  MutexLock lock(&write_queue_mutex_);
+  write_high_water_ = bytes;
+  write_high_water_callback_ = std::move(callback);
+  above_write_high_water_ = false;
+  reported_above_write_high_water_ = false;
+}
+
+void TCPClientImpl::ReportWriteHighWater() {
+  std::function<void(bool)> callback;
+  bool above;
+  {
+    MutexLock lock(&write_queue_mutex_);
+    if (write_high_water_reporting_) {
+      // The reporting thread delivers the change once it is done
+      return;
+    }
+    write_high_water_reporting_ = true;
+  }
+  while (true) {
+    {
+      MutexLock lock(&write_queue_mutex_);
+      DCHECK(write_high_water_reporting_);
+      // Changes made meanwhile on other threads, or by the callback itself,
+      // are delivered here in order. A change undone before it could be
+      // delivered is not delivered at all.
+      if (above_write_high_water_ == reported_above_write_high_water_ ||
+          !write_high_water_callback_) {
+        reported_above_write_high_water_ = above_write_high_water_;
+        write_high_water_reporting_ = false;
+        return;
+      }
+      above = above_write_high_water_;
+      reported_above_write_high_water_ = above;
+      callback = write_high_water_callback_;
+    }
+    callback(above);
+  }
 }
 
 Status TCPClientImpl::Disconnect() {
+  {
+    // A flush on another thread is still using the socket. A flush on this
+    // one means that a queued write callback disconnects, which is fine as
+    // long as it does not destroy the client.
+    MutexLock lock(&write_queue_mutex_);
+    while (write_queue_flushing_ &&
+           write_queue_flusher_ != CurrentThread::get_id()) {
+      write_queue_idle_.Wait();
+    }
+  }
+
   bool ok = connect_socket_controller_.StopWatching();
   DCHECK(ok);
   ok = read_socket_controller_.StopWatching();
   DCHECK(ok);
   ok = write_socket_controller_.StopWatching();
   DCHECK(ok);
+  ok = error_socket_controller_.StopWatching();
+  DCHECK(ok);
+  // Like the watches, waits for a read resumed on another thread
+  resource_user_->CancelWait();
   connect_timeout_controller_.Cancel();
   if (socket_fd_ != -1) {
-    socket_fd_.reset();  // close socket
+    RecordFastOpenResult();
+    if (zero_copy_) {
+      zero_copy_->ReadCompletions(socket_fd_);
+    }
+    if (zero_copy_ && zero_copy_->pending_sends() > 0) {
+      // The kernel may still read the buffers, which must not be reused
+      // before it is done
+      ZeroCopyTracker::CloseWhenReleased(socket_fd_.release(),
+                                         std::move(zero_copy_), io_manager_,
+                                         kZeroCopyLingerTimeout);
+    } else {
+      socket_fd_.reset();  // close socket
+    }
   }
+  zero_copy_.reset();
 
   if (connect_callback_) {
     connect_callback_ = nullptr;
@@ -276,6 +597,9 @@ Status TCPClientImpl::Disconnect() {
   if (read_callback_) {
     read_buf_.reset();
     read_buf_len_ = 0;
+    read_slice_ = nullptr;
+    read_chain_ = nullptr;
+    read_chain_max_bytes_ = 0;
     read_callback_ = nullptr;
   }
 
@@ -286,6 +610,21 @@ Status TCPClientImpl::Disconnect() {
     write_buf_len_ = 0;
     write_callback_ = nullptr;
   }
+  write_chain_ = nullptr;
+
+  {
+    // Queued callbacks are dropped like the ones above
+    MutexLock lock(&write_queue_mutex_);
+    write_queue_.Clear();
+    queued_writes_.clear();
+    queued_files_ = 0;
+    queued_file_bytes_ = 0;
+    write_queue_watching_ = false;
+    write_queue_writable_ = false;
+    write_queue_error_ = Status::OK();
+    above_write_high_water_ = false;
+    reported_above_write_high_water_ = false;
+  }
 
   connect_state_ = kNone;
   local_address_.reset();
@@ -380,15 +719,231 @@ Status TCPClientImpl::SetSendBufferSize(int size) {
   return status;
 }
 
+Status TCPClientImpl::SetFastOpenConnect() {
+  DCHECK_NE(-1, socket_fd_);
+  DCHECK_EQ(kNone, connect_state_);
+
+  Status status = SocketOp::set_fast_open_connect(socket_fd_, true);
+  if (!status.ok()) {
+    LOG(ERROR) << "Failed to set TCP_FASTOPEN_CONNECT on fd(" << socket_fd_
+               << "), " << status.ToString();
+    return status;
+  }
+  fast_open_ = true;
+  return status;
+}
+
+Status TCPClientImpl::EnableZeroCopy() {
+  DCHECK_NE(-1, socket_fd_);
+
+  Status status = SocketOp::set_zerocopy(socket_fd_, true);
+  if (!status.ok()) {
+    LOG(ERROR) << "Failed to set SO_ZEROCOPY on fd(" << socket_fd_ << "), "
+               << status.ToString();
+    return status;
+  }
+  return EnableInheritedZeroCopy();
+}
+
+Status TCPClientImpl::EnableInheritedZeroCopy() {
+  DCHECK_NE(-1, socket_fd_);
+  DCHECK(!zero_copy_);
+
+  zero_copy_.reset(new ZeroCopyTracker);
+  if (!io_manager_->WatchFileDescriptor(socket_fd_, IOWatcher::kWatchError,
+                                        this, &error_socket_controller_)) {
+    LOG(ERROR) << "WatchFileIO failed on the error queue";
+    zero_copy_.reset();
+    return MapSystemError(errno);
+  }
+  return Status();
+}
+
+void TCPClientImpl::SetResourceQuota(ResourceQuota* quota) {
+  DCHECK(quota);
+  DCHECK(!read_if_ready_callback_);
+  resource_user_ = MakeRefCounted<ResourceUser>(quota);
+}
+
 Status TCPClientImpl::DoConnect() {
   return SocketOp::connect(socket_fd_, remote_address_->addr,
                            remote_address_->addr_len);
 }
 StatusOr<int> TCPClientImpl::DoRead(IOBuffer* buf, int buf_len) {
+  if (resource_user_->IsOverQuota()) {
+    return Status::TryAgain("OVER QUOTA");
+  }
   return FileOp::read(socket_fd_, buf->data(), buf_len);
 }
+StatusOr<int> TCPClientImpl::DoReadAutoSized(RefSlice* data) {
+  if (resource_user_->IsOverQuota()) {
+    return Status::TryAgain("OVER QUOTA");
+  }
+  StatusOr<int> readable = ReadableBytes();
+  if (!readable.ok() || readable.value() == 0) {
+    return readable;
+  }
+  size_t size = NextReadSize(kMaxReadSize, readable.value());
+  RefPtr<IOBufferWithSize> buffer =
+      IOBufferPool::Get()->Alloc(size, resource_user_.get());
+  StatusOr<int> read_or = FileOp::read(socket_fd_, buffer->data(), size);
+  if (read_or.ok()) {
+    RecordReadSize(size, read_or.value());
+    *data = RefSlice(std::move(buffer), 0, read_or.value());
+  }
+  return read_or;
+}
+StatusOr<int> TCPClientImpl::DoReadV(IOBufferChain* chain, int max_bytes) {
+  if (resource_user_->IsOverQuota()) {
+    return Status::TryAgain("OVER QUOTA");
+  }
+  StatusOr<int> readable = ReadableBytes();
+  if (!readable.ok() || readable.value() == 0) {
+    return readable;
+  }
+  RefPtr<IOBufferWithSize> buffers[kMaxIOVecs];
+  struct iovec iov[kMaxIOVecs];
+  int iovcnt = 0;
+  size_t requested = 0;
+  for (size_t remaining = NextReadSize(max_bytes, readable.value());
+       remaining > 0 && iovcnt < kMaxIOVecs; ++iovcnt) {
+    size_t size = std::min(remaining, kReadVSegmentSize);
+    buffers[iovcnt] = IOBufferPool::Get()->Alloc(size, resource_user_.get());
+    iov[iovcnt].iov_base = buffers[iovcnt]->data();
+    iov[iovcnt].iov_len = size;
+    remaining -= size;
+    requested += size;
+  }
+
+  StatusOr<int> read_or = FileOp::readv(socket_fd_, iov, iovcnt);
+  if (read_or.ok()) {
+    RecordReadSize(requested, read_or.value());
+    // Only the filled buffers join the chain, the others go back to the pool
+    size_t left = read_or.value();
+    for (int i = 0; left > 0; ++i) {
+      size_t filled = std::min(left, iov[i].iov_len);
+      chain->Append(std::move(buffers[i]), 0, filled);
+      left -= filled;
+    }
+  }
+  return read_or;
+}
 StatusOr<int> TCPClientImpl::DoWrite(IOBuffer* buf, int buf_len) {
-  return FileOp::write(socket_fd_, buf->data(), buf_len);
+  if (!UseZeroCopy(buf_len)) {
+    return SocketOp::send(socket_fd_, buf->data(), buf_len, 0);
+  }
+  struct iovec iov = {buf->data(), static_cast<size_t>(buf_len)};
+  bool zero_copied = false;
+  StatusOr<int> write_or = DoZeroCopyWrite(&iov, 1, &zero_copied);
+  if (zero_copied) {
+    zero_copy_->AddSend({RefPtr<IOBuffer>(buf)});
+  }
+  return write_or;
+}
+StatusOr<int> TCPClientImpl::DoWriteV(IOBufferChain* chain) {
+  struct iovec iov[kMaxIOVecs];
+  int iovcnt = chain->FillIOVec(iov, kMaxIOVecs);
+  bool zero_copied = false;
+  StatusOr<int> write_or =
+      UseZeroCopy(IOVecBytes(iov, iovcnt))
+          ? DoZeroCopyWrite(iov, iovcnt, &zero_copied)
+          : SocketOp::writev(socket_fd_, iov, iovcnt);
+  if (write_or.ok()) {
+    if (zero_copied) {
+      zero_copy_->AddSend(HeadBuffers(*chain, write_or.value()));
+    }
+    chain->Consume(write_or.value());
+  }
+  return write_or;
+}
+
+bool TCPClientImpl::UseZeroCopy(size_t bytes) const {
+  return zero_copy_ && bytes >= kZeroCopyMinBytes;
+}
+
+StatusOr<int> TCPClientImpl::DoZeroCopyWrite(const struct iovec* iov,
+                                             int iovcnt, bool* zero_copied) {
+  // Also read here, so that writers get their buffers back without waiting
+  // for the error event to go through the task queue. Cheap next to a send
+  // large enough for zero copy.
+  zero_copy_->ReadCompletions(socket_fd_);
+  struct msghdr msg = {};
+  msg.msg_iov = const_cast<struct iovec*>(iov);
+  msg.msg_iovlen = iovcnt;
+  StatusOr<int> write_or = SocketOp::sendmsg_zerocopy(socket_fd_, &msg);
+  if (write_or.status().IsOutOfMemory()) {
+    // Out of option memory for the completions, which will free some
+    return SocketOp::writev(socket_fd_, iov, iovcnt);
+  }
+  *zero_copied = write_or.ok();
+  return write_or;
+}
+
+StatusOr<int> TCPClientImpl::ReadableBytes() {
+  StatusOr<int> available = SocketOp::bytes_available(socket_fd_);
+  if (!available.ok() || available.value() > 0) {
+    return available;
+  }
+  // Nothing queued: the wakeup was spurious, the stream ended or the socket
+  // failed. A one-byte peek tells them apart without a buffer, and returns 1
+  // if data arrived in the meantime.
+  char c;
+  return SocketOp::recv(socket_fd_, &c, sizeof(c), MSG_PEEK);
+}
+
+size_t TCPClientImpl::NextReadSize(size_t max_bytes, size_t queued) {
+  size_t wanted = read_size_stats_.aggregate_weighted_avg();
+  if (last_read_filled_) {
+    // More may be queued than predicted. Cover it instead of doubling one
+    // read at a time.
+    wanted = std::max(wanted * 2, queued);
+  }
+  size_t size = kMinReadSize;
+  while (size < wanted && size < kMaxReadSize) {
+    size <<= 1;
+  }
+  return std::min(size, max_bytes);
+}
+
+void TCPClientImpl::RecordReadSize(size_t requested, int bytes) {
+  if (bytes <= 0) {
+    return;
+  }
+  last_read_filled_ = static_cast<size_t>(bytes) == requested;
+  read_size_stats_.AddSample(bytes);
+  read_size_stats_.UpdateAverage();
+}
+
+Status TCPClientImpl::WatchForRead(StatusCallback read_callback) {
+  // Stored first, readiness may be reported before WatchFileDescriptor()
+  // returns.
+  read_if_ready_callback_ = std::move(read_callback);
+  if (resource_user_->IsOverQuota()) {
+    // Leave the data in the socket until memory is released
+    resource_user_->WaitForQuota(std::bind(&TCPClientImpl::OnReadDone, this));
+    return Status::TryAgain("READ PENDING");
+  }
+  if (!io_manager_->WatchFileDescriptor(socket_fd_, IOWatcher::kWatchRead,
+                                        this, &read_socket_controller_)) {
+    LOG(ERROR) << "WatchFileIO failed on read";
+    read_if_ready_callback_ = nullptr;
+    return MapSystemError(errno);
+  }
+  return Status::TryAgain("READ PENDING");
+}
+
+Status TCPClientImpl::WatchForWrite(StatusOrIntCallback write_callback) {
+  write_callback_ = std::move(write_callback);
+  if (!io_manager_->WatchFileDescriptor(socket_fd_, IOWatcher::kWatchWrite,
+                                        this, &write_socket_controller_)) {
+    LOG(ERROR) << "WatchFileIO failed on write";
+    write_buf_.reset();
+    write_buf_len_ = 0;
+    write_chain_ = nullptr;
+    write_callback_ = nullptr;
+    return MapSystemError(errno);
+  }
+  return Status::TryAgain("WRITE PENDING");
 }
 
 void TCPClientImpl::RetryRead(Status ret) {
@@ -406,8 +961,51 @@ void TCPClientImpl::RetryRead(Status ret) {
 
   read_buf_ = nullptr;
   read_buf_len_ = 0;
-  read_callback_(read_or);
+  // The callback may start the next read
+  StatusOrIntCallback read_callback = std::move(read_callback_);
   read_callback_ = nullptr;
+  read_callback(read_or);
+}
+
+void TCPClientImpl::RetryReadAutoSized(Status ret) {
+  DCHECK(read_callback_);
+  DCHECK(read_slice_);
+  DCHECK(ret.ok());
+
+  StatusOr<int> read_or = DoReadAutoSized(read_slice_);
+  if (read_or.status().IsTryAgain()) {
+    read_or = WatchForRead(std::bind(&TCPClientImpl::RetryReadAutoSized, this,
+                                     std::placeholders::_1));
+    if (read_or.status().IsTryAgain()) {
+      return;
+    }
+  }
+
+  read_slice_ = nullptr;
+  StatusOrIntCallback read_callback = std::move(read_callback_);
+  read_callback_ = nullptr;
+  read_callback(read_or);
+}
+
+void TCPClientImpl::RetryReadV(Status ret) {
+  DCHECK(read_callback_);
+  DCHECK(read_chain_);
+  DCHECK(ret.ok());
+
+  StatusOr<int> read_or = DoReadV(read_chain_, read_chain_max_bytes_);
+  if (read_or.status().IsTryAgain()) {
+    read_or = WatchForRead(
+        std::bind(&TCPClientImpl::RetryReadV, this, std::placeholders::_1));
+    if (read_or.status().IsTryAgain()) {
+      return;
+    }
+  }
+
+  read_chain_ = nullptr;
+  read_chain_max_bytes_ = 0;
+  StatusOrIntCallback read_callback = std::move(read_callback_);
+  read_callback_ = nullptr;
+  read_callback(read_or);
 }
 
 void TCPClientImpl::OnConnectTimeout() {
@@ -415,6 +1013,11 @@ void TCPClientImpl::OnConnectTimeout() {
 }
 
 void TCPClientImpl::OnConnectDone(Status status) {
+  if (connect_state_ != kConnecting) {
+    // Already completed by the socket or by the timeout
+    return;
+  }
+
   // Get the error that connect() completed with.
   if (status.ok()) {
     int os_error = 0;
@@ -423,19 +1026,36 @@ void TCPClientImpl::OnConnectDone(Status status) {
       errno = os_error;
     }
 
-    Status status = MapSocketConnectError(errno);
+    status = MapSocketConnectError(errno);
     if (status.IsTryAgain()) {
       return;
     }
-
-    bool ok = connect_socket_controller_.StopWatching();
-    DCHECK(ok);
-    connect_state_ = kConnected;
-  } else {
-    connect_state_ = kNone;
   }
-  connect_callback_(status);
+
+  bool ok = connect_socket_controller_.StopWatching();
+  DCHECK(ok);
+  connect_timeout_controller_.Cancel();
+  connect_state_ = status.ok() ? kConnected : kNone;
+  StatusCallback connect_callback = std::move(connect_callback_);
   connect_callback_ = nullptr;
+  connect_callback(status);
+}
+
+void TCPClientImpl::RecordFastOpenResult() {
+  if (!fast_open_) {
+    return;
+  }
+  fast_open_ = false;
+  struct tcp_info info;
+  if (!SocketOp::get_tcp_info(socket_fd_, &info).ok() ||
+      info.tcpi_state == TCP_SYN_SENT || info.tcpi_state == TCP_CLOSE) {
+    // The handshake never completed, e.g. nothing was written
+    return;
+  }
+  s_fast_open_attempts.fetch_add(1, std::memory_order_release);
+  if (info.tcpi_options & TCPI_OPT_SYN_DATA) {
+    s_fast_open_succeeded.fetch_add(1, std::memory_order_release);
+  }
 }
 
 void TCPClientImpl::OnReadDone() {
@@ -443,13 +1063,16 @@ void TCPClientImpl::OnReadDone() {
 
   bool ok = read_socket_controller_.StopWatching();
   DCHECK(ok);
-  read_if_ready_callback_(Status::OK());
+  // The callback may start the next read
+  StatusCallback read_callback = std::move(read_if_ready_callback_);
   read_if_ready_callback_ = nullptr;
+  read_callback(Status::OK());
 }
 
 void TCPClientImpl::OnWriteDone() {
-  StatusOr<int> write_or =
-      FileOp::write(socket_fd_, write_buf_.get(), write_buf_len_);
+  StatusOr<int> write_or = write_chain_
+                               ? DoWriteV(write_chain_)
+                               : DoWrite(write_buf_.get(), write_buf_len_);
   if (write_or.status().IsTryAgain()) {
     return;
   }
@@ -458,8 +1081,191 @@ void TCPClientImpl::OnWriteDone() {
   DCHECK(ok);
   write_buf_.reset();
   write_buf_len_ = 0;
-  write_callback_(write_or);
+  write_chain_ = nullptr;
+  // The callback may start the next write
+  StatusOrIntCallback write_callback = std::move(write_callback_);
   write_callback_ = nullptr;
+  write_callback(write_or);
+}
+
+void TCPClientImpl::FlushWriteQueue() {
+  while (true) {
+    struct iovec iov[kMaxIOVecs];
+    int iovcnt = 0;
+    // Set if a file is at the front of the queue
+    int file_fd = -1;
+    uint64_t file_offset = 0;
+    size_t file_bytes = 0;
+    {
+      MutexLock lock(&write_queue_mutex_);
+      DCHECK(write_queue_flushing_);
+      write_queue_writable_ = false;
+      const QueuedWrite& front = queued_writes_.front();
+      if (front.file_fd != -1) {
+        file_fd = front.file_fd;
+        file_offset = front.file_offset + (front.size - front.remaining);
+        file_bytes = front.remaining;
+      } else {
+        iovcnt = write_queue_.FillIOVec(iov, kMaxIOVecs);
+        if (queued_files_ > 0) {
+          iovcnt = TrimIOVec(iov, iovcnt, BytesBeforeFileLocked());
+        }
+      }
+    }
+    // Other threads only append to the queue, so |iov| stays valid without
+    // the lock.
+    bool zero_copied = false;
+    StatusOr<int> write_or;
+    if (file_fd != -1) {
+      write_or = SocketOp::sendfile(socket_fd_, file_fd, &file_offset,
+                                    file_bytes);
+      if (write_or.ok() && write_or.value() == 0) {
+        write_or = Status::OutOfRange("File ended before the range was sent");
+      }
+    } else {
+      DCHECK_LT(0, iovcnt);
+      write_or = UseZeroCopy(IOVecBytes(iov, iovcnt))
+                     ? DoZeroCopyWrite(iov, iovcnt, &zero_copied)
+                     : SocketOp::writev(socket_fd_, iov, iovcnt);
+    }
+
+    std::deque<QueuedWrite> done;
+    Status error;
+    bool watch = false;
+    bool stop_watching = false;
+    bool high_water_changed = false;
+    {
+      MutexLock lock(&write_queue_mutex_);
+      if (write_or.ok()) {
+        size_t written = write_or.value();
+        if (file_fd != -1) {
+          queued_file_bytes_ -= written;
+        } else {
+          if (zero_copied) {
+            zero_copy_->AddSend(HeadBuffers(write_queue_, written));
+          }
+          write_queue_.Consume(written);
+        }
+        // Never past the first file, nor past the end of a file
+        while (written > 0) {
+          QueuedWrite* front = &queued_writes_.front();
+          size_t n = std::min(written, front->remaining);
+          front->remaining -= n;
+          written -= n;
+          if (front->remaining == 0) {
+            if (front->file_fd != -1) {
+              --queued_files_;
+            }
+            done.push_back(std::move(*front));
+            queued_writes_.pop_front();
+          }
+        }
+      } else if (!write_or.status().IsTryAgain()) {
+        error = write_or.status();
+        write_queue_error_ = error;
+        write_queue_.Clear();
+        done.swap(queued_writes_);
+        queued_files_ = 0;
+        queued_file_bytes_ = 0;
+      }
+
+      if (above_write_high_water_ &&
+          write_queue_.size() <= write_high_water_ / 2) {
+        above_write_high_water_ = false;
+        high_water_changed = true;
+      }
+
+      bool full = write_or.status().IsTryAgain() && !write_queue_writable_;
+      if (full && !write_queue_watching_) {
+        write_queue_watching_ = true;
+        watch = true;
+      } else if (queued_writes_.empty() && write_queue_watching_) {
+        write_queue_watching_ = false;
+        stop_watching = true;
+      }
+    }
+
+    // Still the only flushing thread, so the callbacks run in order
+    for (QueuedWrite& write : done) {
+      if (write.callback) {
+        write.callback(error.ok() ? StatusOr<int>(write.size)
+                                  : StatusOr<int>(error));
+      }
+    }
+    if (high_water_changed) {
+      ReportWriteHighWater();
+    }
+    // Never done under |write_queue_mutex_|: stopping a watch waits for a
+    // running OnFileWritable(), which may be waiting for the lock.
+    if (watch &&
+        !io_manager_->WatchFileDescriptor(socket_fd_, IOWatcher::kWatchWrite,
+                                          this, &write_socket_controller_)) {
+      Status watch_error = MapSystemError(errno);
+      LOG(ERROR) << "WatchFileIO failed on write";
+      // Nothing would resume the queue, so it fails
+      std::deque<QueuedWrite> failed;
+      {
+        MutexLock lock(&write_queue_mutex_);
+        write_queue_watching_ = false;
+        write_queue_error_ = watch_error;
+        write_queue_.Clear();
+        failed.swap(queued_writes_);
+        queued_files_ = 0;
+        queued_file_bytes_ = 0;
+        error = write_queue_error_;
+      }
+      for (QueuedWrite& write : failed) {
+        if (write.callback) {
+          write.callback(error);
+        }
+      }
+    }
+    if (stop_watching) {
+      bool ok = write_socket_controller_.StopWatching();
+      DCHECK(ok);
+    }
+
+    MutexLock lock(&write_queue_mutex_);
+    // Data queued by the callbacks, or by other threads meanwhile, is not
+    // left behind.
+    bool more = write_queue_error_.ok() && !queued_writes_.empty() &&
+                (write_or.ok() || write_queue_writable_ ||
+                 !write_queue_watching_);
+    if (!more) {
+      write_queue_flushing_ = false;
+      write_queue_flusher_ = Thread::invalid_id;
+      write_queue_idle_.SignalAll();
+      return;
+    }
+  }
+}
+
+size_t TCPClientImpl::BytesBeforeFileLocked() const {
+  size_t bytes = 0;
+  for (const QueuedWrite& write : queued_writes_) {
+    if (write.file_fd != -1) {
+      break;
+    }
+    bytes += write.remaining;
+  }
+  return bytes;
+}
+
+void TCPClientImpl::OnWriteQueueWritable() {
+  {
+    MutexLock lock(&write_queue_mutex_);
+    if (!write_queue_watching_) {
+      return;
+    }
+    if (write_queue_flushing_) {
+      // The flushing thread tries again
+      write_queue_writable_ = true;
+      return;
+    }
+    write_queue_flushing_ = true;
+    write_queue_flusher_ = CurrentThread::get_id();
+  }
+  FlushWriteQueue();
 }
 
 void TCPClientImpl::OnFileReadable(int fd) {
@@ -467,12 +1273,20 @@ void TCPClientImpl::OnFileReadable(int fd) {
   OnReadDone();
 }
 
+void TCPClientImpl::OnFileError(int fd) {
+  if (zero_copy_) {
+    zero_copy_->ReadCompletions(fd);
+  }
+}
+
 void TCPClientImpl::OnFileWritable(int fd) {
   DCHECK_NE(kNone, connect_state_);
   if (connect_state_ == kConnecting) {
     OnConnectDone(Status::OK());
-  } else {
+  } else if (write_callback_) {
     OnWriteDone();
+  } else {
+    OnWriteQueueWritable();
   }
 }
 
@@ -1,14 +1,27 @@
 #ifndef LIBIOMGR_IO_TCP_CLIENT_IMPL_H_
 #define LIBIOMGR_IO_TCP_CLIENT_IMPL_H_
 
+#include <sys/uio.h>
+
+#include <deque>
+#include <functional>
+#include <memory>
+
+#include "iomgr/io_buffer_chain.h"
 #include "iomgr/io_watcher.h"
 #include "iomgr/ref_counted.h"
+#include "iomgr/resource_quota.h"
+#include "io/zero_copy_tracker.h"
 #include "iomgr/tcp/tcp_client.h"
 #include "iomgr/timer.h"
+#include "threading/thread.h"
+#include "util/averaged_stats.h"
 #include "util/scoped_fd.h"
+#include "util/sync.h"
 
 namespace iomgr {
 
+class IOManager;
 class SockaddrStorage;
 
 class TCPClientImpl : public TCPClient, IOWatcher {
@@ -29,8 +42,20 @@ class TCPClientImpl : public TCPClient, IOWatcher {
   StatusOr<int> ReadIfReady(IOBuffer* buf, int buf_len,
                             StatusCallback read_callback) override;
   Status CancelReadIfReady() override;
+  StatusOr<int> ReadAutoSized(RefSlice* data,
+                              StatusOrIntCallback read_callback) override;
+  StatusOr<int> ReadV(IOBufferChain* chain, int max_bytes,
+                      StatusOrIntCallback read_callback) override;
   StatusOr<int> Write(IOBuffer* buf, int buf_len,
                       StatusOrIntCallback callback) override;
+  StatusOr<int> WriteV(IOBufferChain* chain,
+                       StatusOrIntCallback write_callback) override;
+  Status QueueWrite(RefSlice data, StatusOrIntCallback callback) override;
+  Status SendFile(int fd, uint64_t offset, size_t length,
+                  StatusOrIntCallback callback) override;
+  size_t QueuedWriteBytes() const override;
+  void SetWriteHighWater(size_t bytes,
+                         std::function<void(bool above)> callback) override;
   Status Disconnect() override;
   bool IsConnected() const override;
   Status GetLocalAddress(InetAddress* local) const override;
@@ -39,37 +64,128 @@ class TCPClientImpl : public TCPClient, IOWatcher {
   Status SetNoDelay(bool on_delay);
   Status SetReceiveBufferSize(int size);
   Status SetSendBufferSize(int size);
+  // Must be called before Connect()
+  Status SetFastOpenConnect();
+  // Sets SO_ZEROCOPY and starts tracking completions, see
+  // TCPClient::Options::zerocopy. Must be called before any write.
+  Status EnableZeroCopy();
+  // Same for an accepted socket, which inherits SO_ZEROCOPY from the
+  // listening socket
+  Status EnableInheritedZeroCopy();
+  // Replaces the process-wide quota. Must be called before any read.
+  void SetResourceQuota(ResourceQuota* quota);
+  // Replaces the global reactor. Must be called before the socket is
+  // watched, i.e. before any connect, read or write.
+  void set_io_manager(IOManager* io_manager) { io_manager_ = io_manager; }
+  IOManager* io_manager() const { return io_manager_; }
+  // For TCPRelay, which moves the bytes of an idle client itself
+  int socket_fd() const { return socket_fd_; }
   int ReleaseSocketFdForTesting() { return socket_fd_.release(); }
 
  private:
+  // Accepts with accept4(SOCK_NONBLOCK)
+  friend class TCPServerImpl;
+
   enum ConnectState {
     kNone,
     kConnecting,
     kConnected,
   };
 
+  struct QueuedWrite {
+    size_t size;
+    // Bytes not written yet
+    size_t remaining;
+    StatusOrIntCallback callback;
+    // -1 for data in |write_queue_|, otherwise the file sent from
+    // |file_offset|
+    int file_fd;
+    uint64_t file_offset;
+  };
+
+  // AdoptConnectedSocket() without the fcntl() calls, for a |socket| that is
+  // already non-blocking
+  Status AdoptNonBlockingSocket(int socket, const InetAddress& remote);
   Status DoConnect();
   StatusOr<int> DoRead(IOBuffer* buf, int buf_len);
+  StatusOr<int> DoReadAutoSized(RefSlice* data);
+  StatusOr<int> DoReadV(IOBufferChain* chain, int max_bytes);
+  // Bytes queued on the socket, checked before read buffers are allocated,
+  // so that a wakeup without data allocates nothing. Returns 0 at the end of
+  // the stream, and the error or Status::TryAgain() a read would return.
+  StatusOr<int> ReadableBytes();
+  // Number of bytes the next auto-sized read should ask for with |queued|
+  // bytes on the socket, at most |max_bytes|
+  size_t NextReadSize(size_t max_bytes, size_t queued);
+  // Feeds the result of an auto-sized read of |requested| bytes back into
+  // the prediction
+  void RecordReadSize(size_t requested, int bytes);
   StatusOr<int> DoWrite(IOBuffer* buf, int buf_len);
+  StatusOr<int> DoWriteV(IOBufferChain* chain);
+  // Return true if |bytes| of data are worth sending with MSG_ZEROCOPY
+  bool UseZeroCopy(size_t bytes) const;
+  // sendmsg() with MSG_ZEROCOPY, or writev() if the socket has too many
+  // pages pinned already. Sets |zero_copied| if the bytes written have to be
+  // held until their completion.
+  StatusOr<int> DoZeroCopyWrite(const struct iovec* iov, int iovcnt,
+                                bool* zero_copied);
+  // Store the callback and start watching the socket. Return
+  // Status::TryAgain() on success.
+  Status WatchForRead(StatusCallback read_callback);
+  Status WatchForWrite(StatusOrIntCallback write_callback);
   void RetryRead(Status ret);
+  void RetryReadAutoSized(Status ret);
+  void RetryReadV(Status ret);
   void OnConnectTimeout();
   void OnConnectDone(Status status);
   void OnReadDone();
+  // Counts the outcome of Fast Open once the connection is closed
+  void RecordFastOpenResult();
   void OnWriteDone();
+  // Queues |write|, whose data, if any, is |data|
+  Status AddToWriteQueue(QueuedWrite write, RefSlice data);
+  // Writes the queue until it is empty or the socket is full. Called by the
+  // thread that set |write_queue_flushing_|, which it clears on return.
+  void FlushWriteQueue();
+  // Bytes of |write_queue_| queued before the first file. Requires
+  // |write_queue_mutex_|.
+  size_t BytesBeforeFileLocked() const;
+  void OnWriteQueueWritable();
+  // Runs the high-water callback until it has seen the latest state, unless
+  // another thread is already running it. Called after a change of
+  // |above_write_high_water_|, without |write_queue_mutex_|.
+  void ReportWriteHighWater();
   void OnFileReadable(int fd) override;
   void OnFileWritable(int fd) override;
+  void OnFileError(int fd) override;
 
   ScopedFD socket_fd_;
+  // Reactor watching the socket
+  IOManager* io_manager_;
   Timer::Controller connect_timeout_controller_;
 
   IOWatcher::Controller connect_socket_controller_;
   StatusCallback connect_callback_;
   ConnectState connect_state_;
+  // True if connected with TCP Fast Open
+  bool fast_open_;
 
   IOWatcher::Controller read_socket_controller_;
   // Non-null when a Read() is in progress.
   RefPtr<IOBuffer> read_buf_;
   int read_buf_len_;
+  // Non-null when a ReadAutoSized() is in progress.
+  RefSlice* read_slice_;
+  // Non-null when a ReadV() is in progress.
+  IOBufferChain* read_chain_;
+  int read_chain_max_bytes_;
+  // Share of the connection in its ResourceQuota
+  RefPtr<ResourceUser> resource_user_;
+  // Time-decayed average of recent auto-sized reads
+  AveragedStats read_size_stats_;
+  // True if the last auto-sized read filled its buffer, so that more data is
+  // likely to be queued
+  bool last_read_filled_;
   StatusOrIntCallback read_callback_;
   // Non-null when a ReadIfReady() is in progress
   StatusCallback read_if_ready_callback_;
@@ -77,8 +193,40 @@ class TCPClientImpl : public TCPClient, IOWatcher {
   IOWatcher::Controller write_socket_controller_;
   RefPtr<IOBuffer> write_buf_;
   int write_buf_len_;
+  // Non-null when a WriteV() is in progress.
+  IOBufferChain* write_chain_;
   StatusOrIntCallback write_callback_;
 
+  // State of QueueWrite(), shared by the writing threads
+  mutable Mutex write_queue_mutex_;
+  IOBufferChain write_queue_;
+  std::deque<QueuedWrite> queued_writes_;
+  // Files in |queued_writes_|, and their bytes not sent yet
+  size_t queued_files_;
+  size_t queued_file_bytes_;
+  // Only one thread writes the queue to the socket at a time
+  bool write_queue_flushing_;
+  Thread::Id write_queue_flusher_;
+  // Signaled when |write_queue_flushing_| is cleared
+  CondVar write_queue_idle_;
+  // True while waiting for the socket to become writable
+  bool write_queue_watching_;
+  // Set if the socket became writable during a flush
+  bool write_queue_writable_;
+  // Error that stopped the queue
+  Status write_queue_error_;
+  size_t write_high_water_;
+  std::function<void(bool above)> write_high_water_callback_;
+  bool above_write_high_water_;
+  // State last passed to the high-water callback, and whether a thread is
+  // running it, so that changes are delivered one at a time and in order
+  bool reported_above_write_high_water_;
+  bool write_high_water_reporting_;
+
+  // Non-null with zero-copy writes on
+  std::unique_ptr<ZeroCopyTracker> zero_copy_;
+  IOWatcher::Controller error_socket_controller_;
+
   mutable std::unique_ptr<SockaddrStorage> local_address_;
   std::unique_ptr<SockaddrStorage> remote_address_;
 };
@@ -2,11 +2,26 @@
 
 #include <glog/logging.h>
 #include <gtest/gtest.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
 
 #include "io/test/async_test_callback.h"
 #include "iomgr/io_buffer.h"
+#include "iomgr/io_buffer_chain.h"
+#include "iomgr/io_buffer_pool.h"
+#include "iomgr/ref_slice.h"
+#include "iomgr/resource_quota.h"
 #include "iomgr/tcp/inet_address.h"
 #include "iomgr/tcp/tcp_server.h"
+#include "util/notification.h"
+#include "util/sync.h"
 
 namespace iomgr {
 
@@ -45,6 +60,22 @@ class TCPClientImplTest : public testing::Test {
     EXPECT_TRUE((*accepted_socket)->IsConnected());
   }
 
+  // Reads from |socket| until |size| bytes have arrived
+  std::string ReadAll(TCPClient* socket, size_t size) {
+    IOBufferChain incoming;
+    while (incoming.size() < size) {
+      StatusOrResultCallback read_callback;
+      StatusOr<int> read_result =
+          socket->ReadV(&incoming, size - incoming.size(),
+                        read_callback.callback());
+      read_result = read_callback.GetResult(read_result);
+      if (!read_result.ok() || read_result.value() == 0) {
+        break;
+      }
+    }
+    return incoming.ToString();
+  }
+
   std::unique_ptr<TCPServer> server_socket_;
   InetAddress server_address_;
 };
@@ -81,6 +112,32 @@ TEST_F(TCPClientImplTest, AdoptConnectedSocket) {
   EXPECT_EQ(accepted_address, adopted_address);
 }
 
+TEST_F(TCPClientImplTest, AdoptConnectedSocketSetsNonBlocking) {
+  std::unique_ptr<TCPClient> accepted_socket;
+  std::unique_ptr<TCPClient> connectint_sokcet;
+
+  CreateConnectedSockets(&accepted_socket, &connectint_sokcet, &local_host);
+  InetAddress remote;
+  EXPECT_TRUE(accepted_socket->GetRemoteAddress(&remote).ok());
+  std::unique_ptr<TCPClientImpl> tmp(
+      dynamic_cast<TCPClientImpl*>(accepted_socket.release()));
+  DCHECK(tmp);
+  int fd = tmp->ReleaseSocketFdForTesting();
+  int flags = ::fcntl(fd, F_GETFL);
+  ASSERT_EQ(0, ::fcntl(fd, F_SETFL, flags & ~O_NONBLOCK));
+
+  std::unique_ptr<TCPClientImpl> socket_(new TCPClientImpl);
+  EXPECT_TRUE(socket_->AdoptConnectedSocket(fd, remote).ok());
+  EXPECT_TRUE(::fcntl(socket_->socket_fd(), F_GETFL) & O_NONBLOCK);
+
+  // A read with nothing queued does not block
+  RefPtr<IOBufferWithSize> buffer = MakeRefCounted<IOBufferWithSize>(16);
+  StatusOrResultCallback read_callback;
+  StatusOr<int> read_result =
+      socket_->Read(buffer.get(), buffer->size(), read_callback.callback());
+  EXPECT_TRUE(read_result.status().IsTryAgain());
+}
+
 TEST_F(TCPClientImplTest, ReadWrite) {
   std::unique_ptr<TCPClient> accepted_socket;
   std::unique_ptr<TCPClient> connectint_sokcet;
@@ -183,6 +240,457 @@ TEST_F(TCPClientImplTest, MultiWrite) {
   EXPECT_EQ(message, received_message);
 }
 
+TEST_F(TCPClientImplTest, ReadVWriteV) {
+  std::unique_ptr<TCPClient> accepted_socket;
+  std::unique_ptr<TCPClient> connectint_sokcet;
+
+  CreateConnectedSockets(&accepted_socket, &connectint_sokcet, &local_host);
+
+  const std::string head("test ");
+  const std::string body(100 * 1024, 'x');
+  IOBufferChain outgoing;
+  outgoing.Append(MakeRefCounted<StringIOBuffer>(head), 0, head.size());
+  outgoing.Append(MakeRefCounted<StringIOBuffer>(body), 0, body.size());
+  const std::string message = outgoing.ToString();
+
+  IOBufferChain incoming;
+  while (!outgoing.empty() || incoming.size() < message.size()) {
+    if (!outgoing.empty()) {
+      size_t before = outgoing.size();
+      StatusOrResultCallback write_callback;
+      StatusOr<int> write_result =
+          accepted_socket->WriteV(&outgoing, write_callback.callback());
+      write_result = write_callback.GetResult(write_result);
+      EXPECT_TRUE(write_result.ok());
+      EXPECT_EQ(before - write_result.value(), outgoing.size());
+    }
+
+    size_t before = incoming.size();
+    StatusOrResultCallback read_callback;
+    StatusOr<int> read_result = connectint_sokcet->ReadV(
+        &incoming, message.size(), read_callback.callback());
+    read_result = read_callback.GetResult(read_result);
+    EXPECT_TRUE(read_result.ok());
+    EXPECT_LT(0, read_result.value());
+    EXPECT_EQ(before + read_result.value(), incoming.size());
+  }
+
+  EXPECT_EQ(message, incoming.ToString());
+}
+
+TEST_F(TCPClientImplTest, WriteMappedFile) {
+  std::unique_ptr<TCPClient> accepted_socket;
+  std::unique_ptr<TCPClient> connectint_sokcet;
+
+  CreateConnectedSockets(&accepted_socket, &connectint_sokcet, &local_host);
+
+  char path[] = "/tmp/tcp_client_impl_test_XXXXXX";
+  int fd = ::mkstemp(path);
+  ASSERT_GE(fd, 0);
+  const std::string content(200 * 1024, 'f');
+  ASSERT_EQ(static_cast<ssize_t>(content.size()),
+            ::write(fd, content.data(), content.size()));
+  ::close(fd);
+  RefPtr<MappedFileIOBuffer> file;
+  ASSERT_TRUE(MappedFileIOBuffer::Map(path, 0, 0, &file).ok());
+  ::unlink(path);
+  ASSERT_TRUE(file->Advise(MappedFileIOBuffer::kSequential).ok());
+
+  // Written straight from the page cache, behind a header on the heap
+  const std::string head("file ");
+  IOBufferChain outgoing;
+  outgoing.Append(MakeRefCounted<StringIOBuffer>(head), 0, head.size());
+  outgoing.Append(file, 0, file->size());
+  const std::string message = head + content;
+
+  IOBufferChain incoming;
+  while (!outgoing.empty() || incoming.size() < message.size()) {
+    if (!outgoing.empty()) {
+      StatusOrResultCallback write_callback;
+      StatusOr<int> write_result =
+          accepted_socket->WriteV(&outgoing, write_callback.callback());
+      write_result = write_callback.GetResult(write_result);
+      ASSERT_TRUE(write_result.ok());
+    }
+
+    StatusOrResultCallback read_callback;
+    StatusOr<int> read_result = connectint_sokcet->ReadV(
+        &incoming, message.size(), read_callback.callback());
+    read_result = read_callback.GetResult(read_result);
+    ASSERT_TRUE(read_result.ok());
+    ASSERT_LT(0, read_result.value());
+  }
+
+  EXPECT_EQ(message, incoming.ToString());
+  // The chain let go of the mapping once it was written
+  EXPECT_TRUE(file->HasOneRef());
+}
+
+TEST_F(TCPClientImplTest, ReadAutoSized) {
+  std::unique_ptr<TCPClient> accepted_socket;
+  std::unique_ptr<TCPClient> connectint_sokcet;
+
+  CreateConnectedSockets(&accepted_socket, &connectint_sokcet, &local_host);
+
+  const std::string message(64 * 1024, 'x');
+  RefPtr<DrainableIOBuffer> write_buffer = MakeRefCounted<DrainableIOBuffer>(
+      MakeRefCounted<StringIOBuffer>(message), message.size());
+  while (write_buffer->BytesRemaining() > 0) {
+    StatusOrResultCallback write_callback;
+    StatusOr<int> write_result = accepted_socket->Write(
+        write_buffer.get(), write_buffer->BytesRemaining(),
+        write_callback.callback());
+    write_result = write_callback.GetResult(write_result);
+    ASSERT_TRUE(write_result.ok());
+    write_buffer->DidConsume(write_result.value());
+  }
+
+  std::string received;
+  int reads = 0;
+  while (received.size() < message.size()) {
+    RefSlice data;
+    StatusOrResultCallback read_callback;
+    StatusOr<int> read_result =
+        connectint_sokcet->ReadAutoSized(&data, read_callback.callback());
+    read_result = read_callback.GetResult(read_result);
+    ASSERT_TRUE(read_result.ok());
+    ASSERT_LT(0, read_result.value());
+    EXPECT_EQ(read_result.value(), data.size());
+    received.append(data.data(), data.size());
+    ++reads;
+  }
+  EXPECT_EQ(message, received);
+  // Reads grow past the initial 4KiB once they fill their buffers
+  EXPECT_LT(reads, 16);
+}
+
+TEST_F(TCPClientImplTest, ReadAllocatesOnlyWithData) {
+  std::unique_ptr<TCPClient> accepted_socket;
+  std::unique_ptr<TCPClient> connectint_sokcet;
+
+  CreateConnectedSockets(&accepted_socket, &connectint_sokcet, &local_host);
+
+  IOBufferPool::Stats before = IOBufferPool::Get()->GetStats();
+  RefSlice data;
+  StatusOrResultCallback read_callback;
+  StatusOr<int> read_result =
+      connectint_sokcet->ReadAutoSized(&data, read_callback.callback());
+  EXPECT_TRUE(read_result.status().IsTryAgain());
+  // Left pending until Disconnect()
+  IOBufferChain chain;
+  StatusOrResultCallback readv_callback;
+  read_result =
+      accepted_socket->ReadV(&chain, 64 * 1024, readv_callback.callback());
+  EXPECT_TRUE(read_result.status().IsTryAgain());
+  // Nothing is queued, so no buffer was taken
+  IOBufferPool::Stats after = IOBufferPool::Get()->GetStats();
+  EXPECT_EQ(before.hits + before.misses, after.hits + after.misses);
+
+  const std::string message("hello");
+  StatusOrResultCallback write_callback;
+  RefPtr<StringIOBuffer> write_buffer = MakeRefCounted<StringIOBuffer>(message);
+  EXPECT_EQ(message.size(),
+            write_callback
+                .GetResult(accepted_socket->Write(write_buffer.get(),
+                                                  message.size(),
+                                                  write_callback.callback()))
+                .value());
+  EXPECT_EQ(message.size(), read_callback.WaitForResult().value());
+  EXPECT_EQ(message, data.ToString());
+
+  // The end of the stream is still reported
+  accepted_socket->Disconnect();
+  StatusOrResultCallback eof_callback;
+  read_result = connectint_sokcet->ReadAutoSized(&data, eof_callback.callback());
+  EXPECT_EQ(0, eof_callback.GetResult(read_result).value());
+}
+
+TEST_F(TCPClientImplTest, ReadWaitsForQuota) {
+  // Outlives the sockets
+  ResourceQuota quota;
+  quota.SetPerUserLimit(4096);
+  std::unique_ptr<TCPClient> accepted_socket;
+  std::unique_ptr<TCPClient> connectint_sokcet;
+
+  CreateConnectedSockets(&accepted_socket, &connectint_sokcet, &local_host);
+  dynamic_cast<TCPClientImpl*>(connectint_sokcet.get())
+      ->SetResourceQuota(&quota);
+
+  const std::string message(8 * 1024, 'x');
+  RefPtr<StringIOBuffer> write_buffer = MakeRefCounted<StringIOBuffer>(message);
+  StatusOrResultCallback write_callback;
+  StatusOr<int> write_result = accepted_socket->Write(
+      write_buffer.get(), write_buffer->size(), write_callback.callback());
+  write_result = write_callback.GetResult(write_result);
+  ASSERT_TRUE(write_result.ok());
+  ASSERT_EQ(message.size(), write_result.value());
+
+  // The first read takes the whole per-connection quota
+  RefSlice first;
+  StatusOrResultCallback first_callback;
+  StatusOr<int> read_result =
+      connectint_sokcet->ReadAutoSized(&first, first_callback.callback());
+  read_result = first_callback.GetResult(read_result);
+  ASSERT_TRUE(read_result.ok());
+  EXPECT_EQ(4096u, quota.used());
+
+  // The rest stays in the socket until the first read is released
+  RefSlice second;
+  StatusOrResultCallback second_callback;
+  read_result =
+      connectint_sokcet->ReadAutoSized(&second, second_callback.callback());
+  EXPECT_TRUE(read_result.status().IsTryAgain());
+  std::string received = first.ToString();
+  first.clear();
+  read_result = second_callback.GetResult(read_result);
+  ASSERT_TRUE(read_result.ok());
+  received.append(second.data(), second.size());
+  second.clear();
+  EXPECT_EQ(message.substr(0, received.size()), received);
+  EXPECT_EQ(0u, quota.used());
+}
+
+TEST_F(TCPClientImplTest, QueueWrite) {
+  std::unique_ptr<TCPClient> accepted_socket;
+  std::unique_ptr<TCPClient> connectint_sokcet;
+
+  CreateConnectedSockets(&accepted_socket, &connectint_sokcet, &local_host);
+
+  // Enough to fill the socket, so that most writes complete later
+  const int kWrites = 256;
+  const size_t kWriteSize = 32 * 1024;
+  Mutex mutex;
+  std::vector<int> completed;
+  Notification all_completed;
+  std::string message;
+  for (int i = 0; i < kWrites; ++i) {
+    std::string data(kWriteSize, 'a' + i % 26);
+    message.append(data);
+    Status status = accepted_socket->QueueWrite(
+        RefSlice::CopyFrom(data), [&, i](StatusOr<int> result) {
+          EXPECT_TRUE(result.ok());
+          EXPECT_EQ(kWriteSize, result.value());
+          MutexLock lock(&mutex);
+          completed.push_back(i);
+          if (completed.size() == kWrites) {
+            all_completed.Notify();
+          }
+        });
+    ASSERT_TRUE(status.ok());
+  }
+  EXPECT_LT(0u, accepted_socket->QueuedWriteBytes());
+
+  EXPECT_EQ(message, ReadAll(connectint_sokcet.get(), message.size()));
+  all_completed.WaitForNotification();
+  EXPECT_EQ(0u, accepted_socket->QueuedWriteBytes());
+  MutexLock lock(&mutex);
+  for (int i = 0; i < kWrites; ++i) {
+    EXPECT_EQ(i, completed[i]);
+  }
+}
+
+TEST_F(TCPClientImplTest, QueueWriteFromManyThreads) {
+  std::unique_ptr<TCPClient> accepted_socket;
+  std::unique_ptr<TCPClient> connectint_sokcet;
+
+  CreateConnectedSockets(&accepted_socket, &connectint_sokcet, &local_host);
+
+  // Each record is "<thread> <sequence>", padded to a fixed size
+  const int kThreads = 4;
+  const int kRecords = 2000;
+  const size_t kRecordSize = 64;
+  std::vector<std::thread> producers;
+  for (int t = 0; t < kThreads; ++t) {
+    producers.emplace_back([&, t]() {
+      for (int i = 0; i < kRecords; ++i) {
+        std::string record(kRecordSize, ' ');
+        snprintf(&record[0], kRecordSize, "%d %d", t, i);
+        EXPECT_TRUE(
+            accepted_socket->QueueWrite(RefSlice::CopyFrom(record), nullptr)
+                .ok());
+      }
+    });
+  }
+
+  std::string received = ReadAll(connectint_sokcet.get(),
+                                 kThreads * kRecords * kRecordSize);
+  for (auto& producer : producers) {
+    producer.join();
+  }
+  ASSERT_EQ(kThreads * kRecords * kRecordSize, received.size());
+  // Writes of one thread arrive in the order they were queued
+  std::vector<int> next(kThreads, 0);
+  for (size_t pos = 0; pos < received.size(); pos += kRecordSize) {
+    int t;
+    int i;
+    ASSERT_EQ(2, sscanf(received.c_str() + pos, "%d %d", &t, &i));
+    ASSERT_LE(0, t);
+    ASSERT_GT(kThreads, t);
+    EXPECT_EQ(next[t]++, i);
+  }
+}
+
+TEST_F(TCPClientImplTest, QueueWriteHighWater) {
+  std::unique_ptr<TCPClient> accepted_socket;
+  std::unique_ptr<TCPClient> connectint_sokcet;
+
+  CreateConnectedSockets(&accepted_socket, &connectint_sokcet, &local_host);
+
+  const size_t kHighWater = 1024 * 1024;
+  Mutex mutex;
+  std::vector<bool> pressure;
+  Notification drained;
+  accepted_socket->SetWriteHighWater(kHighWater, [&](bool above) {
+    MutexLock lock(&mutex);
+    pressure.push_back(above);
+    if (!above) {
+      drained.Notify();
+    }
+  });
+
+  // Nobody reads yet, so the queue grows past the mark
+  const std::string data(64 * 1024, 'x');
+  size_t queued = 0;
+  while (accepted_socket->QueuedWriteBytes() <= kHighWater) {
+    ASSERT_TRUE(
+        accepted_socket->QueueWrite(RefSlice::CopyFrom(data), nullptr).ok());
+    queued += data.size();
+  }
+  {
+    MutexLock lock(&mutex);
+    ASSERT_EQ(1u, pressure.size());
+    EXPECT_TRUE(pressure[0]);
+  }
+
+  EXPECT_EQ(queued, ReadAll(connectint_sokcet.get(), queued).size());
+  drained.WaitForNotification();
+  MutexLock lock(&mutex);
+  ASSERT_EQ(2u, pressure.size());
+  EXPECT_FALSE(pressure[1]);
+}
+
+TEST_F(TCPClientImplTest, QueueWriteHighWaterFromManyThreads) {
+  std::unique_ptr<TCPClient> accepted_socket;
+  std::unique_ptr<TCPClient> connectint_sokcet;
+
+  CreateConnectedSockets(&accepted_socket, &connectint_sokcet, &local_host);
+
+  // Low enough that the producers and the flushes cross it all the time
+  const size_t kHighWater = 64 * 1024;
+  std::atomic<int> running(0);
+  Mutex mutex;
+  std::vector<bool> pressure;
+  accepted_socket->SetWriteHighWater(kHighWater, [&](bool above) {
+    EXPECT_EQ(0, running.fetch_add(1));
+    {
+      MutexLock lock(&mutex);
+      pressure.push_back(above);
+    }
+    running.fetch_sub(1);
+  });
+
+  const int kThreads = 4;
+  const int kWrites = 200;
+  const std::string data(16 * 1024, 'x');
+  std::vector<std::thread> producers;
+  for (int t = 0; t < kThreads; ++t) {
+    producers.emplace_back([&]() {
+      for (int i = 0; i < kWrites; ++i) {
+        EXPECT_TRUE(
+            accepted_socket->QueueWrite(RefSlice::CopyFrom(data), nullptr)
+                .ok());
+      }
+    });
+  }
+
+  size_t total = kThreads * kWrites * data.size();
+  EXPECT_EQ(total, ReadAll(connectint_sokcet.get(), total).size());
+  for (auto& producer : producers) {
+    producer.join();
+  }
+  MutexLock lock(&mutex);
+  ASSERT_FALSE(pressure.empty());
+  // Never two reports of the same state in a row
+  for (size_t i = 0; i < pressure.size(); ++i) {
+    EXPECT_EQ(i % 2 == 0, pressure[i]) << "report " << i;
+  }
+}
+
+TEST_F(TCPClientImplTest, SendFile) {
+  std::unique_ptr<TCPClient> accepted_socket;
+  std::unique_ptr<TCPClient> connectint_sokcet;
+
+  CreateConnectedSockets(&accepted_socket, &connectint_sokcet, &local_host);
+
+  char path[] = "/tmp/tcp_client_impl_test_XXXXXX";
+  int fd = ::mkstemp(path);
+  ASSERT_GE(fd, 0);
+  ::unlink(path);
+  // Enough to fill the socket, so that the file is sent in several rounds
+  std::string content(8 << 20, 0);
+  for (size_t i = 0; i < content.size(); ++i) {
+    content[i] = 'a' + i % 26;
+  }
+  ASSERT_EQ(static_cast<ssize_t>(content.size()),
+            ::write(fd, content.data(), content.size()));
+
+  // In queue order, between writes from memory
+  const std::string head("head ");
+  const std::string tail(" tail");
+  const size_t kOffset = 100;
+  const size_t kLength = content.size() - 2 * kOffset;
+  std::vector<int> completed;
+  Mutex mutex;
+  Notification all_completed;
+  auto on_completed = [&](int index, size_t size, StatusOr<int> result) {
+    EXPECT_TRUE(result.ok());
+    EXPECT_EQ(size, result.value());
+    MutexLock lock(&mutex);
+    completed.push_back(index);
+    if (completed.size() == 3) {
+      all_completed.Notify();
+    }
+  };
+  using std::placeholders::_1;
+  EXPECT_TRUE(accepted_socket
+                  ->QueueWrite(RefSlice::CopyFrom(head),
+                               std::bind(on_completed, 0, head.size(), _1))
+                  .ok());
+  EXPECT_TRUE(accepted_socket
+                  ->SendFile(fd, kOffset, kLength,
+                             std::bind(on_completed, 1, kLength, _1))
+                  .ok());
+  EXPECT_TRUE(accepted_socket
+                  ->QueueWrite(RefSlice::CopyFrom(tail),
+                               std::bind(on_completed, 2, tail.size(), _1))
+                  .ok());
+  const std::string message = head + content.substr(kOffset, kLength) + tail;
+  // Nothing reads yet, so part of the file waits in the queue
+  EXPECT_LT(0u, accepted_socket->QueuedWriteBytes());
+  EXPECT_GE(message.size(), accepted_socket->QueuedWriteBytes());
+
+  EXPECT_EQ(message, ReadAll(connectint_sokcet.get(), message.size()));
+  all_completed.WaitForNotification();
+  EXPECT_EQ(0u, accepted_socket->QueuedWriteBytes());
+  {
+    MutexLock lock(&mutex);
+    EXPECT_EQ(std::vector<int>({0, 1, 2}), completed);
+  }
+  // The file position was left alone
+  EXPECT_EQ(static_cast<off_t>(content.size()), ::lseek(fd, 0, SEEK_CUR));
+
+  // A range past the end of the file stops the queue
+  StatusOrResultCallback past_end_callback;
+  EXPECT_TRUE(accepted_socket
+                  ->SendFile(fd, content.size() - 10, 20,
+                             past_end_callback.callback())
+                  .ok());
+  EXPECT_TRUE(past_end_callback.WaitForResult().status().IsOutOfRange());
+  EXPECT_EQ(std::string(content, content.size() - 10),
+            ReadAll(connectint_sokcet.get(), 10));
+  ::close(fd);
+}
+
 TEST_F(TCPClientImplTest, ReadIfReady) {
   std::unique_ptr<TCPClient> accepted_socket;
   std::unique_ptr<TCPClient> connectint_sokcet;
@@ -314,7 +822,9 @@ TEST_F(TCPClientImplTest, IsConnected) {
   Status connect_result = TCPClient::Connect(
       server_address_, TCPClient::Options(), connect_callback.callback(),
       &local_host, &connectint_sokcet);
-  EXPECT_FALSE(connectint_sokcet->IsConnected());
+  // Not checked before the connect callback runs: the handshake on loopback
+  // completes without waiting for Accept(), so the result would be racy.
+  // ConnectRefused covers a client that is not connected.
 
   std::unique_ptr<TCPClient> accepted_socket;
   StatusResultCallback accept_callback;
@@ -328,6 +838,43 @@ TEST_F(TCPClientImplTest, IsConnected) {
   EXPECT_TRUE(connectint_sokcet->IsConnected());
 }
 
+TEST_F(TCPClientImplTest, ConnectRefused) {
+  // Nothing listens on the port any more
+  InetAddress closed_address = server_address_;
+  server_socket_.reset();
+
+  std::unique_ptr<TCPClient> connectint_sokcet;
+  StatusResultCallback connect_callback;
+  Status connect_result = TCPClient::Connect(
+      closed_address, TCPClient::Options(), connect_callback.callback(),
+      &local_host, &connectint_sokcet);
+  // Also when the refusal is only reported once the connect completes
+  EXPECT_FALSE(connect_callback.GetResult(connect_result).ok());
+  EXPECT_FALSE(connectint_sokcet->IsConnected());
+}
+
+TEST_F(TCPClientImplTest, ConnectCancelsTimeout) {
+  TCPClient::Options client_options;
+  client_options.connect_timeout = Time::Delta::FromMilliseconds(50);
+  std::unique_ptr<TCPClient> connectint_sokcet;
+  StatusResultCallback connect_callback;
+  Status connect_result = TCPClient::Connect(
+      server_address_, client_options, connect_callback.callback(),
+      &local_host, &connectint_sokcet);
+
+  std::unique_ptr<TCPClient> accepted_socket;
+  StatusResultCallback accept_callback;
+  Status accept_result =
+      server_socket_->Accept(&accepted_socket, accept_callback.callback());
+  EXPECT_TRUE(accept_callback.GetResult(accept_result).ok());
+  EXPECT_TRUE(connect_callback.GetResult(connect_result).ok());
+
+  // The timeout is gone, it neither runs the callback again nor fails the
+  // connection
+  usleep(100 * 1000);
+  EXPECT_TRUE(connectint_sokcet->IsConnected());
+}
+
 TEST_F(TCPClientImplTest, DisConnect) {
   std::unique_ptr<TCPClient> accepted_socket;
   std::unique_ptr<TCPClient> connectint_sokcet;
@@ -367,6 +914,157 @@ TEST_F(TCPClientImplTest, DisConnect) {
   EXPECT_EQ(0, read_result.value());
 }
 
+TEST_F(TCPClientImplTest, FastOpen) {
+  TCPServer::Options server_options(true, kListenBacklog);
+  server_options.fast_open_queue_length = 16;
+  std::unique_ptr<TCPServer> server;
+  ASSERT_TRUE(TCPServer::Listen(local_host, server_options, &server).ok());
+  InetAddress address;
+  EXPECT_TRUE(server->GetLocalAddress(&address).ok());
+
+  TCPClient::Options client_options;
+  client_options.fast_open = true;
+  const std::string message = "abcdef";
+  TCPClient::FastOpenStats before = TCPClient::GetFastOpenStats();
+  // The first connection fetches a cookie that the second one may use
+  for (int i = 0; i < 2; ++i) {
+    std::unique_ptr<TCPClient> client;
+    StatusResultCallback connect_callback;
+    // With a cookie nothing is sent until the first write
+    Status connect_result =
+        TCPClient::Connect(address, client_options,
+                           connect_callback.callback(), nullptr, &client);
+    EXPECT_TRUE(connect_callback.GetResult(connect_result).ok());
+
+    RefPtr<StringIOBuffer> write_buffer =
+        MakeRefCounted<StringIOBuffer>(message);
+    StatusOrResultCallback write_callback;
+    StatusOr<int> write_result = client->Write(
+        write_buffer.get(), write_buffer->size(), write_callback.callback());
+    write_result = write_callback.GetResult(write_result);
+    EXPECT_TRUE(write_result.ok());
+    EXPECT_EQ(message.size(), write_result.value());
+
+    std::unique_ptr<TCPClient> accepted;
+    StatusResultCallback accept_callback;
+    Status accept_result =
+        server->Accept(&accepted, accept_callback.callback());
+    EXPECT_TRUE(accept_callback.GetResult(accept_result).ok());
+    EXPECT_EQ(message, ReadAll(accepted.get(), message.size()));
+    client->Disconnect();
+  }
+
+  TCPClient::FastOpenStats after = TCPClient::GetFastOpenStats();
+  EXPECT_EQ(before.attempts + 2, after.attempts);
+  EXPECT_EQ(after.attempts, after.succeeded + after.fell_back);
+  // Whether SYN data is taken depends on net.ipv4.tcp_fastopen
+  EXPECT_EQ(after.succeeded - before.succeeded,
+            server->fast_open_connections());
+}
+
+// Large writes are sent with MSG_ZEROCOPY, and their buffers are held until
+// the kernel is done with them
+TEST_F(TCPClientImplTest, ZeroCopyWrite) {
+  TCPServer::Options server_options(true, kListenBacklog);
+  server_options.zerocopy = true;
+  std::unique_ptr<TCPServer> server;
+  ASSERT_TRUE(TCPServer::Listen(local_host, server_options, &server).ok());
+  InetAddress address;
+  EXPECT_TRUE(server->GetLocalAddress(&address).ok());
+
+  TCPClient::Options client_options;
+  client_options.zerocopy = true;
+  std::unique_ptr<TCPClient> client;
+  StatusResultCallback connect_callback;
+  Status connect_result = TCPClient::Connect(
+      address, client_options, connect_callback.callback(), nullptr, &client);
+  std::unique_ptr<TCPClient> accepted;
+  StatusResultCallback accept_callback;
+  Status accept_result = server->Accept(&accepted, accept_callback.callback());
+  EXPECT_TRUE(accept_callback.GetResult(accept_result).ok());
+  EXPECT_TRUE(connect_callback.GetResult(connect_result).ok());
+
+  TCPClient::ZeroCopyStats before = TCPClient::GetZeroCopyStats();
+  const size_t kLargeSize = 256 * 1024;
+  RefPtr<IOBufferWithSize> large = MakeRefCounted<IOBufferWithSize>(kLargeSize);
+  for (size_t i = 0; i < kLargeSize; ++i) {
+    large->data()[i] = static_cast<char>('a' + i % 26);
+  }
+  const std::string small("small write, copied");
+  // Queued behind the large write, the small one goes out with it
+  StatusOrResultCallback write_callback;
+  EXPECT_TRUE(
+      accepted->QueueWrite(RefSlice(large, 0, kLargeSize), nullptr).ok());
+  EXPECT_TRUE(accepted
+                  ->QueueWrite(RefSlice::CopyFrom(Slice(small)),
+                               write_callback.callback())
+                  .ok());
+  EXPECT_EQ(std::string(large->data(), kLargeSize) + small,
+            ReadAll(client.get(), kLargeSize + small.size()));
+  EXPECT_EQ(small.size(), write_callback.WaitForResult().value());
+
+  // And from the connecting side with Write()
+  RefPtr<IOBufferWithSize> chunk =
+      MakeRefCounted<IOBufferWithSize>(TCPClient::kZeroCopyMinBytes);
+  memset(chunk->data(), 'z', chunk->size());
+  StatusOrResultCallback chunk_callback;
+  StatusOr<int> chunk_result = client->Write(chunk.get(), chunk->size(),
+                                             chunk_callback.callback());
+  chunk_result = chunk_callback.GetResult(chunk_result);
+  ASSERT_TRUE(chunk_result.ok());
+  EXPECT_EQ(std::string(chunk_result.value(), 'z'),
+            ReadAll(accepted.get(), chunk_result.value()));
+
+  // Completions arrive on the error queues shortly after the data is sent
+  for (int i = 0; i < 500 && !(large->HasOneRef() && chunk->HasOneRef());
+       ++i) {
+    usleep(10 * 1000);
+  }
+  EXPECT_TRUE(large->HasOneRef());
+  EXPECT_TRUE(chunk->HasOneRef());
+  TCPClient::ZeroCopyStats after = TCPClient::GetZeroCopyStats();
+  EXPECT_LT(before.completed + 1, after.completed);
+  // Loopback always copies in the end
+  EXPECT_LE(after.copied - before.copied, after.completed - before.completed);
+}
+
+// A client disconnected with zero-copy sends in flight leaves the socket open
+// until they complete, so that the data still goes out
+TEST_F(TCPClientImplTest, DisconnectWithZeroCopyInFlight) {
+  TCPClient::Options client_options;
+  client_options.zerocopy = true;
+  std::unique_ptr<TCPClient> client;
+  StatusResultCallback connect_callback;
+  Status connect_result =
+      TCPClient::Connect(server_address_, client_options,
+                         connect_callback.callback(), nullptr, &client);
+  std::unique_ptr<TCPClient> accepted;
+  StatusResultCallback accept_callback;
+  Status accept_result =
+      server_socket_->Accept(&accepted, accept_callback.callback());
+  EXPECT_TRUE(accept_callback.GetResult(accept_result).ok());
+  EXPECT_TRUE(connect_callback.GetResult(connect_result).ok());
+
+  // Held back by the window of the peer, which does not read yet
+  const size_t kSize = 1 << 20;
+  RefPtr<IOBufferWithSize> buffer = MakeRefCounted<IOBufferWithSize>(kSize);
+  memset(buffer->data(), 'q', kSize);
+  StatusOrResultCallback write_callback;
+  StatusOr<int> write_result =
+      client->Write(buffer.get(), kSize, write_callback.callback());
+  write_result = write_callback.GetResult(write_result);
+  ASSERT_TRUE(write_result.ok());
+  client->Disconnect();
+  EXPECT_FALSE(buffer->HasOneRef());
+
+  EXPECT_EQ(std::string(write_result.value(), 'q'),
+            ReadAll(accepted.get(), write_result.value()));
+  for (int i = 0; i < 500 && !buffer->HasOneRef(); ++i) {
+    usleep(10 * 1000);
+  }
+  EXPECT_TRUE(buffer->HasOneRef());
+}
+
 }  // namespace iomgr
 
 int main(int argc, char** argv) {
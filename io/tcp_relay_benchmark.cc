@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "iomgr/tcp/inet_address.h"
+#include "iomgr/tcp/tcp_client.h"
+#include "iomgr/tcp/tcp_relay.h"
+#include "iomgr/tcp/tcp_server.h"
+#include "iomgr/time.h"
+#include "util/notification.h"
+#include "util/sockaddr_storage.h"
+
+namespace iomgr {
+
+static const size_t kBytesPerRun = 1024 << 20;
+
+// CPU time of the whole process, the relay and both ends
+static Time::Delta CPUTime() {
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return Time::Delta::FromMicroseconds(ts.tv_sec * 1000000 +
+                                       ts.tv_nsec / 1000);
+}
+
+// Connects to |server| and returns the connected socket, with the accepted
+// side in |accepted|
+static int Connect(TCPServer* server, std::unique_ptr<TCPClient>* accepted) {
+  InetAddress address;
+  server->GetLocalAddress(&address);
+  SockaddrStorage storage(address);
+  int fd = ::socket(storage.address_family(), SOCK_STREAM, 0);
+  if (::connect(fd, storage.addr, storage.addr_len) < 0) {
+    perror("connect");
+    ::close(fd);
+    return -1;
+  }
+  Notification done;
+  Status status = server->Accept(accepted, [&done](Status) { done.Notify(); });
+  if (status.IsTryAgain()) {
+    done.WaitForNotification();
+  }
+  if (!*accepted) {
+    ::close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+void Measure(const char* name, const TCPRelay::Options& relay_options) {
+  std::unique_ptr<TCPServer> server;
+  Status status = TCPServer::Listen(InetAddress("127.0.0.1", 0),
+                                    TCPServer::Options(true, 5), &server);
+  if (!status.ok()) {
+    printf("listen failed: %s\n", status.ToString().c_str());
+    return;
+  }
+  std::unique_ptr<TCPClient> first;
+  std::unique_ptr<TCPClient> second;
+  int sender_fd = Connect(server.get(), &first);
+  int receiver_fd = Connect(server.get(), &second);
+  if (sender_fd == -1 || receiver_fd == -1) {
+    printf("accept failed\n");
+    return;
+  }
+
+  Notification done;
+  std::unique_ptr<TCPRelay> relay;
+  status = TCPRelay::Start(std::move(first), std::move(second), relay_options,
+                           [&done](Status) { done.Notify(); }, &relay);
+  if (!status.ok()) {
+    printf("relay failed: %s\n", status.ToString().c_str());
+    return;
+  }
+
+  Time::Delta cpu_start = CPUTime();
+  Time start = Time::Now();
+  std::thread sender([sender_fd]() {
+    std::vector<char> buffer(1 << 20, 'x');
+    size_t left = kBytesPerRun;
+    while (left > 0) {
+      ssize_t n = ::send(sender_fd, buffer.data(),
+                         std::min(left, buffer.size()), 0);
+      if (n <= 0) {
+        break;
+      }
+      left -= n;
+    }
+    ::shutdown(sender_fd, SHUT_WR);
+  });
+  // Drains the relay as fast as it can
+  std::vector<char> buffer(1 << 20);
+  while (::recv(receiver_fd, buffer.data(), buffer.size(), 0) > 0) {
+  }
+  ::shutdown(receiver_fd, SHUT_WR);
+  sender.join();
+  done.WaitForNotification();
+  Time::Delta elapsed = Time::Now() - start;
+  Time::Delta cpu = CPUTime() - cpu_start;
+
+  TCPRelay::DirectionStats stats = relay->GetStats().first_to_second;
+  double gigabytes = stats.bytes / 1e9;
+  printf("%-20s %8.0f MB/s %6.2f CPU s/GB, relay %8.0f MB/s\n", name,
+         gigabytes * 1e9 / elapsed.ToMicroseconds(),
+         cpu.ToMicroseconds() / 1e6 / gigabytes,
+         stats.bytes_per_second / 1e6);
+  relay.reset();
+  ::close(sender_fd);
+  ::close(receiver_fd);
+}
+
+}  // namespace iomgr
+
+int main(int argc, char** argv) {
+  iomgr::TCPRelay::Options options;
+  options.splice = false;
+  iomgr::Measure("copy", options);
+  options.buffer_size = 1 << 20;
+  iomgr::Measure("copy, 1 MB buffers", options);
+  options.splice = true;
+  iomgr::Measure("splice", options);
+  options.pipe_size = 1 << 20;
+  iomgr::Measure("splice, 1 MB pipes", options);
+  return 0;
+}
@@ -0,0 +1,285 @@
+#include "io/tcp_relay_impl.h"
+
+#include <glog/logging.h>
+#include <sys/socket.h>
+
+#include "io/io_manager.h"
+#include "util/file_op.h"
+#include "util/os_error.h"
+#include "util/socket_op.h"
+
+namespace iomgr {
+
+TCPRelay::TCPRelay() = default;
+
+TCPRelay::~TCPRelay() = default;
+
+Status TCPRelay::Start(std::unique_ptr<TCPClient> first,
+                       std::unique_ptr<TCPClient> second,
+                       const Options& options, StatusCallback done_callback,
+                       std::unique_ptr<TCPRelay>* relay) {
+  DCHECK(first);
+  DCHECK(second);
+  DCHECK(done_callback);
+  DCHECK(relay);
+
+  // Every TCPClient is a TCPClientImpl, whose socket the relay works on
+  std::unique_ptr<TCPRelayImpl> impl(new TCPRelayImpl(
+      std::unique_ptr<TCPClientImpl>(
+          static_cast<TCPClientImpl*>(first.release())),
+      std::unique_ptr<TCPClientImpl>(
+          static_cast<TCPClientImpl*>(second.release())),
+      std::move(done_callback)));
+  if (!impl) {
+    return Status::OutOfMemory("Failed to allocate TCPRelay");
+  }
+
+  Status status;
+  if (options.splice && !(status = impl->UseSplice(options.pipe_size)).ok()) {
+    LOG(WARNING) << "Copying instead of splicing: " << status.ToString();
+  }
+  if (!options.splice || !status.ok()) {
+    impl->UseCopy(options.buffer_size);
+  }
+  if (!(status = impl->Start()).ok()) {
+    return status;
+  }
+  *relay = std::move(impl);
+  return Status();
+}
+
+TCPRelayImpl::Direction::Direction(int from_fd, int to_fd)
+    : from_fd(from_fd),
+      to_fd(to_fd),
+      mutex(),
+      pipe_read_fd(),
+      pipe_write_fd(),
+      pipe_capacity(0),
+      buffer(),
+      buffer_size(0),
+      buffer_offset(0),
+      pending(0),
+      bytes(0),
+      eof(false),
+      closed(false),
+      closed_time(Time::Zero()) {}
+
+TCPRelayImpl::TCPRelayImpl(std::unique_ptr<TCPClientImpl> first,
+                           std::unique_ptr<TCPClientImpl> second,
+                           StatusCallback done_callback)
+    : first_(std::move(first)),
+      second_(std::move(second)),
+      start_time_(Time::Now()),
+      spliced_(false),
+      first_to_second_(first_->socket_fd(), second_->socket_fd()),
+      second_to_first_(second_->socket_fd(), first_->socket_fd()),
+      first_controller_(),
+      second_controller_(),
+      mutex_(),
+      done_callback_(std::move(done_callback)),
+      closed_directions_(0),
+      finished_(false) {
+  DCHECK_NE(-1, first_->socket_fd());
+  DCHECK_NE(-1, second_->socket_fd());
+}
+
+TCPRelayImpl::~TCPRelayImpl() {
+  // Waits for the pumps in progress
+  bool ok = first_controller_.StopWatching();
+  DCHECK(ok);
+  ok = second_controller_.StopWatching();
+  DCHECK(ok);
+}
+
+Status TCPRelayImpl::UseSplice(int pipe_size) {
+  for (Direction* direction : {&first_to_second_, &second_to_first_}) {
+    int fds[2];
+    Status status = FileOp::pipe(fds, true);
+    if (!status.ok()) {
+      return status;
+    }
+    direction->pipe_read_fd.reset(fds[0]);
+    direction->pipe_write_fd.reset(fds[1]);
+    StatusOr<int> capacity = pipe_size > 0
+                                 ? FileOp::set_pipe_size(fds[1], pipe_size)
+                                 : FileOp::get_pipe_size(fds[1]);
+    if (!capacity.ok()) {
+      direction->pipe_read_fd.reset();
+      direction->pipe_write_fd.reset();
+      return capacity.status();
+    }
+    direction->pipe_capacity = capacity.value();
+  }
+  spliced_ = true;
+  return Status();
+}
+
+void TCPRelayImpl::UseCopy(size_t size) {
+  DCHECK_LT(0u, size);
+  for (Direction* direction : {&first_to_second_, &second_to_first_}) {
+    direction->pipe_read_fd.reset();
+    direction->pipe_write_fd.reset();
+    direction->buffer = MakeRefCounted<IOBufferWithSize>(size);
+    direction->buffer_size = size;
+  }
+  spliced_ = false;
+}
+
+Status TCPRelayImpl::Start() {
+  // Both ways at once, the bytes already received are reported right away
+  if (!first_->io_manager()->WatchFileDescriptor(
+          first_->socket_fd(), IOWatcher::kWatchReadWrite, this,
+          &first_controller_) ||
+      !second_->io_manager()->WatchFileDescriptor(
+          second_->socket_fd(), IOWatcher::kWatchReadWrite, this,
+          &second_controller_)) {
+    LOG(ERROR) << "WatchFileIO failed on relay";
+    Status status = MapSystemError(errno);
+    first_controller_.StopWatching();
+    return status;
+  }
+  return Status();
+}
+
+TCPRelay::Stats TCPRelayImpl::GetStats() const {
+  Time now = Time::Now();
+  Stats stats;
+  stats.spliced = spliced_;
+  stats.first_to_second = GetDirectionStats(first_to_second_, now);
+  stats.second_to_first = GetDirectionStats(second_to_first_, now);
+  return stats;
+}
+
+void TCPRelayImpl::Pump(Direction* direction) {
+  if (finished()) {
+    return;
+  }
+
+  Status status;
+  bool closed = false;
+  {
+    MutexLock lock(&direction->mutex);
+    if (direction->closed) {
+      return;
+    }
+    bool progress = true;
+    while (progress) {
+      progress = false;
+      bool can_fill = direction->pipe_write_fd != -1
+                          ? direction->pending < direction->pipe_capacity
+                          : direction->pending == 0;
+      if (!direction->eof && can_fill) {
+        StatusOr<int> filled = Fill(direction);
+        if (filled.ok()) {
+          direction->eof = filled.value() == 0;
+          direction->pending += filled.value();
+          progress = true;
+        } else if (!filled.status().IsTryAgain()) {
+          status = filled.status();
+          break;
+        }
+        // A full pipe also means TryAgain, draining it makes room
+      }
+      if (direction->pending > 0) {
+        StatusOr<int> drained = Drain(direction);
+        if (drained.ok()) {
+          direction->pending -= drained.value();
+          direction->bytes += drained.value();
+          progress = progress || drained.value() > 0;
+        } else if (!drained.status().IsTryAgain()) {
+          status = drained.status();
+          break;
+        }
+      }
+      if (direction->eof && direction->pending == 0) {
+        // Half-close, the other direction goes on
+        status = SocketOp::shutdown(direction->to_fd, SHUT_WR);
+        direction->closed = true;
+        direction->closed_time = Time::Now();
+        closed = status.ok();
+        break;
+      }
+    }
+  }
+  if (!status.ok()) {
+    Finish(status);
+  } else if (closed) {
+    OnDirectionClosed();
+  }
+}
+
+StatusOr<int> TCPRelayImpl::Fill(Direction* direction) {
+  if (direction->pipe_write_fd != -1) {
+    return FileOp::splice(direction->from_fd, direction->pipe_write_fd,
+                          direction->pipe_capacity - direction->pending);
+  }
+  direction->buffer_offset = 0;
+  return FileOp::read(direction->from_fd, direction->buffer->data(),
+                      direction->buffer_size);
+}
+
+StatusOr<int> TCPRelayImpl::Drain(Direction* direction) {
+  if (direction->pipe_read_fd != -1) {
+    return FileOp::splice(direction->pipe_read_fd, direction->to_fd,
+                          direction->pending);
+  }
+  StatusOr<int> wrote = FileOp::write(
+      direction->to_fd, direction->buffer->data() + direction->buffer_offset,
+      direction->pending);
+  if (wrote.ok()) {
+    direction->buffer_offset += wrote.value();
+  }
+  return wrote;
+}
+
+void TCPRelayImpl::OnDirectionClosed() {
+  {
+    MutexLock lock(&mutex_);
+    if (++closed_directions_ < 2) {
+      return;
+    }
+  }
+  Finish(Status::OK());
+}
+
+void TCPRelayImpl::Finish(Status status) {
+  StatusCallback done_callback;
+  {
+    MutexLock lock(&mutex_);
+    if (finished_) {
+      return;
+    }
+    finished_ = true;
+    done_callback = std::move(done_callback_);
+    done_callback_ = nullptr;
+  }
+  done_callback(status);
+}
+
+bool TCPRelayImpl::finished() const {
+  MutexLock lock(&mutex_);
+  return finished_;
+}
+
+TCPRelay::DirectionStats TCPRelayImpl::GetDirectionStats(
+    const Direction& direction, Time now) const {
+  DirectionStats stats;
+  MutexLock lock(&direction.mutex);
+  stats.bytes = direction.bytes;
+  stats.closed = direction.closed;
+  Time end = direction.closed ? direction.closed_time : now;
+  stats.elapsed = end - start_time_;
+  int64_t us = stats.elapsed.ToMicroseconds();
+  stats.bytes_per_second = us > 0 ? stats.bytes * 1e6 / us : 0;
+  return stats;
+}
+
+void TCPRelayImpl::OnFileReadable(int fd) {
+  Pump(fd == first_to_second_.from_fd ? &first_to_second_ : &second_to_first_);
+}
+
+void TCPRelayImpl::OnFileWritable(int fd) {
+  Pump(fd == first_to_second_.to_fd ? &first_to_second_ : &second_to_first_);
+}
+
+}  // namespace iomgr
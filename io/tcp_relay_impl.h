@@ -0,0 +1,95 @@
+#ifndef LIBIOMGR_IO_TCP_RELAY_IMPL_H_
+#define LIBIOMGR_IO_TCP_RELAY_IMPL_H_
+
+#include <memory>
+
+#include "io/tcp_client_impl.h"
+#include "iomgr/io_buffer.h"
+#include "iomgr/io_watcher.h"
+#include "iomgr/ref_counted.h"
+#include "iomgr/tcp/tcp_relay.h"
+#include "util/scoped_fd.h"
+#include "util/sync.h"
+
+namespace iomgr {
+
+class TCPRelayImpl : public TCPRelay, IOWatcher {
+ public:
+  TCPRelayImpl(std::unique_ptr<TCPClientImpl> first,
+               std::unique_ptr<TCPClientImpl> second,
+               StatusCallback done_callback);
+  ~TCPRelayImpl() override;
+
+  TCPRelayImpl(const TCPRelayImpl&) = delete;
+  TCPRelayImpl& operator=(const TCPRelayImpl&) = delete;
+
+  // Makes a pipe per direction. Returns an error if they cannot be made,
+  // in which case the bytes can still be copied.
+  Status UseSplice(int pipe_size);
+  // Gives each direction a buffer of |size| bytes instead
+  void UseCopy(size_t size);
+  // Starts watching both sockets
+  Status Start();
+  Stats GetStats() const override;
+
+ private:
+  // One way of the relay. Pumped by one thread at a time, the one holding
+  // |mutex|.
+  struct Direction {
+    Direction(int from_fd, int to_fd);
+
+    const int from_fd;
+    const int to_fd;
+    mutable Mutex mutex;
+    // Set with splice
+    ScopedFD pipe_read_fd;
+    ScopedFD pipe_write_fd;
+    size_t pipe_capacity;
+    // Set without
+    RefPtr<IOBuffer> buffer;
+    size_t buffer_size;
+    size_t buffer_offset;
+    // Bytes read from |from_fd| but not written to |to_fd| yet
+    size_t pending;
+    uint64_t bytes;
+    // Set once |from_fd| has reached the end of the stream
+    bool eof;
+    // Set once |to_fd| was shut down after the last byte
+    bool closed;
+    Time closed_time;
+  };
+
+  // Moves bytes until neither side can make progress. The socket events
+  // bring it back once they can.
+  void Pump(Direction* direction);
+  // Read from and write to the sockets of |direction|, with TryAgain when
+  // they cannot go on
+  StatusOr<int> Fill(Direction* direction);
+  StatusOr<int> Drain(Direction* direction);
+  void OnDirectionClosed();
+  // Runs |done_callback_| with |status| unless it already ran
+  void Finish(Status status);
+  bool finished() const;
+  DirectionStats GetDirectionStats(const Direction& direction,
+                                   Time now) const;
+  void OnFileReadable(int fd) override;
+  void OnFileWritable(int fd) override;
+
+  std::unique_ptr<TCPClientImpl> first_;
+  std::unique_ptr<TCPClientImpl> second_;
+  const Time start_time_;
+  bool spliced_;
+  Direction first_to_second_;
+  Direction second_to_first_;
+  IOWatcher::Controller first_controller_;
+  IOWatcher::Controller second_controller_;
+
+  mutable Mutex mutex_;
+  StatusCallback done_callback_;
+  int closed_directions_;
+  bool finished_;
+};
+
+}  // namespace iomgr
+
+#endif  // LIBIOMGR_IO_TCP_RELAY_IMPL_H_
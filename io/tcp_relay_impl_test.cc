@@ -0,0 +1,178 @@
+#include "io/tcp_relay_impl.h"
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+#include <thread>
+
+#include "io/test/async_test_callback.h"
+#include "iomgr/tcp/inet_address.h"
+#include "iomgr/tcp/tcp_client.h"
+#include "iomgr/tcp/tcp_server.h"
+#include "util/sockaddr_storage.h"
+
+namespace iomgr {
+
+const TCPServer::Options options(true, 5);
+const InetAddress local_host("127.0.0.1", 0);
+
+class TCPRelayImplTest : public testing::Test {
+ protected:
+  void SetUp() {
+    EXPECT_TRUE(TCPServer::Listen(local_host, options, &server_).ok());
+    EXPECT_TRUE(server_->GetLocalAddress(&server_address_).ok());
+  }
+
+  // Relays between two accepted connections, whose peers are returned in
+  // |first| and |second|
+  void StartRelay(bool splice, StatusResultCallback* done_callback,
+                  int* first, int* second) {
+    TCPRelay::Options relay_options;
+    relay_options.splice = splice;
+    relay_options.buffer_size = 16 * 1024;
+    std::unique_ptr<TCPClient> accepted_first = Accept(first);
+    std::unique_ptr<TCPClient> accepted_second = Accept(second);
+    EXPECT_TRUE(TCPRelay::Start(std::move(accepted_first),
+                                std::move(accepted_second), relay_options,
+                                done_callback->callback(), &relay_)
+                    .ok());
+    EXPECT_EQ(splice, relay_->GetStats().spliced);
+  }
+
+  std::unique_ptr<TCPClient> Accept(int* peer) {
+    SockaddrStorage storage(server_address_);
+    *peer = ::socket(storage.address_family(), SOCK_STREAM, 0);
+    EXPECT_EQ(0, ::connect(*peer, storage.addr, storage.addr_len));
+    std::unique_ptr<TCPClient> accepted;
+    StatusResultCallback accept_callback;
+    Status status = server_->Accept(&accepted, accept_callback.callback());
+    EXPECT_TRUE(accept_callback.GetResult(status).ok());
+    return accepted;
+  }
+
+  // Reads from |fd| until the end of the stream
+  static std::string ReadToEnd(int fd) {
+    std::string data;
+    char buf[16 * 1024];
+    ssize_t n;
+    while ((n = ::recv(fd, buf, sizeof(buf), 0)) > 0) {
+      data.append(buf, n);
+    }
+    return data;
+  }
+
+  static void SendAll(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+      ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, 0);
+      ASSERT_LT(0, n);
+      sent += n;
+    }
+  }
+
+  std::unique_ptr<TCPServer> server_;
+  InetAddress server_address_;
+  std::unique_ptr<TCPRelay> relay_;
+};
+
+TEST_F(TCPRelayImplTest, RelayWithHalfClose) {
+  for (bool splice : {true, false}) {
+    int first;
+    int second;
+    StatusResultCallback done_callback;
+    StartRelay(splice, &done_callback, &first, &second);
+
+    std::string request(1 << 20, 0);
+    for (size_t i = 0; i < request.size(); ++i) {
+      request[i] = 'a' + i % 26;
+    }
+    std::thread sender([first, &request]() {
+      SendAll(first, request);
+      // The end of the request reaches |second|
+      ::shutdown(first, SHUT_WR);
+    });
+    EXPECT_EQ(request, ReadToEnd(second));
+    sender.join();
+
+    // The other direction is still open
+    const std::string response("response");
+    SendAll(second, response);
+    ::shutdown(second, SHUT_WR);
+    EXPECT_EQ(response, ReadToEnd(first));
+    EXPECT_TRUE(done_callback.WaitForResult().ok());
+
+    TCPRelay::Stats stats = relay_->GetStats();
+    EXPECT_EQ(request.size(), stats.first_to_second.bytes);
+    EXPECT_TRUE(stats.first_to_second.closed);
+    EXPECT_LT(0, stats.first_to_second.bytes_per_second);
+    EXPECT_EQ(response.size(), stats.second_to_first.bytes);
+    EXPECT_TRUE(stats.second_to_first.closed);
+    EXPECT_LE(stats.first_to_second.elapsed, stats.second_to_first.elapsed);
+
+    relay_.reset();
+    ::close(first);
+    ::close(second);
+  }
+}
+
+TEST_F(TCPRelayImplTest, Backpressure) {
+  for (bool splice : {true, false}) {
+    int first;
+    int second;
+    StatusResultCallback done_callback;
+    StartRelay(splice, &done_callback, &first, &second);
+
+    // Nothing reads |second|, so once its socket is full the relay stops
+    // reading and |first| fills up in turn
+    const std::string chunk(64 * 1024, 'x');
+    size_t sent = 0;
+    int stalls = 0;
+    while (stalls < 3) {
+      ssize_t n = ::send(first, chunk.data(), chunk.size(), MSG_DONTWAIT);
+      if (n > 0) {
+        sent += n;
+        stalls = 0;
+      } else {
+        ASSERT_EQ(EAGAIN, errno);
+        ++stalls;
+        usleep(50 * 1000);
+      }
+    }
+    EXPECT_GT(sent, relay_->GetStats().first_to_second.bytes);
+
+    ::shutdown(first, SHUT_WR);
+    EXPECT_EQ(sent, ReadToEnd(second).size());
+    EXPECT_EQ(sent, relay_->GetStats().first_to_second.bytes);
+
+    relay_.reset();
+    ::close(first);
+    ::close(second);
+  }
+}
+
+TEST_F(TCPRelayImplTest, ResetEndsRelay) {
+  for (bool splice : {true, false}) {
+    int first;
+    int second;
+    StatusResultCallback done_callback;
+    StartRelay(splice, &done_callback, &first, &second);
+
+    struct linger linger = {1, 0};
+    ::setsockopt(second, SOL_SOCKET, SO_LINGER, &linger, sizeof(linger));
+    ::close(second);
+    EXPECT_FALSE(done_callback.WaitForResult().ok());
+
+    relay_.reset();
+    ::close(first);
+  }
+}
+
+}  // namespace iomgr
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,142 @@
+#include <netinet/in.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "iomgr/tcp/inet_address.h"
+#include "iomgr/tcp/tcp_client.h"
+#include "iomgr/tcp/tcp_server.h"
+#include "iomgr/time.h"
+#include "threading/task_runner.h"
+#include "util/notification.h"
+#include "util/sockaddr_storage.h"
+
+namespace iomgr {
+
+// Connections queued in the listen backlogs before each round, as after a
+// storm of clients
+static const int kConnections = 2000;
+static const int kRounds = 10;
+
+// Accepts and drops connections from one server, the way a server loop
+// would, until the servers of a round have accepted all clients together.
+class AcceptLoop {
+ public:
+  AcceptLoop(TCPServer* server, size_t batch, std::atomic<int>* remaining,
+             Notification* done)
+      : server_(server), batch_(batch), remaining_(remaining), done_(done) {}
+
+  void Start() { DoAcceptLoop(); }
+
+ private:
+  void DoAcceptLoop() {
+    TCPServer::AcceptCallback callback =
+        std::bind(&AcceptLoop::OnAccept, this, std::placeholders::_1);
+    Status status;
+    do {
+      status = batch_ == 1 ? server_->Accept(&socket_, callback)
+                           : server_->AcceptMany(batch_, &sockets_, callback);
+    } while (status.ok() && HandleAccepted());
+  }
+
+  void OnAccept(Status status) {
+    if (status.ok() && HandleAccepted()) {
+      DoAcceptLoop();
+    }
+  }
+
+  // Return true if more connections are expected
+  bool HandleAccepted() {
+    int accepted = socket_ ? 1 : static_cast<int>(sockets_.size());
+    socket_.reset();
+    sockets_.clear();
+    if (remaining_->fetch_sub(accepted) - accepted > 0) {
+      return true;
+    }
+    done_->Notify();
+    return false;
+  }
+
+  TCPServer* const server_;
+  const size_t batch_;
+  std::unique_ptr<TCPClient> socket_;
+  std::vector<std::unique_ptr<TCPClient>> sockets_;
+  std::atomic<int>* const remaining_;
+  Notification* const done_;
+};
+
+void Measure(const char* name, size_t shards, size_t batch,
+             bool steer_by_cpu) {
+  Time::Delta elapsed = Time::Delta::Zero();
+  std::vector<uint64_t> accepted(shards);
+  for (int round = 0; round < kRounds; ++round) {
+    std::atomic<int> remaining(kConnections);
+    Notification done;
+    std::vector<std::unique_ptr<AcceptLoop>> loops;
+    std::vector<std::unique_ptr<TCPServer>> servers;
+    TCPServer::Options options(true, 4096);
+    options.steer_by_cpu = steer_by_cpu;
+    Status status = TCPServer::ListenSharded(InetAddress("127.0.0.1", 0),
+                                             options, shards, &servers);
+    if (!status.ok()) {
+      printf("listen failed: %s\n", status.ToString().c_str());
+      return;
+    }
+    InetAddress address;
+    servers[0]->GetLocalAddress(&address);
+    SockaddrStorage storage(address);
+
+    std::vector<int> clients;
+    for (int i = 0; i < kConnections; ++i) {
+      int fd = ::socket(storage.address_family(), SOCK_STREAM, 0);
+      if (::connect(fd, storage.addr, storage.addr_len) < 0) {
+        perror("connect");
+      }
+      clients.push_back(fd);
+    }
+
+    Time start = Time::Now();
+    // The shards drain their backlogs in parallel
+    for (auto& server : servers) {
+      loops.emplace_back(
+          new AcceptLoop(server.get(), batch, &remaining, &done));
+      TaskRunner::Get()->PostTask(
+          std::bind(&AcceptLoop::Start, loops.back().get()));
+    }
+    done.WaitForNotification();
+    elapsed = elapsed + (Time::Now() - start);
+    for (size_t i = 0; i < shards; ++i) {
+      accepted[i] += servers[i]->accepted_connections();
+    }
+
+    // Stops the accepts still pending before their loops go away
+    servers.clear();
+    for (int fd : clients) {
+      // Reset instead of leaving the port in TIME_WAIT
+      struct linger linger = {1, 0};
+      setsockopt(fd, SOL_SOCKET, SO_LINGER, &linger, sizeof(linger));
+      ::close(fd);
+    }
+  }
+  printf("%-24s %8.0f accepts/s, per shard:", name,
+         kConnections * kRounds * 1e6 / elapsed.ToMicroseconds());
+  for (uint64_t count : accepted) {
+    printf(" %lu", static_cast<unsigned long>(count));
+  }
+  printf("\n");
+}
+
+}  // namespace iomgr
+
+int main(int argc, char** argv) {
+  iomgr::Measure("Accept", 1, 1, false);
+  iomgr::Measure("AcceptMany(64)", 1, 64, false);
+  iomgr::Measure("4 shards", 4, 64, false);
+  iomgr::Measure("4 shards, steer by CPU", 4, 64, true);
+  return 0;
+}
@@ -1,5 +1,6 @@
 #include "io/tcp_server_impl.h"
 
+#include "io/io_manager.h"
 #include "io/tcp_client_impl.h"
 #include "util/os_error.h"
 #include "util/socket_op.h"
@@ -28,31 +29,115 @@ Status TCPServer::Listen(const InetAddress& local, const Options& options,
   if (!(status = socket->Open(address.address_family())).ok()) {
     return status;
   }
+  if (options.reuse_port && !(status = socket->AllowPortReuse()).ok()) {
+    return status;
+  }
   if (!(status = socket->Bind(local)).ok()) {
     return status;
   }
   if (options.reuse_address && !(status = socket->AllowAddressReuse()).ok()) {
     return status;
   }
+  if (options.fast_open_queue_length > 0 &&
+      !(status = socket->EnableFastOpen(options.fast_open_queue_length))
+           .ok()) {
+    return status;
+  }
+  if (options.zerocopy && !(status = socket->EnableZeroCopy()).ok()) {
+    return status;
+  }
+  if (Time::Delta::Zero() < options.defer_accept &&
+      !(status = socket->DeferAccept(options.defer_accept)).ok()) {
+    return status;
+  }
   if (!(status = socket->Listen(options.backlog)).ok()) {
     return status;
   }
+  socket->set_resource_quota(options.resource_quota);
+  DCHECK_LT(0u, options.reactors);
+  std::vector<IOManager*> io_managers;
+  for (size_t i = 0; i < options.reactors; ++i) {
+    io_managers.push_back(IOManager::Get(options.reactor + i));
+  }
+  socket->set_io_managers(std::move(io_managers));
 
   server->reset(socket.release());
   return status;
 }
 
+Status TCPServer::ListenSharded(
+    const InetAddress& local, const Options& options, size_t shards,
+    std::vector<std::unique_ptr<TCPServer>>* servers) {
+  DCHECK_LT(0u, shards);
+  DCHECK(servers);
+
+  Options shard_options = options;
+  shard_options.reuse_port = true;
+  InetAddress address = local;
+  std::vector<std::unique_ptr<TCPServer>> opened;
+  Status status;
+  for (size_t i = 0; i < shards; ++i) {
+    std::unique_ptr<TCPServer> server;
+    shard_options.reactor = options.reactor + i;
+    if (!(status = Listen(address, shard_options, &server)).ok()) {
+      return status;
+    }
+    // The others join the port picked for the first one
+    if (i == 0 && !(status = server->GetLocalAddress(&address)).ok()) {
+      return status;
+    }
+    opened.push_back(std::move(server));
+  }
+  // The group is complete: a socket's index is its order of listen()
+  if (options.steer_by_cpu) {
+    TCPServerImpl* first = static_cast<TCPServerImpl*>(opened[0].get());
+    if (!(status = first->SteerByCPU(shards)).ok()) {
+      return status;
+    }
+  }
+
+  for (auto& server : opened) {
+    servers->push_back(std::move(server));
+  }
+  return status;
+}
+
 TCPServerImpl::TCPServerImpl()
     : socket_fd_(-1),
       local_address_(),
-      accept_socket_controller_(),
+      accept_controllers_(),
       accept_callback_(),
       accept_socket_(nullptr),
       remote_(nullptr),
+      accept_sockets_(nullptr),
+      max_accept_sockets_(0),
       accepted_address_(),
-      pending_accept_(false) {}
+      watching_(false),
+      accept_mutex_(),
+      pending_accept_(false),
+      accepting_(false),
+      accept_again_(false),
+      resource_quota_(nullptr),
+      io_managers_(1, IOManager::Get()),
+      next_io_manager_(0),
+      accepted_connections_(0),
+      fast_open_(false),
+      fast_open_connections_(0),
+      zerocopy_(false) {}
+
+TCPServerImpl::~TCPServerImpl() {
+  if (watching_) {
+    for (auto& controller : accept_controllers_) {
+      controller->StopWatching();
+    }
+  }
+}
 
-TCPServerImpl::~TCPServerImpl() = default;
+void TCPServerImpl::set_io_managers(std::vector<IOManager*> io_managers) {
+  DCHECK(!watching_);
+  DCHECK(!io_managers.empty());
+  io_managers_ = std::move(io_managers);
+}
 
 Status TCPServerImpl::Open(int family) {
   DCHECK_EQ(-1, socket_fd_);
@@ -117,27 +202,115 @@ Status TCPServerImpl::Accept(std::unique_ptr<TCPClient>* socket,
   DCHECK(socket);
   DCHECK(callback);
 
-  if (pending_accept_) {
-    DCHECK(false) << "UNEXPECTED ERROR";
-    return Status::Corruption("UNEXPECTED ERROR");
+  {
+    MutexLock lock(&accept_mutex_);
+    if (pending_accept_) {
+      DCHECK(false) << "UNEXPECTED ERROR";
+      return Status::Corruption("UNEXPECTED ERROR");
+    }
+    // Claimed right away, events that race with the first try hand it
+    // another one through |accept_again_|.
+    pending_accept_ = true;
+    accepting_ = true;
+    accept_callback_ = std::move(callback);
+    accept_socket_ = socket;
+    remote_ = remote;
   }
-  Status status = DoAccept(socket, remote);
-  if (!status.IsTryAgain()) {
-    return status;
-  } else {
+  return StartAccept();
+}
+
+Status TCPServerImpl::AcceptMany(
+    size_t max_sockets, std::vector<std::unique_ptr<TCPClient>>* sockets,
+    AcceptCallback callback) {
+  DCHECK_LT(0u, max_sockets);
+  DCHECK(sockets);
+  DCHECK(callback);
+
+  {
+    MutexLock lock(&accept_mutex_);
+    if (pending_accept_) {
+      DCHECK(false) << "UNEXPECTED ERROR";
+      return Status::Corruption("UNEXPECTED ERROR");
+    }
     pending_accept_ = true;
+    accepting_ = true;
+    accept_callback_ = std::move(callback);
+    accept_sockets_ = sockets;
+    max_accept_sockets_ = max_sockets;
   }
+  return StartAccept();
+}
 
-  if (!IOWatcher::WatchFileDescriptor(socket_fd_, IOWatcher::kWatchRead, this,
-                                      &accept_socket_controller_)) {
+Status TCPServerImpl::StartAccept() {
+  // Watched before trying, so that no connection arrives unnoticed between
+  // the last accept() and the wait. Events are ignored while no accept is
+  // pending, the connections wait in the backlog for the next call.
+  if (!watching_ && !WatchListener()) {
     LOG(ERROR) << "WatchFileIO failed on accept";
-    return MapSystemError(errno);
+    Status status = MapSystemError(errno);
+    MutexLock lock(&accept_mutex_);
+    pending_accept_ = false;
+    accepting_ = false;
+    accept_again_ = false;
+    accept_callback_ = nullptr;
+    accept_socket_ = nullptr;
+    remote_ = nullptr;
+    accept_sockets_ = nullptr;
+    return status;
   }
 
-  accept_callback_ = std::move(callback);
-  accept_socket_ = socket;
-  remote_ = remote;
-  return Status::TryAgain("ACCEPT PENDING");
+  AcceptCallback callback;
+  Status status = TryAccept(&callback);
+  if (status.IsTryAgain()) {
+    return Status::TryAgain("ACCEPT PENDING");
+  }
+  return status;
+}
+
+bool TCPServerImpl::WatchListener() {
+  // A reactor waking up for a connection that another one accepted costs a
+  // trip through the task queue for nothing, so several wake only one.
+  int mode = io_managers_.size() > 1
+                 ? IOWatcher::kWatchRead | IOWatcher::kWatchExclusive
+                 : IOWatcher::kWatchRead;
+  for (IOManager* io_manager : io_managers_) {
+    accept_controllers_.emplace_back(new IOWatcher::Controller);
+    if (!io_manager->WatchFileDescriptor(socket_fd_, mode, this,
+                                         accept_controllers_.back().get())) {
+      int saved_errno = errno;
+      for (auto& controller : accept_controllers_) {
+        controller->StopWatching();
+      }
+      accept_controllers_.clear();
+      errno = saved_errno;
+      return false;
+    }
+  }
+  watching_ = true;
+  return true;
+}
+
+Status TCPServerImpl::TryAccept(AcceptCallback* callback) {
+  for (;;) {
+    Status status = accept_sockets_ ? DoAcceptMany()
+                                    : DoAccept(accept_socket_, remote_);
+    MutexLock lock(&accept_mutex_);
+    if (status.IsTryAgain() && accept_again_) {
+      accept_again_ = false;
+      continue;
+    }
+    accepting_ = false;
+    accept_again_ = false;
+    if (!status.IsTryAgain()) {
+      pending_accept_ = false;
+      *callback = std::move(accept_callback_);
+      accept_callback_ = nullptr;
+      accept_socket_ = nullptr;
+      remote_ = nullptr;
+      accept_sockets_ = nullptr;
+    }
+    return status;
+  }
 }
 
 Status TCPServerImpl::GetLocalAddress(InetAddress* local) const {
@@ -169,42 +342,142 @@ Status TCPServerImpl::AllowAddressReuse() {
   return status;
 }
 
+Status TCPServerImpl::DeferAccept(Time::Delta timeout) {
+  DCHECK_NE(-1, socket_fd_);
+
+  // Rounded up, a timeout under a second would turn it off
+  int seconds = static_cast<int>((timeout.ToMilliseconds() + 999) / 1000);
+  Status status = SocketOp::set_defer_accept(socket_fd_, seconds);
+  if (!status.ok()) {
+    LOG(ERROR) << "Failed to set TCP_DEFER_ACCEPT on fd(" << socket_fd_
+               << "), " << status.ToString();
+  }
+  return status;
+}
+
+Status TCPServerImpl::EnableZeroCopy() {
+  DCHECK_NE(-1, socket_fd_);
+
+  Status status = SocketOp::set_zerocopy(socket_fd_, true);
+  if (!status.ok()) {
+    LOG(ERROR) << "Failed to set SO_ZEROCOPY on fd(" << socket_fd_ << "), "
+               << status.ToString();
+    return status;
+  }
+  zerocopy_ = true;
+  return status;
+}
+
+Status TCPServerImpl::AllowPortReuse() {
+  DCHECK_NE(-1, socket_fd_);
+
+  Status status = SocketOp::set_reuse_port(socket_fd_, true);
+  if (!status.ok()) {
+    LOG(ERROR) << "Failed to set SO_REUSEPORT on fd(" << socket_fd_ << "), "
+               << status.ToString();
+  }
+  return status;
+}
+
+Status TCPServerImpl::EnableFastOpen(int queue_length) {
+  DCHECK_NE(-1, socket_fd_);
+
+  Status status = SocketOp::set_fast_open(socket_fd_, queue_length);
+  if (!status.ok()) {
+    LOG(ERROR) << "Failed to set TCP_FASTOPEN on fd(" << socket_fd_ << "), "
+               << status.ToString();
+    return status;
+  }
+  fast_open_ = true;
+  return status;
+}
+
+Status TCPServerImpl::SteerByCPU(size_t shards) {
+  DCHECK_NE(-1, socket_fd_);
+
+  Status status = SocketOp::attach_reuse_port_cpu_filter(socket_fd_, shards);
+  if (!status.ok()) {
+    LOG(ERROR) << "Failed to attach the CPU steering program on fd("
+               << socket_fd_ << "), " << status.ToString();
+  }
+  return status;
+}
+
 Status TCPServerImpl::DoAccept(std::unique_ptr<TCPClient>* socket,
                                InetAddress* remote) {
   SockaddrStorage remote_address;
-  StatusOr<int> new_socket = SocketOp::accept(socket_fd_, remote_address.addr,
-                                              &remote_address.addr_len);
+  // Saves the fcntl() calls to make the new socket non-blocking
+  StatusOr<int> new_socket = SocketOp::accept4(
+      socket_fd_, remote_address.addr, &remote_address.addr_len);
   if (!new_socket.ok()) {
     return new_socket.status();
   }
 
   std::unique_ptr<TCPClientImpl> accepted_socket(new TCPClientImpl);
-  Status status = accepted_socket->AdoptConnectedSocket(
+  if (resource_quota_) {
+    accepted_socket->SetResourceQuota(resource_quota_);
+  }
+  // Accepts may run on several threads at once, each takes its own turn
+  uint64_t turn = next_io_manager_.fetch_add(1, std::memory_order_relaxed);
+  accepted_socket->set_io_manager(io_managers_[turn % io_managers_.size()]);
+  Status status = accepted_socket->AdoptNonBlockingSocket(
       new_socket.value(), remote_address.ToInetAddress());
   if (!status.ok()) {
     return status;
   }
+  if (zerocopy_ &&
+      !(status = accepted_socket->EnableInheritedZeroCopy()).ok()) {
+    return status;
+  }
 
   if (remote) {
     *remote = remote_address.ToInetAddress();
   }
+  accepted_connections_.fetch_add(1, std::memory_order_relaxed);
+  struct tcp_info info;
+  if (fast_open_ && SocketOp::get_tcp_info(new_socket.value(), &info).ok() &&
+      (info.tcpi_options & TCPI_OPT_SYN_DATA)) {
+    fast_open_connections_.fetch_add(1, std::memory_order_relaxed);
+  }
   socket->reset(accepted_socket.release());
   return status;
 }
 
+Status TCPServerImpl::DoAcceptMany() {
+  size_t accepted = 0;
+  while (accepted < max_accept_sockets_) {
+    std::unique_ptr<TCPClient> socket;
+    Status status = DoAccept(&socket, nullptr);
+    if (!status.ok()) {
+      // A later error comes back on the next call
+      return accepted > 0 ? Status() : status;
+    }
+    accept_sockets_->push_back(std::move(socket));
+    ++accepted;
+  }
+  return Status();
+}
+
 void TCPServerImpl::OnFileReadable(int fd) {
-  DCHECK(accept_socket_);
-  Status status = DoAccept(accept_socket_, remote_);
+  {
+    MutexLock lock(&accept_mutex_);
+    if (!pending_accept_) {
+      return;
+    }
+    if (accepting_) {
+      accept_again_ = true;
+      return;
+    }
+    accepting_ = true;
+  }
+
+  AcceptCallback callback;
+  Status status = TryAccept(&callback);
   if (status.IsTryAgain()) {
     return;
   }
-
-  bool ok = accept_socket_controller_.StopWatching();
-  DCHECK(ok);
-  accept_socket_ = nullptr;
-  remote_ = nullptr;
-  pending_accept_ = false;
-  std::move(accept_callback_)(status);
+  // The callback may start the next accept
+  callback(status);
 }
 
 void TCPServerImpl::OnFileWritable(int fd) {
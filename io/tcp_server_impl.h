@@ -1,13 +1,19 @@
 #ifndef LIBIOMGR_IO_TCP_SERVER_IMPL_H_
 #define LIBIOMGR_IO_TCP_SERVER_IMPL_H_
 
+#include <atomic>
+#include <memory>
+#include <vector>
+
 #include "iomgr/io_watcher.h"
 #include "iomgr/tcp/tcp_server.h"
 #include "util/scoped_fd.h"
 #include "util/sockaddr_storage.h"
+#include "util/sync.h"
 
 namespace iomgr {
 
+class IOManager;
 class SockaddrStorage;
 
 class TCPServerImpl : public TCPServer, IOWatcher {
@@ -21,23 +27,84 @@ class TCPServerImpl : public TCPServer, IOWatcher {
                 AcceptCallback callback) override;
   Status Accept(std::unique_ptr<TCPClient>* socket, AcceptCallback callback,
                 InetAddress* remote) override;
+  Status AcceptMany(size_t max_sockets,
+                    std::vector<std::unique_ptr<TCPClient>>* sockets,
+                    AcceptCallback callback) override;
   Status GetLocalAddress(InetAddress* local) const override;
+  uint64_t accepted_connections() const override {
+    return accepted_connections_.load(std::memory_order_relaxed);
+  }
+  uint64_t fast_open_connections() const override {
+    return fast_open_connections_.load(std::memory_order_relaxed);
+  }
   Status AllowAddressReuse();
+  // Must be called before Listen()
+  Status EnableFastOpen(int queue_length);
+  // Must be called before Listen()
+  Status DeferAccept(Time::Delta timeout);
+  // Sets SO_ZEROCOPY, which the accepted connections inherit, and has them
+  // track their zero-copy writes
+  Status EnableZeroCopy();
+  // Must be called before Bind()
+  Status AllowPortReuse();
+  // Attaches the CPU steering program to the SO_REUSEPORT group of the
+  // socket, which holds |shards| sockets
+  Status SteerByCPU(size_t shards);
+  void set_resource_quota(ResourceQuota* quota) { resource_quota_ = quota; }
+  // Must be called before the first accept. The listening socket is watched
+  // by all of |io_managers| and the accepted connections go to each in turn.
+  void set_io_managers(std::vector<IOManager*> io_managers);
 
  private:
   Status DoAccept(std::unique_ptr<TCPClient>* socket, InetAddress* remote);
+  // Returns OK if at least one connection was accepted
+  Status DoAcceptMany();
+  // Common to Accept() and AcceptMany() once the request is stored
+  Status StartAccept();
+  // Watches the listening socket on all reactors. Returns false with errno
+  // set on failure, with no reactor watching.
+  bool WatchListener();
+  // Accepts for the pending request, which the caller has claimed by setting
+  // |accepting_|. Moves the callback to |callback| once the request is done.
+  Status TryAccept(AcceptCallback* callback);
   void OnFileReadable(int fd) override;
   void OnFileWritable(int fd) override;
 
   ScopedFD socket_fd_;
   mutable std::unique_ptr<SockaddrStorage> local_address_;
 
-  IOWatcher::Controller accept_socket_controller_;
+  // One per reactor in |io_managers_|
+  std::vector<std::unique_ptr<IOWatcher::Controller>> accept_controllers_;
   AcceptCallback accept_callback_;
   std::unique_ptr<TCPClient>* accept_socket_;
   InetAddress* remote_;
+  // Set instead of |accept_socket_| by AcceptMany()
+  std::vector<std::unique_ptr<TCPClient>>* accept_sockets_;
+  size_t max_accept_sockets_;
   SockaddrStorage accepted_address_;
+  // The listening socket stays watched from the first accept on. Only
+  // touched by Accept() and AcceptMany(), which are not called concurrently.
+  bool watching_;
+
+  // Guards the state below and the pending request. Events may arrive on
+  // several threads at once, and while Accept() is still trying.
+  Mutex accept_mutex_;
   bool pending_accept_;
+  // True while a thread is calling accept() for the pending request
+  bool accepting_;
+  // Set by an event that found |accepting_|, to try once more
+  bool accept_again_;
+  // Handed to accepted connections, null for the process-wide quota
+  ResourceQuota* resource_quota_;
+  // Reactors of the socket, also handed to accepted connections
+  std::vector<IOManager*> io_managers_;
+  // Round robin over |io_managers_|, taken once per accept even if it fails
+  std::atomic<uint64_t> next_io_manager_;
+  std::atomic<uint64_t> accepted_connections_;
+  // Accepted connections are checked for SYN data only with Fast Open on
+  bool fast_open_;
+  std::atomic<uint64_t> fast_open_connections_;
+  bool zerocopy_;
 };
 
 }  // namespace iomgr
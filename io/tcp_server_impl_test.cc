@@ -2,12 +2,22 @@
 
 #include <glog/logging.h>
 #include <gtest/gtest.h>
+#include <pthread.h>
+#include <sched.h>
 
+#include <functional>
+#include <map>
+#include <thread>
+#include <vector>
+
+#include "io/tcp_client_impl.h"
 #include "io/test/async_test_callback.h"
 #include "iomgr/io_buffer.h"
 #include "iomgr/ref_counted.h"
 #include "iomgr/tcp/tcp_client.h"
 #include "iomgr/tcp/tcp_server.h"
+#include "iomgr/time.h"
+#include "util/notification.h"
 
 namespace iomgr {
 
@@ -81,6 +91,66 @@ TEST_F(TCPServerImplTest, AcceptAsync) {
   EXPECT_EQ(GetRemoteAddress(accepted_socket.get()).ip(), local_host.ip());
 }
 
+TEST_F(TCPServerImplTest, AcceptRacingConnect) {
+  // The connection may be reported before Accept() has returned
+  for (int i = 0; i < 100; ++i) {
+    StatusResultCallback connect_callback;
+    std::unique_ptr<TCPClient> connecting_socket;
+    Status connect_result;
+    std::thread connector([&]() {
+      connect_result = TCPClient::Connect(
+          server_address_, TCPClient::Options(), connect_callback.callback(),
+          nullptr, &connecting_socket);
+    });
+
+    StatusResultCallback accept_callback;
+    std::unique_ptr<TCPClient> accepted_socket;
+    Status accept_result =
+        socket_->Accept(&accepted_socket, accept_callback.callback());
+    EXPECT_TRUE(accept_callback.GetResult(accept_result).ok());
+    EXPECT_TRUE(accepted_socket);
+    connector.join();
+    EXPECT_TRUE(connect_callback.GetResult(connect_result).ok());
+  }
+}
+
+TEST_F(TCPServerImplTest, AcceptFromCallback) {
+  const int kConnections = 3;
+  std::unique_ptr<TCPClient> accepted_sockets[kConnections];
+  int accepted = 0;
+  Notification all_accepted;
+  // Each callback starts the next accept, which stores its callback while
+  // the current one is still running
+  std::function<void(Status)> on_accept = [&](Status status) {
+    while (true) {
+      EXPECT_TRUE(status.ok());
+      if (++accepted == kConnections) {
+        all_accepted.Notify();
+        return;
+      }
+      status = socket_->Accept(&accepted_sockets[accepted], on_accept);
+      if (status.IsTryAgain()) {
+        return;
+      }
+    }
+  };
+  EXPECT_TRUE(socket_->Accept(&accepted_sockets[0], on_accept).IsTryAgain());
+
+  StatusResultCallback connect_callbacks[kConnections];
+  std::unique_ptr<TCPClient> connecting_sockets[kConnections];
+  Status connect_results[kConnections];
+  for (int i = 0; i < kConnections; ++i) {
+    connect_results[i] = TCPClient::Connect(
+        server_address_, TCPClient::Options(),
+        connect_callbacks[i].callback(), nullptr, &connecting_sockets[i]);
+  }
+  all_accepted.WaitForNotification();
+  for (int i = 0; i < kConnections; ++i) {
+    EXPECT_TRUE(accepted_sockets[i]);
+    EXPECT_TRUE(connect_callbacks[i].GetResult(connect_results[i]).ok());
+  }
+}
+
 // Test Accept() when client disconnects right after trying to connect
 TEST_F(TCPServerImplTest, AcceptClientDisconnectAfterConnect) {
   StatusResultCallback connect_callback;
@@ -148,6 +218,235 @@ TEST_F(TCPServerImplTest, Accept2Connection) {
   EXPECT_EQ(GetRemoteAddress(accepted_socket2.get()).ip(), local_host.ip());
 }
 
+TEST_F(TCPServerImplTest, AcceptMany) {
+  const int kConnections = 4;
+  std::vector<std::unique_ptr<TCPClient>> connecting_sockets(kConnections);
+  for (int i = 0; i < kConnections; ++i) {
+    StatusResultCallback connect_callback;
+    Status connect_result = TCPClient::Connect(
+        server_address_, TCPClient::Options(), connect_callback.callback(),
+        nullptr, &connecting_sockets[i]);
+    EXPECT_TRUE(connect_callback.GetResult(connect_result).ok());
+  }
+
+  // Connected clients wait in the backlog, so both batches complete at once
+  std::vector<std::unique_ptr<TCPClient>> accepted_sockets;
+  StatusResultCallback accept_callback;
+  EXPECT_TRUE(
+      socket_->AcceptMany(3, &accepted_sockets, accept_callback.callback())
+          .ok());
+  EXPECT_EQ(3u, accepted_sockets.size());
+  EXPECT_TRUE(
+      socket_->AcceptMany(8, &accepted_sockets, accept_callback.callback())
+          .ok());
+  ASSERT_EQ(4u, accepted_sockets.size());
+  for (const auto& accepted_socket : accepted_sockets) {
+    EXPECT_EQ(GetRemoteAddress(accepted_socket.get()).ip(), local_host.ip());
+  }
+
+  // Nothing left, the callback runs for the next connection
+  accepted_sockets.clear();
+  Status accept_result =
+      socket_->AcceptMany(8, &accepted_sockets, accept_callback.callback());
+  EXPECT_TRUE(accept_result.IsTryAgain());
+
+  StatusResultCallback connect_callback;
+  std::unique_ptr<TCPClient> connecting_socket;
+  Status connect_result = TCPClient::Connect(
+      server_address_, TCPClient::Options(), connect_callback.callback(),
+      nullptr, &connecting_socket);
+  EXPECT_TRUE(connect_callback.GetResult(connect_result).ok());
+  EXPECT_TRUE(accept_callback.WaitForResult().ok());
+  ASSERT_EQ(1u, accepted_sockets.size());
+  EXPECT_EQ(GetRemoteAddress(accepted_sockets[0].get()).ip(), local_host.ip());
+}
+
+// Connects |count| clients to |address| and accepts them from |servers|.
+// Returns the connections accepted by each server. The servers are closed
+// on return, which cancels the accept each of them has left pending.
+std::vector<size_t> AcceptOnShards(
+    const InetAddress& address, int count,
+    std::vector<std::unique_ptr<TCPServer>>* servers) {
+  std::vector<std::unique_ptr<TCPClient>> connecting_sockets(count);
+  for (int i = 0; i < count; ++i) {
+    StatusResultCallback connect_callback;
+    Status connect_result = TCPClient::Connect(
+        address, TCPClient::Options(), connect_callback.callback(), nullptr,
+        &connecting_sockets[i]);
+    EXPECT_TRUE(connect_callback.GetResult(connect_result).ok());
+  }
+
+  std::vector<size_t> accepted;
+  std::vector<std::vector<std::unique_ptr<TCPClient>>> accepted_sockets(
+      servers->size());
+  for (size_t i = 0; i < servers->size(); ++i) {
+    TCPServer* server = (*servers)[i].get();
+    Status status;
+    while ((status = server->AcceptMany(64, &accepted_sockets[i],
+                                        [](Status status) {}))
+               .ok()) {
+    }
+    EXPECT_TRUE(status.IsTryAgain());
+    EXPECT_EQ(accepted_sockets[i].size(), server->accepted_connections());
+    accepted.push_back(accepted_sockets[i].size());
+  }
+  servers->clear();
+  return accepted;
+}
+
+TEST_F(TCPServerImplTest, ListenSharded) {
+  const size_t kShards = 4;
+  const int kConnections = 64;
+  // Connections wait in the backlogs until all are made
+  const TCPServer::Options sharded(true, kConnections);
+  std::vector<std::unique_ptr<TCPServer>> servers;
+  ASSERT_TRUE(
+      TCPServer::ListenSharded(local_host, sharded, kShards, &servers).ok());
+  ASSERT_EQ(kShards, servers.size());
+  InetAddress address;
+  EXPECT_TRUE(servers[0]->GetLocalAddress(&address).ok());
+  for (const auto& server : servers) {
+    InetAddress shard_address;
+    EXPECT_TRUE(server->GetLocalAddress(&shard_address).ok());
+    EXPECT_EQ(address, shard_address);
+  }
+
+  std::vector<size_t> accepted =
+      AcceptOnShards(address, kConnections, &servers);
+  size_t total = 0;
+  for (size_t i = 0; i < kShards; ++i) {
+    total += accepted[i];
+  }
+  EXPECT_EQ(static_cast<size_t>(kConnections), total);
+}
+
+TEST_F(TCPServerImplTest, ListenShardedSteerByCPU) {
+  const size_t kShards = 2;
+  const int kConnections = 16;
+  TCPServer::Options steered(true, kConnections);
+  steered.steer_by_cpu = true;
+  std::vector<std::unique_ptr<TCPServer>> servers;
+  ASSERT_TRUE(
+      TCPServer::ListenSharded(local_host, steered, kShards, &servers).ok());
+  InetAddress address;
+  EXPECT_TRUE(servers[0]->GetLocalAddress(&address).ok());
+
+  // On loopback the SYN is received on the CPU that sends it, so every
+  // connection made from a thread pinned to one CPU lands on one shard. The
+  // last CPU allowed is picked, which is not CPU 0 on a multi-core host.
+  cpu_set_t allowed;
+  ASSERT_EQ(0, ::sched_getaffinity(0, sizeof(allowed), &allowed));
+  int cpu = CPU_SETSIZE - 1;
+  while (!CPU_ISSET(cpu, &allowed)) {
+    --cpu;
+  }
+  std::vector<size_t> accepted;
+  std::thread connector([&]() {
+    cpu_set_t pinned;
+    CPU_ZERO(&pinned);
+    CPU_SET(cpu, &pinned);
+    ASSERT_EQ(0, ::pthread_setaffinity_np(::pthread_self(), sizeof(pinned),
+                                          &pinned));
+    accepted = AcceptOnShards(address, kConnections, &servers);
+  });
+  connector.join();
+  ASSERT_EQ(kShards, accepted.size());
+  size_t shard = static_cast<size_t>(cpu) % kShards;
+  for (size_t i = 0; i < kShards; ++i) {
+    size_t expected = i == shard ? kConnections : 0;
+    EXPECT_EQ(expected, accepted[i])
+        << "shard " << i << ", connections from CPU " << cpu;
+  }
+}
+
+// The connection is accepted once its first data arrives, which the first
+// read then finds without waiting
+TEST_F(TCPServerImplTest, DeferAccept) {
+  TCPServer::Options defer_options(true, kListenBacklog);
+  defer_options.defer_accept = Time::Delta::FromSeconds(5);
+  std::unique_ptr<TCPServer> server;
+  ASSERT_TRUE(TCPServer::Listen(local_host, defer_options, &server).ok());
+  InetAddress address;
+  EXPECT_TRUE(server->GetLocalAddress(&address).ok());
+
+  StatusResultCallback connect_callback;
+  std::unique_ptr<TCPClient> connecting_socket;
+  Status connect_result =
+      TCPClient::Connect(address, TCPClient::Options(),
+                         connect_callback.callback(), nullptr,
+                         &connecting_socket);
+  EXPECT_TRUE(connect_callback.GetResult(connect_result).ok());
+
+  StatusResultCallback accept_callback;
+  std::unique_ptr<TCPClient> accepted_socket;
+  Status accept_result =
+      server->Accept(&accepted_socket, accept_callback.callback());
+  // Handshake only
+  EXPECT_TRUE(accept_result.IsTryAgain());
+
+  const std::string message("test msg");
+  RefPtr<IOBufferWithSize> write_buffer =
+      MakeRefCounted<IOBufferWithSize>(message.size());
+  memmove(write_buffer->data(), message.data(), message.size());
+  StatusOrResultCallback write_callback;
+  StatusOr<int> write_result = connecting_socket->Write(
+      write_buffer.get(), write_buffer->size(), write_callback.callback());
+  EXPECT_EQ(static_cast<int>(message.size()),
+            write_callback.GetResult(write_result).value());
+
+  EXPECT_TRUE(accept_callback.WaitForResult().ok());
+  ASSERT_TRUE(accepted_socket);
+  RefPtr<IOBufferWithSize> read_buffer =
+      MakeRefCounted<IOBufferWithSize>(message.size());
+  StatusOrResultCallback read_callback;
+  StatusOr<int> read_result = accepted_socket->Read(
+      read_buffer.get(), read_buffer->size(), read_callback.callback());
+  EXPECT_TRUE(read_result.ok());
+  EXPECT_LT(0, read_result.value());
+}
+
+// A listener watched by several reactors wakes one of them per connection
+TEST_F(TCPServerImplTest, SharedListener) {
+  const int kConnections = 8;
+  TCPServer::Options shared_options(true, kListenBacklog);
+  shared_options.reactors = 3;
+  std::unique_ptr<TCPServer> server;
+  ASSERT_TRUE(TCPServer::Listen(local_host, shared_options, &server).ok());
+  InetAddress address;
+  EXPECT_TRUE(server->GetLocalAddress(&address).ok());
+
+  std::vector<std::unique_ptr<TCPClient>> connecting_sockets(kConnections);
+  std::vector<std::unique_ptr<TCPClient>> accepted_sockets(kConnections);
+  for (int i = 0; i < kConnections; ++i) {
+    StatusResultCallback accept_callback;
+    Status accept_result =
+        server->Accept(&accepted_sockets[i], accept_callback.callback());
+
+    StatusResultCallback connect_callback;
+    Status connect_result = TCPClient::Connect(
+        address, TCPClient::Options(), connect_callback.callback(), nullptr,
+        &connecting_sockets[i]);
+    EXPECT_TRUE(connect_callback.GetResult(connect_result).ok());
+    EXPECT_TRUE(accept_callback.GetResult(accept_result).ok());
+    EXPECT_TRUE(accepted_sockets[i]);
+  }
+  EXPECT_EQ(static_cast<uint64_t>(kConnections),
+            server->accepted_connections());
+
+  // Connections take the reactors in turn
+  std::map<IOManager*, int> per_reactor;
+  for (const auto& accepted_socket : accepted_sockets) {
+    TCPClientImpl* impl = dynamic_cast<TCPClientImpl*>(accepted_socket.get());
+    ASSERT_TRUE(impl);
+    ++per_reactor[impl->io_manager()];
+  }
+  ASSERT_EQ(3u, per_reactor.size());
+  for (const auto& reactor : per_reactor) {
+    EXPECT_LE(kConnections / 3, reactor.second);
+    EXPECT_GE(kConnections / 3 + 1, reactor.second);
+  }
+}
+
 TEST_F(TCPServerImplTest, AcceptIO) {
   StatusResultCallback connect_callback;
   std::unique_ptr<TCPClient> connecting_socket;
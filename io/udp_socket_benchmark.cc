@@ -0,0 +1,153 @@
+#include <stdio.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "iomgr/ref_slice.h"
+#include "iomgr/tcp/inet_address.h"
+#include "iomgr/time.h"
+#include "iomgr/udp/udp_socket.h"
+#include "util/notification.h"
+
+namespace iomgr {
+
+static const size_t kDatagramSize = 1200;
+static const size_t kDatagramsPerRun = 1 << 20;
+
+// Counts the datagrams received until the one-byte end marker arrives
+class Receiver {
+ public:
+  Receiver(UDPSocket* socket, size_t batch)
+      : socket_(socket), batch_size_(batch), datagrams_(0), done_() {}
+
+  void Start() { DoReadLoop(); }
+
+  bool ended() const { return done_.HasBeenNotified(); }
+
+  size_t datagrams() const { return datagrams_.load(); }
+
+ private:
+  void DoReadLoop() {
+    StatusOr<int> read_or;
+    do {
+      batch_.clear();
+      read_or = socket_->ReadBatch(
+          &batch_, batch_size_,
+          std::bind(&Receiver::OnRead, this, std::placeholders::_1));
+    } while (read_or.ok() && HandleBatch());
+  }
+
+  void OnRead(StatusOr<int> result) {
+    if (result.ok() && HandleBatch()) {
+      DoReadLoop();
+    }
+  }
+
+  // Return true if more datagrams are expected
+  bool HandleBatch() {
+    size_t count = 0;
+    for (const UDPSocket::Datagram& datagram : batch_) {
+      if (datagram.data.size() == 1) {
+        done_.Notify();
+        return false;
+      }
+      count += datagram.segment_size == 0
+                   ? 1
+                   : (datagram.data.size() + datagram.segment_size - 1) /
+                         datagram.segment_size;
+    }
+    datagrams_.fetch_add(count);
+    return true;
+  }
+
+  UDPSocket* const socket_;
+  const size_t batch_size_;
+  std::vector<UDPSocket::Datagram> batch_;
+  std::atomic<size_t> datagrams_;
+  Notification done_;
+};
+
+// Writes all of |datagrams|, waiting when the socket is full
+static void WriteAll(UDPSocket* socket,
+                     std::vector<UDPSocket::Datagram> datagrams) {
+  while (!datagrams.empty()) {
+    Notification written;
+    StatusOr<int> write_or = socket->WriteBatch(
+        &datagrams, [&written](StatusOr<int>) { written.Notify(); });
+    if (write_or.status().IsTryAgain()) {
+      written.WaitForNotification();
+    } else if (!write_or.ok()) {
+      printf("write failed: %s\n", write_or.status().ToString().c_str());
+      return;
+    }
+  }
+}
+
+// Sends |kDatagramsPerRun| datagrams, |batch| entries per WriteBatch() of
+// |segments| datagrams each, and reads up to |read_batch| per ReadBatch()
+void Measure(const char* name, size_t batch, size_t segments,
+             size_t read_batch, bool gro) {
+  UDPSocket::Options options;
+  options.receive_buffer_size = 8 << 20;
+  options.gro = gro;
+  std::unique_ptr<UDPSocket> receiver;
+  std::unique_ptr<UDPSocket> sender;
+  Status status =
+      UDPSocket::Bind(InetAddress("127.0.0.1", 0), options, &receiver);
+  if (status.ok()) {
+    status = UDPSocket::Bind(InetAddress("127.0.0.1", 0), UDPSocket::Options(),
+                             &sender);
+  }
+  if (!status.ok()) {
+    printf("bind failed: %s\n", status.ToString().c_str());
+    return;
+  }
+  InetAddress address;
+  receiver->GetLocalAddress(&address);
+
+  RefSlice payload =
+      RefSlice::CopyFrom(std::string(kDatagramSize * segments, 'x'));
+  std::vector<UDPSocket::Datagram> datagrams(
+      batch, UDPSocket::Datagram(payload, address));
+  for (auto& datagram : datagrams) {
+    datagram.segment_size = segments > 1 ? kDatagramSize : 0;
+  }
+
+  Receiver counter(receiver.get(), read_batch);
+  counter.Start();
+  Time start = Time::Now();
+  for (size_t sent = 0; sent < kDatagramsPerRun; sent += batch * segments) {
+    WriteAll(sender.get(), datagrams);
+  }
+  Time::Delta elapsed = Time::Now() - start;
+  // Lets the receiver catch up, then ends the run. The marker may be lost
+  // like any datagram, so it is repeated.
+  std::vector<UDPSocket::Datagram> end(
+      1, UDPSocket::Datagram(RefSlice::CopyFrom("e"), address));
+  while (!counter.ended()) {
+    usleep(10 * 1000);
+    WriteAll(sender.get(), end);
+  }
+
+  double seconds = elapsed.ToMicroseconds() / 1e6;
+  printf("%-28s %10.0f datagrams/s sent, %5.1f%% received\n", name,
+         kDatagramsPerRun / seconds,
+         counter.datagrams() * 100.0 / kDatagramsPerRun);
+}
+
+}  // namespace iomgr
+
+int main(int argc, char** argv) {
+  const size_t kMaxBatch = iomgr::UDPSocket::kMaxBatch;
+  iomgr::Measure("one per call", 1, 1, 1, false);
+  iomgr::Measure("sendmmsg/recvmmsg x64", kMaxBatch, 1, kMaxBatch, false);
+  // 48 datagrams of 1200 bytes fill a 64 KB send
+  iomgr::Measure("GSO x48", 1, 48, kMaxBatch, false);
+  iomgr::Measure("GSO x48 + GRO", 1, 48, kMaxBatch, true);
+  iomgr::Measure("sendmmsg x16 of GSO x48 + GRO", 16, 48, kMaxBatch, true);
+  return 0;
+}
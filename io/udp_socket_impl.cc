@@ -0,0 +1,523 @@
+#include "io/udp_socket_impl.h"
+
+#include <errno.h>
+#include <netinet/udp.h>
+#include <string.h>
+
+#include <algorithm>
+#include <functional>
+
+#include "io/io_manager.h"
+#include "iomgr/io_buffer.h"
+#include "iomgr/io_buffer_pool.h"
+#include "util/file_op.h"
+#include "util/os_error.h"
+#include "util/sockaddr_storage.h"
+#include "util/socket_op.h"
+
+namespace iomgr {
+
+const size_t UDPSocket::kMaxBatch;
+const size_t UDPSocket::kMaxGROSize;
+const size_t UDPSocket::kMaxSegments;
+
+UDPSocket::UDPSocket() = default;
+
+UDPSocket::~UDPSocket() = default;
+
+Status UDPSocket::Bind(const InetAddress& local, const Options& options,
+                       std::unique_ptr<UDPSocket>* socket) {
+  DCHECK(socket);
+  DCHECK_LT(0u, options.max_datagram_size);
+
+  SockaddrStorage address(local);
+  if (!address.IsValid()) {
+    return Status::InvalidArg("Address to bind is invalid");
+  }
+
+  std::unique_ptr<UDPSocketImpl> udp_socket(new UDPSocketImpl);
+  if (!udp_socket) {
+    return Status::OutOfMemory("Failed to allocate UDPSocket");
+  }
+
+  Status status;
+  if (!(status = udp_socket->Open(address.address_family())).ok()) {
+    return status;
+  }
+  if (options.reuse_address &&
+      !(status = udp_socket->SetReuseAddress(true)).ok()) {
+    return status;
+  }
+  if (options.reuse_port && !(status = udp_socket->SetReusePort(true)).ok()) {
+    return status;
+  }
+  if (options.receive_buffer_size > 0 &&
+      !(status = udp_socket->SetReceiveBufferSize(options.receive_buffer_size))
+           .ok()) {
+    return status;
+  }
+  if (options.send_buffer_size > 0 &&
+      !(status = udp_socket->SetSendBufferSize(options.send_buffer_size))
+           .ok()) {
+    return status;
+  }
+  if (options.gro && !(status = udp_socket->EnableGRO()).ok()) {
+    return status;
+  }
+  if (options.resource_quota) {
+    udp_socket->SetResourceQuota(options.resource_quota);
+  }
+  udp_socket->set_max_datagram_size(options.max_datagram_size);
+  if (!(status = udp_socket->Bind(local)).ok()) {
+    return status;
+  }
+  *socket = std::move(udp_socket);
+  return Status();
+}
+
+UDPSocketImpl::UDPSocketImpl()
+    : socket_fd_(),
+      io_manager_(IOManager::Get()),
+      max_datagram_size_(2048),
+      gro_(false),
+      resource_user_(MakeRefCounted<ResourceUser>(ResourceQuota::Get())),
+      read_socket_controller_(),
+      read_watching_(false),
+      read_mutex_(),
+      read_datagrams_(nullptr),
+      read_max_datagrams_(0),
+      read_callback_(),
+      reading_(false),
+      read_again_(false),
+      read_quota_waiting_(false),
+      write_socket_controller_(),
+      write_watching_(false),
+      write_mutex_(),
+      write_datagrams_(nullptr),
+      write_callback_(),
+      writing_(false),
+      write_again_(false),
+      local_address_() {}
+
+UDPSocketImpl::~UDPSocketImpl() { Close(); }
+
+Status UDPSocketImpl::Open(int family) {
+  DCHECK_EQ(-1, socket_fd_);
+  DCHECK(family == InetAddress::kIPv4 || family == InetAddress::kIPv6);
+
+  StatusOr<int> ret = SocketOp::socket(family, SOCK_DGRAM, 0);
+  if (ret.ok()) {
+    socket_fd_.reset(ret.value());
+    Status status = FileOp::set_non_blocking(socket_fd_);
+    if (!status.ok()) {
+      LOG(ERROR) << "Failed to set nonblocking";
+      socket_fd_.reset();
+      return status;
+    }
+  }
+  return ret.status();
+}
+
+Status UDPSocketImpl::Bind(const InetAddress& local) {
+  DCHECK_NE(-1, socket_fd_);
+
+  SockaddrStorage address(local);
+  if (!address.IsValid()) {
+    LOG(ERROR) << "Address to be binded is invalid";
+    return Status::InvalidArg("Address is invalid");
+  }
+
+  Status status = SocketOp::bind(socket_fd_, address.addr, address.addr_len);
+  if (!status.ok()) {
+    LOG(ERROR) << "Failed to bind address: " << status.ToString();
+  }
+  return status;
+}
+
+Status UDPSocketImpl::SetReuseAddress(bool enable) {
+  DCHECK_NE(-1, socket_fd_);
+  return SocketOp::set_reuse_addr(socket_fd_, enable);
+}
+
+Status UDPSocketImpl::SetReusePort(bool enable) {
+  DCHECK_NE(-1, socket_fd_);
+  return SocketOp::set_reuse_port(socket_fd_, enable);
+}
+
+Status UDPSocketImpl::SetReceiveBufferSize(int size) {
+  DCHECK_NE(-1, socket_fd_);
+  return SocketOp::set_receive_buffer_size(socket_fd_, size);
+}
+
+Status UDPSocketImpl::SetSendBufferSize(int size) {
+  DCHECK_NE(-1, socket_fd_);
+  return SocketOp::set_send_buffer_size(socket_fd_, size);
+}
+
+Status UDPSocketImpl::EnableGRO() {
+  DCHECK_NE(-1, socket_fd_);
+  Status status = SocketOp::set_udp_gro(socket_fd_, true);
+  if (status.ok()) {
+    gro_ = true;
+  }
+  return status;
+}
+
+void UDPSocketImpl::SetResourceQuota(ResourceQuota* quota) {
+  DCHECK(quota);
+  DCHECK(!read_callback_);
+  resource_user_ = MakeRefCounted<ResourceUser>(quota);
+}
+
+StatusOr<int> UDPSocketImpl::ReadBatch(std::vector<Datagram>* datagrams,
+                                       size_t max_datagrams,
+                                       StatusOrIntCallback read_callback) {
+  DCHECK_NE(-1, socket_fd_);
+  DCHECK(read_callback);  // callback is valid
+  DCHECK(datagrams);
+  DCHECK_LT(0u, max_datagrams);
+
+  {
+    MutexLock lock(&read_mutex_);
+    DCHECK(!read_callback_);  // no read pending
+    read_datagrams_ = datagrams;
+    read_max_datagrams_ = max_datagrams;
+    read_callback_ = std::move(read_callback);
+    reading_ = true;
+  }
+  // Watched before trying, so that no datagram arrives unnoticed between
+  // the last read and the wait
+  if (!read_watching_ &&
+      !io_manager_->WatchFileDescriptor(socket_fd_, IOWatcher::kWatchRead,
+                                        this, &read_socket_controller_)) {
+    LOG(ERROR) << "WatchFileIO failed on read";
+    Status status = MapSystemError(errno);
+    MutexLock lock(&read_mutex_);
+    read_datagrams_ = nullptr;
+    read_max_datagrams_ = 0;
+    read_callback_ = nullptr;
+    reading_ = false;
+    read_again_ = false;
+    return status;
+  }
+  read_watching_ = true;
+
+  StatusOrIntCallback callback;
+  StatusOr<int> read_or = TryRead(&callback);
+  if (read_or.status().IsTryAgain()) {
+    return Status::TryAgain("READ PENDING");
+  }
+  return read_or;
+}
+
+StatusOr<int> UDPSocketImpl::WriteBatch(std::vector<Datagram>* datagrams,
+                                        StatusOrIntCallback write_callback) {
+  DCHECK_NE(-1, socket_fd_);
+  DCHECK(write_callback);                    // callback is valid
+  DCHECK(datagrams && !datagrams->empty());  // datagrams are valid
+
+  {
+    MutexLock lock(&write_mutex_);
+    DCHECK(!write_callback_);  // No writing pending
+    write_datagrams_ = datagrams;
+    write_callback_ = std::move(write_callback);
+    writing_ = true;
+  }
+  if (!write_watching_ &&
+      !io_manager_->WatchFileDescriptor(socket_fd_, IOWatcher::kWatchWrite,
+                                        this, &write_socket_controller_)) {
+    LOG(ERROR) << "WatchFileIO failed on write";
+    Status status = MapSystemError(errno);
+    MutexLock lock(&write_mutex_);
+    write_datagrams_ = nullptr;
+    write_callback_ = nullptr;
+    writing_ = false;
+    write_again_ = false;
+    return status;
+  }
+  write_watching_ = true;
+
+  StatusOrIntCallback callback;
+  StatusOr<int> write_or = TryWrite(&callback);
+  if (write_or.status().IsTryAgain()) {
+    return Status::TryAgain("WRITE PENDING");
+  }
+  return write_or;
+}
+
+Status UDPSocketImpl::GetLocalAddress(InetAddress* local) const {
+  DCHECK_NE(-1, socket_fd_);
+  DCHECK(local);
+
+  if (local_address_) {
+    *local = local_address_->ToInetAddress();
+    return Status();
+  }
+
+  SockaddrStorage address;
+  Status status =
+      SocketOp::get_local_name(socket_fd_, address.addr, &address.addr_len);
+  if (!status.ok()) {
+    return status;
+  }
+  *local = address.ToInetAddress();
+  local_address_.reset(new SockaddrStorage(address));
+  return Status();
+}
+
+Status UDPSocketImpl::Close() {
+  bool ok = read_socket_controller_.StopWatching();
+  DCHECK(ok);
+  ok = write_socket_controller_.StopWatching();
+  DCHECK(ok);
+  // Like the watches, waits for a read resumed on another thread
+  resource_user_->CancelWait();
+  read_watching_ = false;
+  write_watching_ = false;
+  socket_fd_.reset();
+
+  {
+    MutexLock lock(&read_mutex_);
+    read_datagrams_ = nullptr;
+    read_max_datagrams_ = 0;
+    read_callback_ = nullptr;
+    reading_ = false;
+    read_again_ = false;
+    read_quota_waiting_ = false;
+  }
+  {
+    MutexLock lock(&write_mutex_);
+    write_datagrams_ = nullptr;
+    write_callback_ = nullptr;
+    writing_ = false;
+    write_again_ = false;
+  }
+  local_address_.reset();
+  return Status();
+}
+
+StatusOr<int> UDPSocketImpl::DoReadBatch(std::vector<Datagram>* datagrams,
+                                         size_t max_datagrams) {
+  // Nothing is allocated for a wakeup that finds the socket empty. An empty
+  // peek tells without taking the datagram, even one of zero bytes.
+  StatusOr<int> peek_or = SocketOp::recv(socket_fd_, nullptr, 0, MSG_PEEK);
+  if (!peek_or.ok()) {
+    return peek_or;
+  }
+
+  // One pooled buffer for the whole batch, cut into a slot per datagram
+  size_t slot_size = gro_ ? kMaxGROSize : max_datagram_size_;
+  size_t count = std::min(max_datagrams, kMaxBatch);
+  count = std::min(count, std::max<size_t>(
+                              1, IOBufferPool::kMaxBufferSize / slot_size));
+  RefPtr<IOBufferWithSize> buffer =
+      IOBufferPool::Get()->Alloc(count * slot_size, resource_user_.get());
+
+  struct mmsghdr msgs[kMaxBatch];
+  struct iovec iov[kMaxBatch];
+  struct sockaddr_storage names[kMaxBatch];
+  // Room for the UDP_GRO message
+  union {
+    char buf[CMSG_SPACE(sizeof(int))];
+    struct cmsghdr align;
+  } control[kMaxBatch];
+  memset(msgs, 0, count * sizeof(msgs[0]));
+  for (size_t i = 0; i < count; ++i) {
+    iov[i].iov_base = buffer->data() + i * slot_size;
+    iov[i].iov_len = slot_size;
+    msgs[i].msg_hdr.msg_name = &names[i];
+    msgs[i].msg_hdr.msg_namelen = sizeof(names[i]);
+    msgs[i].msg_hdr.msg_iov = &iov[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+    if (gro_) {
+      msgs[i].msg_hdr.msg_control = control[i].buf;
+      msgs[i].msg_hdr.msg_controllen = sizeof(control[i].buf);
+    }
+  }
+
+  StatusOr<int> read_or = SocketOp::recvmmsg(socket_fd_, msgs, count, 0);
+  if (!read_or.ok()) {
+    return read_or;
+  }
+  for (int i = 0; i < read_or.value(); ++i) {
+    const struct msghdr& hdr = msgs[i].msg_hdr;
+    SockaddrStorage from;
+    memcpy(&from.addr_storage, &names[i], hdr.msg_namelen);
+    from.addr_len = hdr.msg_namelen;
+    // Copied out, the batch buffer goes back to the pool on return
+    RefSlice data;
+    if (msgs[i].msg_len > 0) {
+      RefPtr<IOBufferWithSize> copy =
+          IOBufferPool::Get()->Alloc(msgs[i].msg_len, resource_user_.get());
+      memcpy(copy->data(), buffer->data() + i * slot_size, msgs[i].msg_len);
+      data = RefSlice(std::move(copy), 0, msgs[i].msg_len);
+    }
+    Datagram datagram(std::move(data), from.ToInetAddress());
+    datagram.truncated = (hdr.msg_flags & MSG_TRUNC) != 0;
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr); cmsg;
+         cmsg = CMSG_NXTHDR(const_cast<struct msghdr*>(&hdr), cmsg)) {
+      if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+        int segment_size;
+        memcpy(&segment_size, CMSG_DATA(cmsg), sizeof(segment_size));
+        if (static_cast<size_t>(segment_size) < msgs[i].msg_len) {
+          datagram.segment_size = segment_size;
+        }
+      }
+    }
+    datagrams->push_back(std::move(datagram));
+  }
+  return read_or;
+}
+
+StatusOr<int> UDPSocketImpl::DoWriteBatch(std::vector<Datagram>* datagrams) {
+  size_t count = std::min(datagrams->size(), kMaxBatch);
+  struct mmsghdr msgs[kMaxBatch];
+  struct iovec iov[kMaxBatch];
+  struct sockaddr_storage names[kMaxBatch];
+  // Room for the UDP_SEGMENT message
+  union {
+    char buf[CMSG_SPACE(sizeof(uint16_t))];
+    struct cmsghdr align;
+  } control[kMaxBatch];
+  memset(msgs, 0, count * sizeof(msgs[0]));
+  for (size_t i = 0; i < count; ++i) {
+    const Datagram& datagram = (*datagrams)[i];
+    SockaddrStorage to(datagram.address);
+    DCHECK(to.IsValid());
+    memcpy(&names[i], to.addr, to.addr_len);
+    iov[i].iov_base = const_cast<char*>(datagram.data.data());
+    iov[i].iov_len = datagram.data.size();
+    msgs[i].msg_hdr.msg_name = &names[i];
+    msgs[i].msg_hdr.msg_namelen = to.addr_len;
+    msgs[i].msg_hdr.msg_iov = &iov[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+    if (datagram.segment_size > 0 &&
+        datagram.segment_size < datagram.data.size()) {
+      DCHECK_LE(datagram.data.size(), kMaxSegments * datagram.segment_size);
+      // Cut by the kernel, or by the NIC if it can
+      msgs[i].msg_hdr.msg_control = control[i].buf;
+      msgs[i].msg_hdr.msg_controllen = sizeof(control[i].buf);
+      struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msgs[i].msg_hdr);
+      cmsg->cmsg_level = SOL_UDP;
+      cmsg->cmsg_type = UDP_SEGMENT;
+      cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+      uint16_t segment_size = static_cast<uint16_t>(datagram.segment_size);
+      memcpy(CMSG_DATA(cmsg), &segment_size, sizeof(segment_size));
+    }
+  }
+
+  StatusOr<int> write_or = SocketOp::sendmmsg(socket_fd_, msgs, count, 0);
+  if (write_or.ok()) {
+    datagrams->erase(datagrams->begin(),
+                     datagrams->begin() + write_or.value());
+  }
+  return write_or;
+}
+
+StatusOr<int> UDPSocketImpl::TryRead(StatusOrIntCallback* callback) {
+  for (;;) {
+    bool over_quota = resource_user_->IsOverQuota();
+    StatusOr<int> read_or =
+        over_quota ? StatusOr<int>(Status::TryAgain("OVER QUOTA"))
+                   : DoReadBatch(read_datagrams_, read_max_datagrams_);
+    MutexLock lock(&read_mutex_);
+    if (over_quota) {
+      // Leave the datagrams in the socket until memory is released. Events
+      // meanwhile are of no use, the wait resumes the read.
+      if (!read_quota_waiting_) {
+        read_quota_waiting_ = true;
+        resource_user_->WaitForQuota(
+            std::bind(&UDPSocketImpl::OnQuotaAvailable, this));
+      }
+      reading_ = false;
+      read_again_ = false;
+      return read_or;
+    }
+    if (read_or.status().IsTryAgain() && read_again_) {
+      read_again_ = false;
+      continue;
+    }
+    reading_ = false;
+    read_again_ = false;
+    if (!read_or.status().IsTryAgain()) {
+      *callback = std::move(read_callback_);
+      read_callback_ = nullptr;
+      read_datagrams_ = nullptr;
+      read_max_datagrams_ = 0;
+    }
+    return read_or;
+  }
+}
+
+StatusOr<int> UDPSocketImpl::TryWrite(StatusOrIntCallback* callback) {
+  for (;;) {
+    StatusOr<int> write_or = DoWriteBatch(write_datagrams_);
+    MutexLock lock(&write_mutex_);
+    if (write_or.status().IsTryAgain() && write_again_) {
+      write_again_ = false;
+      continue;
+    }
+    writing_ = false;
+    write_again_ = false;
+    if (!write_or.status().IsTryAgain()) {
+      *callback = std::move(write_callback_);
+      write_callback_ = nullptr;
+      write_datagrams_ = nullptr;
+    }
+    return write_or;
+  }
+}
+
+void UDPSocketImpl::OnQuotaAvailable() {
+  {
+    MutexLock lock(&read_mutex_);
+    read_quota_waiting_ = false;
+  }
+  OnFileReadable(socket_fd_);
+}
+
+void UDPSocketImpl::OnFileReadable(int fd) {
+  {
+    MutexLock lock(&read_mutex_);
+    if (!read_callback_ || read_quota_waiting_) {
+      return;
+    }
+    if (reading_) {
+      read_again_ = true;
+      return;
+    }
+    reading_ = true;
+  }
+
+  StatusOrIntCallback callback;
+  StatusOr<int> read_or = TryRead(&callback);
+  if (read_or.status().IsTryAgain()) {
+    return;
+  }
+  // The callback may start the next read
+  callback(read_or);
+}
+
+void UDPSocketImpl::OnFileWritable(int fd) {
+  {
+    MutexLock lock(&write_mutex_);
+    if (!write_callback_) {
+      return;
+    }
+    if (writing_) {
+      write_again_ = true;
+      return;
+    }
+    writing_ = true;
+  }
+
+  StatusOrIntCallback callback;
+  StatusOr<int> write_or = TryWrite(&callback);
+  if (write_or.status().IsTryAgain()) {
+    return;
+  }
+  // The callback may start the next write
+  callback(write_or);
+}
+
+}  // namespace iomgr
@@ -0,0 +1,97 @@
+#ifndef LIBIOMGR_IO_UDP_SOCKET_IMPL_H_
+#define LIBIOMGR_IO_UDP_SOCKET_IMPL_H_
+
+#include <memory>
+#include <vector>
+
+#include "iomgr/io_watcher.h"
+#include "iomgr/ref_counted.h"
+#include "iomgr/resource_quota.h"
+#include "iomgr/udp/udp_socket.h"
+#include "util/scoped_fd.h"
+#include "util/sync.h"
+
+namespace iomgr {
+
+class IOManager;
+class SockaddrStorage;
+
+class UDPSocketImpl : public UDPSocket, IOWatcher {
+ public:
+  UDPSocketImpl();
+  ~UDPSocketImpl() override;
+
+  UDPSocketImpl(const UDPSocketImpl&) = delete;
+  UDPSocketImpl& operator=(const UDPSocketImpl&) = delete;
+
+  Status Open(int family);
+  Status Bind(const InetAddress& local);
+  Status SetReuseAddress(bool enable);
+  Status SetReusePort(bool enable);
+  Status SetReceiveBufferSize(int size);
+  Status SetSendBufferSize(int size);
+  // Sets UDP_GRO, see UDPSocket::Options::gro
+  Status EnableGRO();
+  void set_max_datagram_size(size_t size) { max_datagram_size_ = size; }
+  // Replaces the process-wide quota. Must be called before any read.
+  void SetResourceQuota(ResourceQuota* quota);
+  StatusOr<int> ReadBatch(std::vector<Datagram>* datagrams,
+                          size_t max_datagrams,
+                          StatusOrIntCallback read_callback) override;
+  StatusOr<int> WriteBatch(std::vector<Datagram>* datagrams,
+                           StatusOrIntCallback write_callback) override;
+  Status GetLocalAddress(InetAddress* local) const override;
+  Status Close() override;
+
+ private:
+  StatusOr<int> DoReadBatch(std::vector<Datagram>* datagrams,
+                            size_t max_datagrams);
+  StatusOr<int> DoWriteBatch(std::vector<Datagram>* datagrams);
+  // Read or write for the pending request, which the caller has claimed by
+  // setting |reading_| or |writing_|. Moves the callback to |callback| once
+  // the request is done.
+  StatusOr<int> TryRead(StatusOrIntCallback* callback);
+  StatusOr<int> TryWrite(StatusOrIntCallback* callback);
+  // Resumes the pending read once the socket is back under quota
+  void OnQuotaAvailable();
+  void OnFileReadable(int fd) override;
+  void OnFileWritable(int fd) override;
+
+  ScopedFD socket_fd_;
+  IOManager* io_manager_;
+  size_t max_datagram_size_;
+  bool gro_;
+  // Share of the socket in its ResourceQuota
+  RefPtr<ResourceUser> resource_user_;
+
+  // The socket stays watched from the first read or write on, events are
+  // ignored while no request is pending. Events may be handled by several
+  // threads at once, only one of them reads or writes at a time, and has
+  // another go if events arrived meanwhile.
+  IOWatcher::Controller read_socket_controller_;
+  bool read_watching_;
+  Mutex read_mutex_;
+  // Non-null when a ReadBatch() is in progress
+  std::vector<Datagram>* read_datagrams_;
+  size_t read_max_datagrams_;
+  StatusOrIntCallback read_callback_;
+  bool reading_;
+  bool read_again_;
+  // True while a read waits for the quota
+  bool read_quota_waiting_;
+
+  IOWatcher::Controller write_socket_controller_;
+  bool write_watching_;
+  Mutex write_mutex_;
+  // Non-null when a WriteBatch() is in progress
+  std::vector<Datagram>* write_datagrams_;
+  StatusOrIntCallback write_callback_;
+  bool writing_;
+  bool write_again_;
+
+  mutable std::unique_ptr<SockaddrStorage> local_address_;
+};
+
+}  // namespace iomgr
+
+#endif  // LIBIOMGR_IO_UDP_SOCKET_IMPL_H_
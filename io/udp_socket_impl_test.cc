@@ -0,0 +1,276 @@
+#include "io/udp_socket_impl.h"
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "io/test/async_test_callback.h"
+#include "iomgr/io_buffer_pool.h"
+#include "iomgr/ref_slice.h"
+#include "iomgr/resource_quota.h"
+
+namespace iomgr {
+
+const InetAddress local_host("127.0.0.1", 0);
+
+class UDPSocketImplTest : public testing::Test {
+ protected:
+  void SetUp() {
+    EXPECT_TRUE(UDPSocket::Bind(local_host, UDPSocket::Options(), &sender_)
+                    .ok());
+    EXPECT_TRUE(sender_->GetLocalAddress(&sender_address_).ok());
+  }
+
+  void BindReceiver(const UDPSocket::Options& options) {
+    EXPECT_TRUE(UDPSocket::Bind(local_host, options, &receiver_).ok());
+    EXPECT_TRUE(receiver_->GetLocalAddress(&receiver_address_).ok());
+  }
+
+  // Reads from |receiver_| until |size| bytes have arrived
+  std::vector<UDPSocket::Datagram> ReadAll(size_t size) {
+    std::vector<UDPSocket::Datagram> datagrams;
+    size_t received = 0;
+    while (received < size) {
+      size_t first = datagrams.size();
+      StatusOrResultCallback read_callback;
+      StatusOr<int> read_result = receiver_->ReadBatch(
+          &datagrams, UDPSocket::kMaxBatch, read_callback.callback());
+      read_result = read_callback.GetResult(read_result);
+      if (!read_result.ok()) {
+        break;
+      }
+      for (size_t i = first; i < datagrams.size(); ++i) {
+        received += datagrams[i].data.size();
+      }
+    }
+    return datagrams;
+  }
+
+  std::unique_ptr<UDPSocket> sender_;
+  std::unique_ptr<UDPSocket> receiver_;
+  InetAddress sender_address_;
+  InetAddress receiver_address_;
+};
+
+TEST_F(UDPSocketImplTest, WriteAndReadBatch) {
+  BindReceiver(UDPSocket::Options());
+
+  std::vector<UDPSocket::Datagram> datagrams;
+  std::vector<std::string> messages;
+  size_t size = 0;
+  for (int i = 0; i < 10; ++i) {
+    messages.push_back("datagram " + std::string(i * 100, 'a' + i));
+    datagrams.emplace_back(RefSlice::CopyFrom(messages.back()),
+                           receiver_address_);
+    size += messages.back().size();
+  }
+  StatusOrResultCallback write_callback;
+  StatusOr<int> write_result =
+      sender_->WriteBatch(&datagrams, write_callback.callback());
+  // All fit in the socket buffer, in one sendmmsg()
+  EXPECT_TRUE(write_result.ok());
+  EXPECT_EQ(10, write_result.value());
+  EXPECT_TRUE(datagrams.empty());
+
+  std::vector<UDPSocket::Datagram> received = ReadAll(size);
+  ASSERT_EQ(messages.size(), received.size());
+  for (size_t i = 0; i < received.size(); ++i) {
+    EXPECT_EQ(messages[i], received[i].data.ToString());
+    EXPECT_EQ(sender_address_, received[i].address);
+    EXPECT_EQ(0u, received[i].segment_size);
+  }
+}
+
+TEST_F(UDPSocketImplTest, ReadWaitsForDatagrams) {
+  BindReceiver(UDPSocket::Options());
+
+  std::vector<UDPSocket::Datagram> received;
+  StatusOrResultCallback read_callback;
+  StatusOr<int> read_result =
+      receiver_->ReadBatch(&received, 4, read_callback.callback());
+  EXPECT_TRUE(read_result.status().IsTryAgain());
+
+  std::vector<UDPSocket::Datagram> datagrams;
+  datagrams.emplace_back(RefSlice::CopyFrom("ping"), receiver_address_);
+  StatusOrResultCallback write_callback;
+  EXPECT_EQ(1, write_callback
+                   .GetResult(sender_->WriteBatch(&datagrams,
+                                                  write_callback.callback()))
+                   .value());
+
+  read_result = read_callback.WaitForResult();
+  EXPECT_TRUE(read_result.ok());
+  EXPECT_EQ(1, read_result.value());
+  ASSERT_EQ(1u, received.size());
+  EXPECT_EQ("ping", received[0].data.ToString());
+}
+
+// A read with nothing queued takes no buffer from the pool
+TEST_F(UDPSocketImplTest, ReadAllocatesOnlyWithData) {
+  BindReceiver(UDPSocket::Options());
+
+  IOBufferPool::Stats before = IOBufferPool::Get()->GetStats();
+  std::vector<UDPSocket::Datagram> received;
+  StatusOrResultCallback read_callback;
+  StatusOr<int> read_result = receiver_->ReadBatch(
+      &received, UDPSocket::kMaxBatch, read_callback.callback());
+  EXPECT_TRUE(read_result.status().IsTryAgain());
+  IOBufferPool::Stats after = IOBufferPool::Get()->GetStats();
+  EXPECT_EQ(before.hits + before.misses, after.hits + after.misses);
+
+  // An empty datagram is still one
+  std::vector<UDPSocket::Datagram> datagrams;
+  datagrams.emplace_back(RefSlice(), receiver_address_);
+  StatusOrResultCallback write_callback;
+  EXPECT_EQ(1, write_callback
+                   .GetResult(sender_->WriteBatch(&datagrams,
+                                                  write_callback.callback()))
+                   .value());
+  read_result = read_callback.WaitForResult();
+  EXPECT_TRUE(read_result.ok());
+  EXPECT_EQ(1, read_result.value());
+  ASSERT_EQ(1u, received.size());
+  EXPECT_TRUE(received[0].data.empty());
+}
+
+TEST_F(UDPSocketImplTest, ReadTruncated) {
+  UDPSocket::Options options;
+  options.max_datagram_size = 100;
+  BindReceiver(options);
+
+  std::vector<UDPSocket::Datagram> datagrams;
+  const std::string long_message(150, 'l');
+  const std::string short_message(50, 's');
+  datagrams.emplace_back(RefSlice::CopyFrom(long_message), receiver_address_);
+  datagrams.emplace_back(RefSlice::CopyFrom(short_message), receiver_address_);
+  StatusOrResultCallback write_callback;
+  EXPECT_EQ(2, write_callback
+                   .GetResult(sender_->WriteBatch(&datagrams,
+                                                  write_callback.callback()))
+                   .value());
+
+  std::vector<UDPSocket::Datagram> received = ReadAll(150);
+  ASSERT_EQ(2u, received.size());
+  EXPECT_EQ(long_message.substr(0, 100), received[0].data.ToString());
+  EXPECT_TRUE(received[0].truncated);
+  EXPECT_EQ(short_message, received[1].data.ToString());
+  EXPECT_FALSE(received[1].truncated);
+}
+
+// Each datagram holds a buffer of its own size, charged to the quota, and
+// reads wait while the socket is over quota
+TEST_F(UDPSocketImplTest, ReadWaitsForQuota) {
+  ResourceQuota quota;
+  quota.SetPerUserLimit(1024);
+  UDPSocket::Options options;
+  options.resource_quota = &quota;
+  BindReceiver(options);
+
+  std::vector<UDPSocket::Datagram> datagrams;
+  const std::string first_message(1000, 'a');
+  const std::string second_message(10, 'b');
+  datagrams.emplace_back(RefSlice::CopyFrom(first_message),
+                         receiver_address_);
+  datagrams.emplace_back(RefSlice::CopyFrom(second_message),
+                         receiver_address_);
+  StatusOrResultCallback write_callback;
+  EXPECT_EQ(2, write_callback
+                   .GetResult(sender_->WriteBatch(&datagrams,
+                                                  write_callback.callback()))
+                   .value());
+
+  std::vector<UDPSocket::Datagram> first;
+  StatusOrResultCallback first_callback;
+  StatusOr<int> read_result =
+      receiver_->ReadBatch(&first, 1, first_callback.callback());
+  read_result = first_callback.GetResult(read_result);
+  ASSERT_TRUE(read_result.ok());
+  ASSERT_EQ(1u, first.size());
+  EXPECT_EQ(first_message, first[0].data.ToString());
+  // The batch buffer went back, only the copy of the datagram is held
+  EXPECT_EQ(1024u, quota.used());
+
+  // The second datagram stays in the socket until the first is released
+  std::vector<UDPSocket::Datagram> second;
+  StatusOrResultCallback second_callback;
+  read_result = receiver_->ReadBatch(&second, 1, second_callback.callback());
+  EXPECT_TRUE(read_result.status().IsTryAgain());
+  first.clear();
+  read_result = second_callback.GetResult(read_result);
+  ASSERT_TRUE(read_result.ok());
+  ASSERT_EQ(1u, second.size());
+  EXPECT_EQ(second_message, second[0].data.ToString());
+  second.clear();
+  EXPECT_EQ(0u, quota.used());
+  // Closed before the quota goes away
+  receiver_.reset();
+}
+
+TEST_F(UDPSocketImplTest, SegmentationOffload) {
+  BindReceiver(UDPSocket::Options());
+
+  // One send, cut into 10 datagrams of 1000 bytes but the last
+  std::string message;
+  for (int i = 0; i < 10; ++i) {
+    message += std::string(i < 9 ? 1000 : 500, '0' + i);
+  }
+  std::vector<UDPSocket::Datagram> datagrams;
+  datagrams.emplace_back(RefSlice::CopyFrom(message), receiver_address_);
+  datagrams.back().segment_size = 1000;
+  StatusOrResultCallback write_callback;
+  StatusOr<int> write_result = write_callback.GetResult(
+      sender_->WriteBatch(&datagrams, write_callback.callback()));
+  EXPECT_TRUE(write_result.ok());
+  EXPECT_EQ(1, write_result.value());
+
+  std::vector<UDPSocket::Datagram> received = ReadAll(message.size());
+  ASSERT_EQ(10u, received.size());
+  for (size_t i = 0; i < received.size(); ++i) {
+    EXPECT_EQ(message.substr(i * 1000, 1000), received[i].data.ToString());
+  }
+}
+
+TEST_F(UDPSocketImplTest, ReceiveOffload) {
+  UDPSocket::Options options;
+  options.gro = true;
+  BindReceiver(options);
+
+  std::string message;
+  for (int i = 0; i < 10; ++i) {
+    message += std::string(1000, '0' + i);
+  }
+  std::vector<UDPSocket::Datagram> datagrams;
+  datagrams.emplace_back(RefSlice::CopyFrom(message), receiver_address_);
+  datagrams.back().segment_size = 1000;
+  StatusOrResultCallback write_callback;
+  EXPECT_TRUE(write_callback
+                  .GetResult(sender_->WriteBatch(&datagrams,
+                                                 write_callback.callback()))
+                  .ok());
+
+  // Whether the datagrams come coalesced is up to the kernel, but each read
+  // tells how to cut them
+  std::vector<UDPSocket::Datagram> received = ReadAll(message.size());
+  std::string joined;
+  size_t count = 0;
+  for (const UDPSocket::Datagram& datagram : received) {
+    joined += datagram.data.ToString();
+    if (datagram.segment_size == 0) {
+      ++count;
+    } else {
+      EXPECT_EQ(1000u, datagram.segment_size);
+      count += (datagram.data.size() + 999) / 1000;
+    }
+  }
+  EXPECT_EQ(message, joined);
+  EXPECT_EQ(10u, count);
+}
+
+}  // namespace iomgr
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,204 @@
+#include "io/zero_copy_tracker.h"
+
+#include <glog/logging.h>
+#include <linux/errqueue.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <atomic>
+
+#include "io/io_manager.h"
+#include "iomgr/io_watcher.h"
+#include "iomgr/timer.h"
+#include "util/file_op.h"
+#include "util/socket_op.h"
+
+namespace iomgr {
+
+// Counters of TCPClient::GetZeroCopyStats()
+static std::atomic<uint64_t> s_completed(0);
+static std::atomic<uint64_t> s_copied(0);
+
+// Watches a socket given up by its owner until the buffers of its sends are
+// released, then closes it. The timeout closure and the watch each hold a
+// reference: a closure already posted when the timer is cancelled still runs,
+// and OnFileError() may run until Finish() has stopped the watch.
+class ZeroCopyTracker::Closer : public IOWatcher,
+                                public RefCounted<ZeroCopyTracker::Closer> {
+ public:
+  Closer(int fd, std::unique_ptr<ZeroCopyTracker> tracker)
+      : fd_(fd),
+        tracker_(std::move(tracker)),
+        controller_(),
+        timeout_controller_(),
+        mutex_(),
+        finished_(false) {}
+
+  void Start(IOManager* io_manager, Time::Delta timeout) {
+    // Released by Finish() once the watch is stopped
+    AddRef();
+    // Completions queued in the meantime are reported as soon as the socket
+    // is added
+    if (!io_manager->WatchFileDescriptor(fd_, IOWatcher::kWatchError, this,
+                                         &controller_)) {
+      LOG(ERROR) << "WatchFileIO failed on the error queue";
+      Finish(true);
+      return;
+    }
+
+    // Not armed once the completions finished the closer, otherwise armed
+    // before Finish() cancels it
+    MutexLock lock(&mutex_);
+    if (!finished_) {
+      Timer::Start(io_manager->timer_manager(), timeout,
+                   std::bind(&Closer::Finish, RefPtr<Closer>(this), true),
+                   &timeout_controller_);
+    }
+  }
+
+ private:
+  friend class RefCounted<Closer>;
+
+  ~Closer() override = default;
+
+  void OnFileReadable(int fd) override {}
+  void OnFileWritable(int fd) override {}
+  void OnFileError(int fd) override {
+    // Finish() may drop the reference of the watch
+    RefPtr<Closer> self(this);
+    tracker_->ReadCompletions(fd_);
+    if (tracker_->pending_sends() == 0) {
+      Finish(false);
+    }
+  }
+
+  void Finish(bool reset) {
+    {
+      MutexLock lock(&mutex_);
+      if (finished_) {
+        return;
+      }
+      finished_ = true;
+    }
+    // Waits for OnFileError() running on other threads
+    bool ok = controller_.StopWatching();
+    DCHECK(ok);
+    timeout_controller_.Cancel();
+    if (reset) {
+      // Frees the queued data, and with it the pages of the buffers
+      struct linger linger = {1, 0};
+      ::setsockopt(fd_, SOL_SOCKET, SO_LINGER, &linger, sizeof(linger));
+    }
+    FileOp::close(fd_);
+    Release();
+  }
+
+  const int fd_;
+  std::unique_ptr<ZeroCopyTracker> tracker_;
+  IOWatcher::Controller controller_;
+  Timer::Controller timeout_controller_;
+  Mutex mutex_;
+  bool finished_;
+};
+
+ZeroCopyTracker::ZeroCopyTracker()
+    : mutex_(), next_id_(0), sends_(), next_completed_(false) {}
+
+ZeroCopyTracker::~ZeroCopyTracker() = default;
+
+TCPClient::ZeroCopyStats ZeroCopyTracker::GetStats() {
+  TCPClient::ZeroCopyStats stats;
+  // Loaded in the reverse order of the updates, so that the copies never
+  // outnumber the completions
+  stats.copied = s_copied.load(std::memory_order_acquire);
+  stats.completed = s_completed.load(std::memory_order_acquire);
+  return stats;
+}
+
+void ZeroCopyTracker::CloseWhenReleased(
+    int fd, std::unique_ptr<ZeroCopyTracker> tracker, IOManager* io_manager,
+    Time::Delta timeout) {
+  DCHECK_NE(-1, fd);
+  DCHECK(tracker);
+  DCHECK(io_manager);
+
+  SocketOp::shutdown(fd, SHUT_WR);
+  RefPtr<Closer> closer = MakeRefCounted<Closer>(fd, std::move(tracker));
+  closer->Start(io_manager, timeout);
+}
+
+void ZeroCopyTracker::AddSend(std::vector<RefPtr<IOBuffer>> buffers) {
+  MutexLock lock(&mutex_);
+  uint32_t id = next_id_++;
+  if (next_completed_) {
+    next_completed_ = false;
+    // Released when |buffers| goes out of scope
+    return;
+  }
+  sends_.push_back({id, std::move(buffers)});
+}
+
+void ZeroCopyTracker::ReadCompletions(int fd) {
+  std::vector<RefPtr<IOBuffer>> released;
+  while (true) {
+    char control[CMSG_SPACE(sizeof(struct sock_extended_err)) +
+                 CMSG_SPACE(sizeof(struct sockaddr_in6))];
+    struct msghdr msg = {};
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    // Empty once it returns TryAgain
+    if (!SocketOp::recvmsg(fd, &msg, MSG_ERRQUEUE).ok()) {
+      break;
+    }
+
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg;
+         cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      if (!(cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) &&
+          !(cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)) {
+        continue;
+      }
+      const struct sock_extended_err* error =
+          reinterpret_cast<const struct sock_extended_err*>(CMSG_DATA(cmsg));
+      if (error->ee_origin != SO_EE_ORIGIN_ZEROCOPY || error->ee_errno != 0) {
+        continue;
+      }
+      // Sends |ee_info| to |ee_data|, both included
+      uint64_t count = error->ee_data - error->ee_info + 1;
+      s_completed.fetch_add(count, std::memory_order_release);
+      if (error->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+        s_copied.fetch_add(count, std::memory_order_release);
+      }
+      MutexLock lock(&mutex_);
+      ReleaseLocked(error->ee_info, error->ee_data, &released);
+    }
+  }
+  // Buffers may go back to their pool here, away from |mutex_|
+}
+
+size_t ZeroCopyTracker::pending_sends() const {
+  MutexLock lock(&mutex_);
+  return sends_.size();
+}
+
+void ZeroCopyTracker::ReleaseLocked(uint32_t first, uint32_t last,
+                                    std::vector<RefPtr<IOBuffer>>* released) {
+  // Numbers wrap around, the differences do not
+  uint32_t range = last - first;
+  // Sends are made one at a time, so only the one in progress may complete
+  // before AddSend() records it
+  if (next_id_ - first <= range) {
+    next_completed_ = true;
+  }
+  for (auto it = sends_.begin(); it != sends_.end();) {
+    if (it->id - first <= range) {
+      for (auto& buffer : it->buffers) {
+        released->push_back(std::move(buffer));
+      }
+      it = sends_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+}  // namespace iomgr
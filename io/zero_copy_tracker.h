@@ -0,0 +1,79 @@
+#ifndef LIBIOMGR_IO_ZERO_COPY_TRACKER_H_
+#define LIBIOMGR_IO_ZERO_COPY_TRACKER_H_
+
+#include <stdint.h>
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "iomgr/io_buffer.h"
+#include "iomgr/ref_counted.h"
+#include "iomgr/tcp/tcp_client.h"
+#include "iomgr/time.h"
+#include "util/sync.h"
+
+namespace iomgr {
+
+class IOManager;
+
+// ZeroCopyTracker holds the buffers of the sends made with MSG_ZEROCOPY on
+// one socket until the kernel reports, on the error queue of the socket, that
+// it no longer reads their pages.
+//
+// The kernel numbers the sends of a socket from zero, one per sendmsg() that
+// wrote something, and reports them by ranges of numbers once done.
+class ZeroCopyTracker {
+ public:
+  ZeroCopyTracker();
+  ~ZeroCopyTracker();
+
+  ZeroCopyTracker(const ZeroCopyTracker&) = delete;
+  ZeroCopyTracker& operator=(const ZeroCopyTracker&) = delete;
+
+  static TCPClient::ZeroCopyStats GetStats();
+
+  // Keeps |fd| open once its owner is done with it, until the kernel has
+  // released the buffers of all sends of |tracker|, then closes it. The
+  // write side is shut down at once. After |timeout| the connection is reset
+  // instead, which discards the data still queued and frees its pages.
+  static void CloseWhenReleased(int fd,
+                                std::unique_ptr<ZeroCopyTracker> tracker,
+                                IOManager* io_manager, Time::Delta timeout);
+
+  // Called after each sendmsg() with MSG_ZEROCOPY that wrote some bytes, in
+  // the order of the sends, with the buffers holding the bytes written. The
+  // sends must not overlap.
+  void AddSend(std::vector<RefPtr<IOBuffer>> buffers);
+
+  // Reads the completions queued on |fd| and releases the buffers of the
+  // sends they cover. Other messages on the error queue are dropped.
+  void ReadCompletions(int fd);
+
+  // Number of sends whose buffers are still held
+  size_t pending_sends() const;
+
+ private:
+  class Closer;
+
+  struct Send {
+    uint32_t id;
+    std::vector<RefPtr<IOBuffer>> buffers;
+  };
+
+  // Moves the buffers of sends |first| to |last| to |released|
+  void ReleaseLocked(uint32_t first, uint32_t last,
+                     std::vector<RefPtr<IOBuffer>>* released);
+
+  mutable Mutex mutex_;
+  // Number of the next send
+  uint32_t next_id_;
+  // In the order of their numbers
+  std::deque<Send> sends_;
+  // Set if the send numbered |next_id_| completed before it was added
+  bool next_completed_;
+};
+
+}  // namespace iomgr
+
+#endif  // LIBIOMGR_IO_ZERO_COPY_TRACKER_H_
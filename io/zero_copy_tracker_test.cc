@@ -0,0 +1,78 @@
+#include "io/zero_copy_tracker.h"
+
+#include <arpa/inet.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "io/io_manager.h"
+
+namespace iomgr {
+
+// Returns the ends of a loopback TCP connection
+static void CreateConnectedSockets(int* client, int* peer) {
+  int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+  ASSERT_NE(-1, listener);
+  struct sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t address_len = sizeof(address);
+  struct sockaddr* addr = reinterpret_cast<struct sockaddr*>(&address);
+  ASSERT_EQ(0, ::bind(listener, addr, address_len));
+  ASSERT_EQ(0, ::listen(listener, 1));
+  ASSERT_EQ(0, ::getsockname(listener, addr, &address_len));
+
+  *client = ::socket(AF_INET, SOCK_STREAM, 0);
+  ASSERT_NE(-1, *client);
+  ASSERT_EQ(0, ::connect(*client, addr, address_len));
+  *peer = ::accept(listener, nullptr, nullptr);
+  ASSERT_NE(-1, *peer);
+  ::close(listener);
+}
+
+// The completions of the sends and the timeout race to close the socket.
+// Whichever loses must not touch the closer once the other has freed it.
+TEST(ZeroCopyTrackerTest, CloseRacingTimeout) {
+  const size_t kSize = 64 * 1024;
+  RefPtr<IOBufferWithSize> buffer = MakeRefCounted<IOBufferWithSize>(kSize);
+  memset(buffer->data(), 'z', kSize);
+
+  for (int i = 0; i < 50; ++i) {
+    int client = -1;
+    int peer = -1;
+    CreateConnectedSockets(&client, &peer);
+    int one = 1;
+    ASSERT_EQ(0,
+              ::setsockopt(client, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)));
+
+    std::unique_ptr<ZeroCopyTracker> tracker(new ZeroCopyTracker());
+    ssize_t sent = ::send(client, buffer->data(), kSize, MSG_ZEROCOPY);
+    ASSERT_LT(0, sent);
+    tracker->AddSend({buffer});
+    ZeroCopyTracker::CloseWhenReleased(client, std::move(tracker),
+                                       IOManager::Get(),
+                                       Time::Delta::FromMilliseconds(i % 3));
+
+    // Until the end of the data, or the reset by the timeout
+    char data[4096];
+    while (::read(peer, data, sizeof(data)) > 0) {
+    }
+    ::close(peer);
+
+    // The tracker is freed with the closer, whichever path finished it
+    for (int j = 0; j < 500 && !buffer->HasOneRef(); ++j) {
+      usleep(10 * 1000);
+    }
+    ASSERT_TRUE(buffer->HasOneRef());
+  }
+}
+
+}  // namespace iomgr
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
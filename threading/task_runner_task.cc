@@ -37,6 +37,7 @@ void TaskRunner::Task::CancelTask() {
         }
         break;
       case kCompleted:
+      case kCanceled:
         return;
       default:
         DCHECK(0) << "No reached";
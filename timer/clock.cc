@@ -0,0 +1,27 @@
+#include "timer/clock.h"
+
+#include <time.h>
+
+namespace iomgr {
+
+std::atomic<Clock::Mode> Clock::mode_(Clock::kPrecise);
+
+Time::Delta Clock::CoarseLag() {
+  static const Time::Delta s_lag = []() {
+    struct timespec res;
+    if (clock_getres(CLOCK_MONOTONIC_COARSE, &res) != 0) {
+      // A tick with the lowest HZ the kernel may be built with
+      res.tv_sec = 0;
+      res.tv_nsec = 10 * 1000 * 1000;
+    }
+    // Rounded up, a shorter lag would let timers expire early again
+    Time::Delta tick = Time::Delta::FromMicroseconds(
+        res.tv_sec * 1000000 + (res.tv_nsec + 999) / 1000);
+    // The clock is updated by the tick, which may itself be late, notably
+    // in virtual machines
+    return tick * 2;
+  }();
+  return s_lag;
+}
+
+}  // namespace iomgr
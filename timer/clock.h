@@ -0,0 +1,51 @@
+#ifndef LIBIOMGR_TIMER_CLOCK_H_
+#define LIBIOMGR_TIMER_CLOCK_H_
+
+#include <atomic>
+
+#include "iomgr/time.h"
+
+namespace iomgr {
+
+// Clock gives the library a cheaper alternative to reading CLOCK_MONOTONIC on
+// every call. Each reactor also caches the time of its current iteration,
+// see IOManager::loop_time().
+//
+// Now() reads the clock selected by set_mode(). In kCoarse mode it reads
+// CLOCK_MONOTONIC_COARSE, which lags behind the precise clock by up to one
+// tick, and more when the tick itself runs late. Timer deadlines add
+// MaxLag(), so that they expire late rather than early.
+class Clock {
+ public:
+  enum Mode {
+    kPrecise,
+    kCoarse,
+  };
+
+  static Time Now() {
+    return mode_.load(std::memory_order_relaxed) == kCoarse ? Time::NowCoarse()
+                                                            : Time::Now();
+  }
+
+  // The most Now() may lag behind the precise clock: zero in kPrecise mode,
+  // two ticks of CLOCK_MONOTONIC_COARSE in kCoarse mode.
+  static Time::Delta MaxLag() {
+    return mode_.load(std::memory_order_relaxed) == kCoarse
+               ? CoarseLag()
+               : Time::Delta::Zero();
+  }
+
+  static Mode mode() { return mode_.load(std::memory_order_relaxed); }
+  static void set_mode(Mode mode) {
+    mode_.store(mode, std::memory_order_relaxed);
+  }
+
+ private:
+  static Time::Delta CoarseLag();
+
+  static std::atomic<Mode> mode_;
+};
+
+}  // namespace iomgr
+
+#endif  // LIBIOMGR_TIMER_CLOCK_H_
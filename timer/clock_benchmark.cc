@@ -0,0 +1,37 @@
+#include <stdio.h>
+
+#include "io/io_manager.h"
+#include "iomgr/time.h"
+#include "timer/clock.h"
+
+namespace iomgr {
+
+static const int kIterations = 10 * 1000 * 1000;
+
+// Keeps the compiler from dropping the clock reads.
+static volatile int64_t sink;
+
+template <typename ReadClock>
+void Measure(const char* name, ReadClock read_clock) {
+  Time start = Time::Now();
+  for (int i = 0; i < kIterations; ++i) {
+    sink = read_clock().ToDebuggingValue();
+  }
+  Time::Delta elapsed = Time::Now() - start;
+  printf("%-20s %8.1f ns/call\n", name,
+         elapsed.ToMicroseconds() * 1000.0 / kIterations);
+}
+
+}  // namespace iomgr
+
+int main(int argc, char** argv) {
+  using iomgr::IOManager;
+  using iomgr::Time;
+
+  IOManager* iomgr = IOManager::Get();
+  iomgr::Measure("Time::Now", &Time::Now);
+  iomgr::Measure("Time::NowCoarse", &Time::NowCoarse);
+  iomgr::Measure("IOManager::loop_time",
+                 [iomgr]() { return iomgr->loop_time(); });
+  return 0;
+}
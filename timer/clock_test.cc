@@ -0,0 +1,53 @@
+#include "timer/clock.h"
+
+#include <gtest/gtest.h>
+
+#include "iomgr/timer.h"
+#include "timer/timer_manager.h"
+
+namespace iomgr {
+
+TEST(Clock, Mode) {
+  EXPECT_EQ(Clock::kPrecise, Clock::mode());
+  Clock::set_mode(Clock::kCoarse);
+  EXPECT_EQ(Clock::kCoarse, Clock::mode());
+  Time coarse = Clock::Now();
+  EXPECT_FALSE(coarse.IsZero());
+  EXPECT_LT(coarse - Time::Now(), Time::Delta::FromMilliseconds(100));
+  Clock::set_mode(Clock::kPrecise);
+  EXPECT_EQ(Clock::kPrecise, Clock::mode());
+}
+
+TEST(Clock, MaxLag) {
+  EXPECT_EQ(Time::Delta::Zero(), Clock::MaxLag());
+  Clock::set_mode(Clock::kCoarse);
+  EXPECT_GT(Clock::MaxLag(), Time::Delta::Zero());
+  Clock::set_mode(Clock::kPrecise);
+}
+
+// A deadline computed from the coarse clock must not come before the delay
+// has passed on the precise one
+TEST(Clock, CoarseDeadlinesAreLate) {
+  Clock::set_mode(Clock::kCoarse);
+  TimerManager mgr;
+  Timer::Controller controller;
+  for (int i = 0; i < 1000; ++i) {
+    Time::Delta delay = Time::Delta::FromMicroseconds(i);
+    Time start = Time::Now();
+    mgr.TimerInit(delay, []() {}, &controller);
+    EXPECT_GE(controller.deadline(), start + delay);
+
+    start = Time::Now();
+    ASSERT_TRUE(mgr.TimerReset(delay, &controller));
+    EXPECT_GE(controller.deadline(), start + delay);
+    mgr.TimerCancel(&controller);
+  }
+  Clock::set_mode(Clock::kPrecise);
+}
+
+}  // namespace iomgr
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
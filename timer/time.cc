@@ -36,6 +36,15 @@ Time Time::Now() {
   return Time(usec);
 }
 
+Time Time::NowCoarse() {
+  int64_t usec = 0;
+  struct timespec now;
+  if (clock_gettime(CLOCK_MONOTONIC_COARSE, &now) == 0) {
+    usec = now.tv_sec * 1000000 + now.tv_nsec / 1000;
+  }
+  return Time(usec);
+}
+
 WallTime WallTime::Now() {
   uint64_t usec = 0;
   struct timeval now;
@@ -104,6 +104,16 @@ TEST(TimeTest, Infinite) {
   EXPECT_FALSE(Time::Now().IsInfinite());
 }
 
+TEST(TimeTest, NowCoarse) {
+  Time precise = Time::Now();
+  Time coarse = Time::NowCoarse();
+  EXPECT_FALSE(coarse.IsZero());
+  // Both read the same monotonic clock, the coarse one only lags behind by
+  // at most a few ticks.
+  EXPECT_LT(coarse - precise, Time::Delta::FromMilliseconds(100));
+  EXPECT_LT(precise - coarse, Time::Delta::FromMilliseconds(100));
+}
+
 TEST(TimeTest, CopyConstruct) {
   Time time_1 = Time::Zero() + Time::Delta::FromMilliseconds(1234);
   EXPECT_NE(time_1, Time(Time::Zero()));
@@ -2,7 +2,6 @@
 
 #include <glog/logging.h>
 
-#include "threading/task_handle.h"
 #include "timer/timer_manager.h"
 
 namespace iomgr {
@@ -13,8 +12,14 @@ const uint32_t kInvalidIndex = 0xffffffffu;
 Timer::Timer()
     : deadline_(Time::Zero()),
       pending_(false),
+      period_(Time::Delta::Zero()),
+      catch_up_policy_(kSkipMissed),
+      dispatch_(kPostTask),
+      slack_(Time::Delta::Zero()),
+      manager_(nullptr),
       heap_index_(kInvalidIndex),
       closure_(),
+      repeating_closure_(),
       controller_(nullptr) {
   entry_.le_next = nullptr;
   entry_.le_prev = nullptr;
@@ -29,11 +34,54 @@ void Timer::Start(Time::Delta delay, std::function<void()> closure,
   TimerManager::Get()->TimerInit(delay, closure, controller);
 }
 
+void Timer::Start(Time::Delta delay, Closure closure,
+                  Timer::Controller* controller, const Options& options) {
+  DCHECK(controller);
+
+  TimerManager::Get()->TimerInit(delay, Time::Delta::Zero(), options,
+                                 std::move(closure), controller);
+}
+
+void Timer::Start(TimerManager* manager, Time::Delta delay, Closure closure,
+                  Timer::Controller* controller, const Options& options) {
+  DCHECK(manager);
+  DCHECK(controller);
+
+  manager->TimerInit(delay, Time::Delta::Zero(), options, std::move(closure),
+                     controller);
+}
+
+void Timer::StartRepeating(Time::Delta period, Closure closure,
+                           Timer::Controller* controller,
+                           const Options& options) {
+  StartRepeating(TimerManager::Get(), period, std::move(closure), controller,
+                 options);
+}
+
+void Timer::StartRepeating(TimerManager* manager, Time::Delta period,
+                           Closure closure, Timer::Controller* controller,
+                           const Options& options) {
+  DCHECK(manager);
+  DCHECK(controller);
+  DCHECK_GT(period, Time::Delta::Zero());
+  DCHECK(!period.IsInfinite());
+
+  manager->TimerInit(period, period, options, std::move(closure), controller);
+}
+
 /// Timer::Controller
-Timer::Controller::Controller() : timer_(), scheduled_() {}
+Timer::Controller::Controller() : timer_() {}
 
 Timer::Controller::~Controller() = default;
 
-void Timer::Controller::Cancel() { TimerManager::Get()->TimerCancel(this); }
+void Timer::Controller::Cancel() {
+  if (timer_.manager_) {
+    timer_.manager_->TimerCancel(this);
+  }
+}
+
+bool Timer::Controller::Reset(Time::Delta delay) {
+  return timer_.manager_ && timer_.manager_->TimerReset(delay, this);
+}
 
 }  // namespace iomgr
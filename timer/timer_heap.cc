@@ -9,22 +9,22 @@
 namespace iomgr {
 
 bool TimerHeap::Add(Timer* timer) {
-  timer->heap_index_ = timer_count();
-  timers_.push_back(timer);
-  AdjustUpwards(timer->heap_index_);
+  uint32_t i = timer_count();
+  entries_.push_back(Entry{timer->deadline_, timer});
+  AdjustUpwards(i);
   return timer->heap_index_ == 0;
 }
 
 void TimerHeap::Remove(Timer* timer) {
   uint32_t i = timer->heap_index_;
+  DCHECK_LT(i, timer_count());
+  DCHECK_EQ(timer, entries_[i].timer);
   if (i == timer_count() - 1) {
-    timers_.pop_back();
+    entries_.pop_back();
   } else {
-    timers_[i] = timers_[timer_count() - 1];
-    timers_[i]->heap_index_ = i;
-    timers_.pop_back();
-    uint32_t parent = static_cast<uint32_t>((static_cast<int>(i) - 1) / 2);
-    if (timers_[parent]->deadline_ > timers_[i]->deadline_) {
+    Place(i, entries_.back());
+    entries_.pop_back();
+    if (i > 0 && entries_[Parent(i)].deadline > entries_[i].deadline) {
       AdjustUpwards(i);
     } else {
       AdjustDownwards(i);
@@ -33,47 +33,62 @@ void TimerHeap::Remove(Timer* timer) {
   MaybeShrink();
 }
 
-Timer* TimerHeap::Top() { return timers_[0]; }
+Timer* TimerHeap::Top() { return entries_[0].timer; }
 
 void TimerHeap::Pop() { Remove(Top()); }
 
+bool TimerHeap::Update(Timer* timer) {
+  uint32_t i = timer->heap_index_;
+  DCHECK_LT(i, timer_count());
+  DCHECK_EQ(timer, entries_[i].timer);
+  if (timer->deadline_ >= entries_[i].deadline) {
+    return false;
+  }
+  entries_[i].deadline = timer->deadline_;
+  AdjustUpwards(i);
+  return timer->heap_index_ == 0;
+}
+
 void TimerHeap::AdjustUpwards(uint32_t i) {
-  Timer* t = timers_[i];
+  Entry e = entries_[i];
   while (i > 0) {
-    uint32_t parent = static_cast<uint32_t>((static_cast<int>(i) - 1) / 2);
-    if (timers_[parent]->deadline_ <= t->deadline_) {
+    uint32_t parent = Parent(i);
+    if (entries_[parent].deadline <= e.deadline) {
       break;
     }
-    timers_[i] = timers_[parent];
-    timers_[i]->heap_index_ = i;
+    Place(i, entries_[parent]);
     i = parent;
   }
-  timers_[i] = t;
-  t->heap_index_ = i;
+  Place(i, e);
 }
 
 void TimerHeap::AdjustDownwards(uint32_t i) {
-  Timer* t = timers_[i];
+  Entry e = entries_[i];
+  const uint32_t count = timer_count();
   for (;;) {
-    uint32_t left_child = 1u + 2u * i;
-    if (left_child >= timer_count()) {
+    uint32_t first_child = FirstChild(i);
+    if (first_child >= count) {
       break;
     }
-    uint32_t right_child = left_child + 1;
-    uint32_t next_i =
-        right_child < timer_count() &&
-                timers_[left_child]->deadline_ > timers_[right_child]->deadline_
-            ? right_child
-            : left_child;
-    if (t->deadline_ <= timers_[next_i]->deadline_) {
+    uint32_t last_child = std::min(first_child + kArity, count);
+    uint32_t next_i = first_child;
+    for (uint32_t child = first_child + 1; child < last_child; ++child) {
+      if (entries_[child].deadline < entries_[next_i].deadline) {
+        next_i = child;
+      }
+    }
+    if (e.deadline <= entries_[next_i].deadline) {
       break;
     }
-    timers_[i] = timers_[next_i];
-    timers_[i]->heap_index_ = i;
+    Place(i, entries_[next_i]);
     i = next_i;
   }
-  timers_[i] = t;
-  t->heap_index_ = i;
+  Place(i, e);
+}
+
+void TimerHeap::Place(uint32_t i, const Entry& entry) {
+  entries_[i] = entry;
+  entry.timer->heap_index_ = i;
 }
 
 const int kShrinkMinElems = 8;
@@ -81,12 +96,13 @@ const int kShinkFullnessFactor = 2;
 
 void TimerHeap::MaybeShrink() {
   if (timer_count() >= kShrinkMinElems &&
-      timer_count() <= timers_.capacity() / kShinkFullnessFactor / 2) {
-    size_t new_capacity = timer_count() * kShinkFullnessFactor;
-    std::vector<Timer*> tmp(new_capacity);
-    tmp.resize(timer_count());
-    std::copy_n(timers_.begin(), timers_.size(), tmp.begin());
-    std::swap(timers_, tmp);
+      timer_count() <= entries_.capacity() / kShinkFullnessFactor / 2) {
+    // Only the live entries are moved, into storage that is not initialized
+    // beforehand.
+    std::vector<Entry> tmp;
+    tmp.reserve(timer_count() * kShinkFullnessFactor);
+    tmp.assign(entries_.begin(), entries_.end());
+    entries_.swap(tmp);
   }
 }
 
@@ -96,7 +112,7 @@ void TimerHeap::ResetDeadline(Timer* timer, Time deadline) {
 
 bool TimerHeap::Contains(Timer* timer) {
   for (size_t i = 0; i < timer_count(); ++i) {
-    if (timers_[i] == timer) {
+    if (entries_[i].timer == timer) {
       return true;
     }
   }
@@ -105,18 +121,18 @@ bool TimerHeap::Contains(Timer* timer) {
 
 bool TimerHeap::CheckValid() {
   for (size_t i = 0; i < timer_count(); ++i) {
-    size_t left_child = 1u + 2u * i;
-    size_t right_child = left_child + 1;
-    if (left_child < timer_count() &&
-        timers_[i]->deadline_ > timers_[left_child]->deadline_) {
+    if (entries_[i].timer->heap_index_ != i) {
       return false;
     }
-    if (right_child < timer_count() &&
-        timers_[i]->deadline_ > timers_[right_child]->deadline_) {
-      return false;
+    size_t first_child = FirstChild(i);
+    for (size_t child = first_child;
+         child < first_child + kArity && child < timer_count(); ++child) {
+      if (entries_[i].deadline > entries_[child].deadline) {
+        return false;
+      }
     }
   }
   return true;
 }
 
-}  // namespace iomgr
\ No newline at end of file
+}  // namespace iomgr
@@ -9,6 +9,9 @@ namespace iomgr {
 
 class Timer;
 
+// A 4-ary min-heap of timers ordered by deadline. Every entry keeps a copy of
+// the deadline next to the timer pointer, so sifting never dereferences a
+// Timer and the children compared at each step share a cache line.
 class TimerHeap {
  public:
   TimerHeap() = default;
@@ -20,9 +23,16 @@ class TimerHeap {
   bool Add(Timer* timer);
   void Remove(Timer* timer);
   Timer* Top();
+  // The deadline |Top()| was inserted with
+  Time TopDeadline() const { return entries_[0].deadline; }
   void Pop();
-  size_t timer_count() const { return timers_.size(); }
-  bool empty() const { return timers_.empty(); }
+  // Moves |timer| towards the root if its deadline is now earlier than the one
+  // it is queued with. A later deadline is left for the caller to handle when
+  // the timer reaches the top. Return true iff |timer| becomes the first timer
+  // in the heap.
+  bool Update(Timer* timer);
+  size_t timer_count() const { return entries_.size(); }
+  bool empty() const { return entries_.empty(); }
 
   // This is for testing only
   static void ResetDeadline(Timer* timer, Time deadline);
@@ -31,6 +41,16 @@ class TimerHeap {
   bool CheckValid();
 
  private:
+  static const uint32_t kArity = 4;
+
+  struct Entry {
+    Time deadline;
+    Timer* timer;
+  };
+
+  static uint32_t Parent(uint32_t i) { return (i - 1) / kArity; }
+  static uint32_t FirstChild(uint32_t i) { return kArity * i + 1; }
+
   // Adjusts a heap so as to move element at position |i| closer to the root.
   // This functor is called each time immediately after modifying a value in the
   // underlying container, with the offset of the modified element as its
@@ -39,12 +59,14 @@ class TimerHeap {
   // Adjusts a heap so as to move a element at position |i| farther away from
   // the root.
   void AdjustDownwards(uint32_t i);
+  // Stores |entry| at position |i| and updates the heap index of its timer.
+  void Place(uint32_t i, const Entry& entry);
 
   void MaybeShrink();
 
-  std::vector<Timer*> timers_;
+  std::vector<Entry> entries_;
 };
 
 }  // namespace iomgr
 
-#endif  // LIBIOMGR_UTIL_TIMER_HEAP_H_
\ No newline at end of file
+#endif  // LIBIOMGR_UTIL_TIMER_HEAP_H_
@@ -0,0 +1,79 @@
+#include <glog/logging.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "iomgr/timer.h"
+#include "timer/timer_heap.h"
+
+namespace iomgr {
+
+// Measures the cost of the TimerHeap operations used by TimerManager: adding
+// timers, cancelling random timers and popping expired timers in order.
+class TimerHeapBenchmark {
+ public:
+  explicit TimerHeapBenchmark(size_t count)
+      : count_(count), timers_(new TimerWrapper[count]) {
+    Time now = Time::Now();
+    for (size_t i = 0; i < count_; ++i) {
+      timers_[i].timer.deadline_ =
+          now + Time::Delta::FromMicroseconds(rand() % (60 * 1000 * 1000));
+    }
+  }
+
+  void Run() {
+    TimerHeap heap;
+    std::vector<Timer*> cancel_order(count_);
+    for (size_t i = 0; i < count_; ++i) {
+      cancel_order[i] = &timers_[i].timer;
+    }
+    std::random_shuffle(cancel_order.begin(), cancel_order.end());
+
+    Time start = Time::Now();
+    for (size_t i = 0; i < count_; ++i) {
+      heap.Add(&timers_[i].timer);
+    }
+    Report("add", Time::Now() - start, count_);
+
+    size_t cancels = count_ / 2;
+    start = Time::Now();
+    for (size_t i = 0; i < cancels; ++i) {
+      heap.Remove(cancel_order[i]);
+    }
+    Report("cancel", Time::Now() - start, cancels);
+
+    size_t pops = heap.timer_count();
+    start = Time::Now();
+    while (!heap.empty()) {
+      heap.Pop();
+    }
+    Report("pop", Time::Now() - start, pops);
+  }
+
+ private:
+  struct TimerWrapper {
+    Timer timer;
+  };
+
+  void Report(const char* op, Time::Delta elapsed, size_t ops) {
+    printf("%-8zu %-8s %10.1f ns/op\n", count_, op,
+           elapsed.ToMicroseconds() * 1000.0 / std::max<size_t>(ops, 1));
+  }
+
+  size_t count_;
+  std::unique_ptr<TimerWrapper[]> timers_;
+};
+
+}  // namespace iomgr
+
+int main(int argc, char** argv) {
+  srand(0);
+  printf("%-8s %-8s %16s\n", "timers", "op", "cost");
+  for (size_t count = 1000; count <= 1000 * 1000; count *= 10) {
+    iomgr::TimerHeapBenchmark(count).Run();
+  }
+  return 0;
+}
@@ -103,6 +103,29 @@ TEST_F(TimerHeapTest, Remove) {
   }
 }
 
+TEST_F(TimerHeapTest, Update) {
+  TimerHeap heap;
+  CreateTimers(kNumTimers);
+  for (size_t i = 0; i < kNumTimers; ++i) {
+    heap.Add(&timers_[i].timer);
+  }
+
+  for (size_t i = 0; i < kNumTimers; ++i) {
+    Timer* timer = &timers_[i].timer;
+    bool is_first = heap.Top() == timer;
+    Time deadline = timer->deadline();
+    // A later deadline does not move the timer
+    TimerHeap::ResetDeadline(timer,
+                             deadline + Time::Delta::FromMilliseconds(1));
+    EXPECT_FALSE(heap.Update(timer));
+    TimerHeap::ResetDeadline(
+        timer, deadline - Time::Delta::FromMilliseconds(rand() % 1000 + 1));
+    bool expected = is_first || heap.Top()->deadline() > timer->deadline();
+    EXPECT_EQ(expected, heap.Update(timer));
+    EXPECT_TRUE(heap.CheckValid());
+  }
+}
+
 TEST_F(TimerHeapTest, Add_Remove) {
   TimerHeap heap;
   const size_t kOps = 10000;
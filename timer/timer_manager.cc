@@ -3,11 +3,12 @@
 #include <sys/queue.h>
 
 #include <algorithm>
+#include <memory>
 
 #include "io/io_manager.h"
 #include "iomgr/timer.h"
-#include "threading/task_handle.h"
 #include "threading/task_runner.h"
+#include "timer/clock.h"
 #include "util/pointer_hash.h"
 
 #define ADD_DEADLINE_SCALE 0.33
@@ -21,15 +22,15 @@ namespace iomgr {
 
 const uint32_t kInvalidIndex = 0xffffffffu;
 
-TimerManager* TimerManager::Get() {
-  static TimerManager s_timer_manager;
-  IOManager::Get();
+TimerManager* TimerManager::Get() { return IOManager::Get()->timer_manager(); }
 
-  return &s_timer_manager;
-}
+TimerManager::TimerManager() : TimerManager(nullptr) {}
 
-TimerManager::TimerManager()
-    : mutex_(),
+TimerManager::TimerManager(IOManager* io_manager)
+    : io_manager_(io_manager),
+      mutex_(),
+      poll_deadline_us_(Time::Infinite().ToDebuggingValue()),
+      num_kicks_(0),
       shards_(NUM_SHARDS),
       shard_queue_(NUM_SHARDS) {
   for (int i = 0; i < NUM_SHARDS; ++i) {
@@ -45,31 +46,47 @@ TimerManager::~TimerManager() = default;
 
 void TimerManager::TimerInit(Time::Delta timeout, std::function<void()> closure,
                              Timer::Controller* controller) {
+  TimerInit(timeout, Time::Delta::Zero(), Timer::Options(), std::move(closure),
+            controller);
+}
+
+void TimerManager::TimerInit(Time::Delta timeout, Time::Delta period,
+                             const Timer::Options& options, Closure closure,
+                             Timer::Controller* controller) {
   DCHECK(controller);
 
   bool is_first_timer = false;
-  Time deadline = Time::Now() + timeout;
+  // Late rather than early when Now() reads a coarse clock
+  Time deadline =
+      ApplySlack(Now() + timeout + Clock::MaxLag(), options.slack);
   Timer* timer = controller->timer();
-  TimerShard* shard = &shards_[(PointerHash<Timer*>{}(timer)) & SHARD_MASK];
+  TimerShard* shard = GetShard(timer);
   {
     MutexLock lock(&shard->mutex);
     timer->deadline_ = deadline;
     timer->pending_ = true;
-    timer->closure_ = std::move(closure);
-    timer->controller_ = controller;
-    shard->stats.AddSample(static_cast<double>(timeout.ToSeconds()));
-    if (deadline < shard->heap_capacity) {
-      is_first_timer = shard->urgent_timers.Add(timer);
+    timer->period_ = period;
+    timer->catch_up_policy_ = options.catch_up_policy;
+    timer->dispatch_ = options.dispatch;
+    timer->slack_ = options.slack;
+    timer->manager_ = this;
+    if (period.IsZero()) {
+      timer->closure_ = std::move(closure);
+      timer->repeating_closure_.reset();
     } else {
-      timer->heap_index_ = kInvalidIndex;
-      LIST_INSERT_HEAD(&shard->less_urgent_timers, timer, entry_);
+      timer->closure_ = nullptr;
+      timer->repeating_closure_ =
+          std::make_shared<const Closure>(std::move(closure));
     }
+    timer->controller_ = controller;
+    shard->stats.AddSample(static_cast<double>(timeout.ToSeconds()));
+    is_first_timer = AddTimer(shard, timer);
   }
 
-  MutexLock lock(&mutex_);
-  if (is_first_timer && deadline < shard->min_deadline) {
-    shard->min_deadline = deadline;
-    OnDeadlineChanged(shard);
+  // Only a timer that becomes the first of its shard can move the shard in
+  // |shard_queue_| or change the poll deadline.
+  if (is_first_timer) {
+    OnFirstTimerChanged(shard, deadline);
   }
 }
 
@@ -78,7 +95,7 @@ void TimerManager::TimerCancel(Timer::Controller* controller) {
 
   bool is_first_timer = false;
   Timer* timer = controller->timer();
-  TimerShard* shard = &shards_[(PointerHash<Timer*>{}(timer)) & SHARD_MASK];
+  TimerShard* shard = GetShard(timer);
 
   MutexLock lock(&shard->mutex);
   if (!timer->pending()) {
@@ -91,24 +108,160 @@ void TimerManager::TimerCancel(Timer::Controller* controller) {
   } else {
     shard->urgent_timers.Remove(timer);
   }
-  controller->scheduled_.reset();
 }
 
-Time::Delta TimerManager::TimerCheck() {
-  MutexLock lock(&mutex_);
-  Time now = Time::Now();
-  while (shard_queue_[0]->min_deadline <= now) {
-    Time new_min_deadline = Time::Zero();
-    PopTimers(shard_queue_[0], now, &new_min_deadline);
-    shard_queue_[0]->min_deadline = new_min_deadline;
-    OnDeadlineChanged(shard_queue_[0]);
+bool TimerManager::TimerReset(Time::Delta delay,
+                              Timer::Controller* controller) {
+  DCHECK(controller);
+
+  bool is_first_timer = false;
+  Timer* timer = controller->timer();
+  TimerShard* shard = GetShard(timer);
+  Time deadline = ApplySlack(Now() + delay + Clock::MaxLag(), timer->slack_);
+  {
+    MutexLock lock(&shard->mutex);
+    if (!timer->pending()) {
+      return false;
+    }
+    timer->deadline_ = deadline;
+    if (timer->heap_index_ == kInvalidIndex) {
+      // The list is unordered, only a deadline that now falls into the heap
+      // needs to move.
+      if (deadline < shard->heap_capacity) {
+        LIST_REMOVE(timer, entry_);
+        timer->entry_.le_prev = nullptr;
+        is_first_timer = shard->urgent_timers.Add(timer);
+      }
+    } else {
+      // A later deadline is left in the heap as it is, PopOne() requeues the
+      // timer once the old one is reached.
+      is_first_timer = shard->urgent_timers.Update(timer);
+    }
   }
-  Time::Delta timeout = Time::Delta::Inifinite();
-  Time min_deadline = shard_queue_[0]->min_deadline;
-  if (!min_deadline.IsInfinite()) {
-    timeout = min_deadline - now;
+
+  if (is_first_timer) {
+    OnFirstTimerChanged(shard, deadline);
+  }
+  return true;
+}
+
+Time::Delta TimerManager::TimerCheck() { return TimerCheck(Clock::Now()); }
+
+Time::Delta TimerManager::TimerCheck(Time now) {
+  // Fast path: nothing is due, so there is no need to take |mutex_|. A timer
+  // armed concurrently with an earlier deadline wakes the reactor up.
+  Time next_deadline = poll_deadline();
+  if (next_deadline > now) {
+    return next_deadline.IsInfinite() ? Time::Delta::Inifinite()
+                                      : next_deadline - now;
+  }
+
+  ExpiredClosures expired;
+  {
+    MutexLock lock(&mutex_);
+    while (shard_queue_[0]->min_deadline <= now) {
+      Time new_min_deadline = Time::Zero();
+      PopTimers(shard_queue_[0], now, &new_min_deadline, &expired);
+      shard_queue_[0]->min_deadline = new_min_deadline;
+      OnDeadlineChanged(shard_queue_[0]);
+    }
+    set_poll_deadline(shard_queue_[0]->min_deadline);
+  }
+  // Closures may start new timers, so they run without holding any lock.
+  // Timers they start on the poll thread do not wake the reactor up, so the
+  // poll deadline is only read afterwards.
+  RunExpired(&expired);
+  next_deadline = poll_deadline();
+  return next_deadline.IsInfinite() ? Time::Delta::Inifinite()
+                                    : next_deadline - now;
+}
+
+void TimerManager::RunExpired(ExpiredClosures* expired) {
+  if (!expired->posted.empty()) {
+    // std::function must be copyable, so the batch is handed over through a
+    // shared pointer instead of being moved into the task.
+    std::shared_ptr<std::vector<ExpiredClosure>> batch =
+        std::make_shared<std::vector<ExpiredClosure>>(
+            std::move(expired->posted));
+    TaskRunner::Get()->PostTask([batch]() {
+      for (const ExpiredClosure& closure : *batch) {
+        closure.Run();
+      }
+    });
+  }
+  for (const ExpiredClosure& closure : expired->inlined) {
+    closure.Run();
+  }
+}
+
+Time TimerManager::ApplySlack(Time deadline, Time::Delta slack) {
+  if (slack <= Time::Delta::Zero() || deadline.IsInfinite()) {
+    return deadline;
+  }
+  // Use the largest power of two not above |slack| as the bucket width, so
+  // that timers with different slack still share bucket boundaries.
+  int64_t bucket = 1;
+  while (bucket <= slack.ToMicroseconds() / 2) {
+    bucket <<= 1;
+  }
+  int64_t us = deadline.ToDebuggingValue();
+  int64_t rounded = (us + bucket - 1) / bucket * bucket;
+  return deadline + Time::Delta::FromMicroseconds(rounded - us);
+}
+
+Time TimerManager::Now() const {
+  if (io_manager_ && io_manager_->IsOnPollThread()) {
+    return io_manager_->loop_time();
+  }
+  return Clock::Now();
+}
+
+TimerManager::TimerShard* TimerManager::GetShard(Timer* timer) {
+  return &shards_[(PointerHash<Timer*>{}(timer)) & SHARD_MASK];
+}
+
+bool TimerManager::AddTimer(TimerShard* shard, Timer* timer) {
+  if (timer->deadline_ < shard->heap_capacity) {
+    return shard->urgent_timers.Add(timer);
+  }
+  timer->heap_index_ = kInvalidIndex;
+  LIST_INSERT_HEAD(&shard->less_urgent_timers, timer, entry_);
+  return false;
+}
+
+void TimerManager::RescheduleRepeating(TimerShard* shard, Timer* timer,
+                                       Time now) {
+  DCHECK(timer->repeating());
+
+  // Always advance from the previous deadline rather than from |now| so that
+  // scheduling latency does not accumulate.
+  Time next_deadline = timer->deadline_ + timer->period_;
+  if (timer->catch_up_policy_ == Timer::kSkipMissed && next_deadline <= now) {
+    int64_t period_us = timer->period_.ToMicroseconds();
+    int64_t missed = (now - next_deadline).ToMicroseconds() / period_us + 1;
+    next_deadline =
+        next_deadline + Time::Delta::FromMicroseconds(missed * period_us);
+  }
+  timer->deadline_ = next_deadline;
+  timer->pending_ = true;
+  AddTimer(shard, timer);
+}
+
+void TimerManager::OnFirstTimerChanged(TimerShard* shard, Time deadline) {
+  MutexLock lock(&mutex_);
+  if (deadline < shard->min_deadline) {
+    shard->min_deadline = deadline;
+    OnDeadlineChanged(shard);
+    if (deadline < poll_deadline()) {
+      set_poll_deadline(deadline);
+      ++num_kicks_;
+      // The poll thread reads the new poll deadline before it goes back to
+      // sleep, so only other threads have to wake it up.
+      if (io_manager_ && !io_manager_->IsOnPollThread()) {
+        io_manager_->Wakeup();
+      }
+    }
   }
-  return timeout;
 }
 
 void TimerManager::SwapAdjacentShardsInQueue(uint32_t first) {
@@ -130,7 +283,6 @@ void TimerManager::OnDeadlineChanged(TimerShard* shard) {
              shard_queue_[shard->shard_queue_index + 1]->min_deadline) {
     SwapAdjacentShardsInQueue(shard->shard_queue_index);
   }
-  IOManager::Get()->Wakeup();
 }
 
 static double clamp(double val, double min, double max) {
@@ -176,27 +328,51 @@ Timer* TimerManager::PopOne(TimerShard* shard, Time now) {
         return nullptr;
       }
     }
-    Timer* timer = shard->urgent_timers.Top();
-    if (timer->deadline_ > now) {
+    if (shard->urgent_timers.TopDeadline() > now) {
       return nullptr;
     }
-    timer->pending_ = false;
+    Timer* timer = shard->urgent_timers.Top();
     shard->urgent_timers.Pop();
+    if (timer->deadline_ > now) {
+      // Reset to a later deadline since it was queued.
+      AddTimer(shard, timer);
+      continue;
+    }
+    // A repeating timer stays pending until it is cancelled.
+    timer->pending_ = timer->repeating();
     return timer;
   }
 }
 
 size_t TimerManager::PopTimers(TimerShard* shard, Time now,
-                               Time* new_min_deadline) {
+                               Time* new_min_deadline,
+                               ExpiredClosures* expired) {
   size_t n = 0;
   Timer* timer;
+  std::vector<Timer*> repeating;
   MutexLock lock(&shard->mutex);
   while ((timer = PopOne(shard, now))) {
-    timer->controller_->scheduled_.reset();
-    timer->controller_->scheduled_.reset(
-         new TaskHandle(TaskRunner::Get()->PostTask(timer->closure_)));
+    std::vector<ExpiredClosure>* closures =
+        timer->dispatch_ == Timer::kRunInline ? &expired->inlined
+                                              : &expired->posted;
+    if (timer->repeating()) {
+      repeating.push_back(timer);
+      // Only a reference is taken, which keeps the closure alive should the
+      // timer be cancelled and destroyed before this expiry runs.
+      closures->emplace_back(timer->repeating_closure_);
+    } else {
+      // A one-shot timer is no longer pending, so its owner may destroy the
+      // controller as soon as |shard->mutex| is released. Take the closure
+      // out of the timer instead of copying it.
+      closures->emplace_back(std::move(timer->closure_));
+    }
     ++n;
   }
+  // Re-arm repeating timers only after the shard has been drained, otherwise a
+  // timer that is still behind |now| would be popped again in the loop above.
+  for (Timer* timer : repeating) {
+    RescheduleRepeating(shard, timer, now);
+  }
   *new_min_deadline = shard->ComputeMinDeadline();
   return n;
 }
@@ -213,7 +389,7 @@ TimerManager::TimerShard::TimerShard()
 
 Time TimerManager::TimerShard::ComputeMinDeadline() {
   return urgent_timers.empty() ? Time::Infinite()
-                               : urgent_timers.Top()->deadline();
+                               : urgent_timers.TopDeadline();
 }
 
 }  // namespace iomgr
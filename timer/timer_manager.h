@@ -4,6 +4,7 @@
 #include <sys/queue.h>
 
 #include <atomic>
+#include <memory>
 #include <vector>
 
 #include "iomgr/timer.h"
@@ -13,11 +14,21 @@
 
 namespace iomgr {
 
+class IOManager;
+
+// TimerManager keeps the timers of one reactor. Expired timers are collected
+// by TimerCheck(), which the poll thread of |io_manager| calls on every
+// iteration, and arming a timer earlier than the reactor's next wakeup wakes
+// that reactor up, unless it is armed from the poll thread itself.
 class TimerManager {
  public:
+  // The timer manager of the global IOManager, used by timers that are not
+  // bound to any particular reactor.
   static TimerManager* Get();
 
+  // A manager without a reactor, whose TimerCheck() is driven by the caller.
   TimerManager();
+  explicit TimerManager(IOManager* io_manager);
   ~TimerManager();
 
   TimerManager(const TimerManager&) = delete;
@@ -25,9 +36,28 @@ class TimerManager {
 
   void TimerInit(Time::Delta delay, Closure closure,
                  Timer::Controller* controller);
+  // Arms |controller| to expire after |delay|. If |period| is not zero, the
+  // timer is re-armed in place every |period| after it expires.
+  void TimerInit(Time::Delta delay, Time::Delta period,
+                 const Timer::Options& options, Closure closure,
+                 Timer::Controller* controller);
   void TimerCancel(Timer::Controller* controller);
+  // Moves the deadline of the pending timer of |controller| to |delay| from
+  // now. Returns false if the timer is not pending.
+  bool TimerReset(Time::Delta delay, Timer::Controller* controller);
   // return next deadline or Time::Infinite() if there is no timer;
   Time::Delta TimerCheck();
+  // Same as above, with |now| already read by the caller (the reactor passes
+  // its loop time).
+  Time::Delta TimerCheck(Time now);
+
+  // Number of times a new timer expired earlier than the deadline the reactor
+  // was sleeping for.
+  uint64_t num_kicks() const { return num_kicks_.load(); }
+
+  // Rounds |deadline| up to a boundary shared by all deadlines with a
+  // similar |slack|. The result is in [deadline, deadline + slack].
+  static Time ApplySlack(Time deadline, Time::Delta slack);
 
  private:
   friend class TimerManagerTest;
@@ -61,7 +91,51 @@ class TimerManager {
     LIST_HEAD(LessUrgentTimer, Timer) less_urgent_timers;
   };
 
+  // The closure of one expiry. A repeating timer hands out a reference to
+  // its shared closure, a one-shot timer its closure itself.
+  struct ExpiredClosure {
+    explicit ExpiredClosure(Closure closure)
+        : closure(std::move(closure)), shared() {}
+    explicit ExpiredClosure(std::shared_ptr<const Closure> shared)
+        : closure(), shared(std::move(shared)) {}
+
+    void Run() const {
+      if (shared) {
+        (*shared)();
+      } else {
+        closure();
+      }
+    }
+
+    Closure closure;
+    std::shared_ptr<const Closure> shared;
+  };
+
+  // Closures of the timers expired in one TimerCheck().
+  struct ExpiredClosures {
+    std::vector<ExpiredClosure> posted;
+    std::vector<ExpiredClosure> inlined;
+  };
+
+  // The current time for a new deadline: the loop time of the reactor when
+  // called on its poll thread, saving a clock read, Clock::Now() otherwise.
+  Time Now() const;
+  TimerShard* GetShard(Timer* timer);
+  // Adds |timer| to the heap or the list of |shard| depending on its deadline.
+  // Returns true if |timer| becomes the first timer in the heap.
+  // REQUIRES: |shard->mutex| locked.
+  static bool AddTimer(TimerShard* shard, Timer* timer);
+  // Moves the deadline of the repeating |timer| to its next period boundary
+  // according to its catch-up policy and puts it back into |shard|.
+  // REQUIRES: |shard->mutex| locked.
+  static void RescheduleRepeating(TimerShard* shard, Timer* timer, Time now);
+  // Called after |timer| became the first timer of |shard| with |deadline|.
+  // Updates the shard queue and wakes the reactor up if needed.
+  // REQUIRES: |shard->mutex| unlocked.
+  void OnFirstTimerChanged(TimerShard* shard, Time deadline);
   void SwapAdjacentShardsInQueue(uint32_t first);
+  // Moves |shard| to its place in |shard_queue_| after its |min_deadline|
+  // changed. REQUIRES: |mutex_| locked.
   void OnDeadlineChanged(TimerShard* shard);
   // Reblance the timer shard by computing a new |shard->heap_capacity| and
   // moving all relavant timers in |shard->list| (i.e timers with deadlines
@@ -70,13 +144,37 @@ class TimerManager {
   // REQUIRES: |shard->mutex| locked.
   static bool RefillHeap(TimerShard* shard, Time now);
   // Pops the next non-cancelled tiemr with deadline <= |now| from the queue, or
-  // returns NULL if there isn't one. REQUIRES: |shard->mutex| locked
+  // returns NULL if there isn't one. Timers whose deadline was moved later
+  // by TimerReset() are requeued instead. REQUIRES: |shard->mutex| locked
   static Timer* PopOne(TimerShard* shard, Time now);
+  // Pops all timers of |shard| expired at |now| and appends their closures
+  // to |expired|, grouped by where they have to run.
   // REQUIRED: |shard->mutex| unlocked
-  static size_t PopTimers(TimerShard* shard, Time now, Time* new_min_deadline);
-
-  // Protects |shard_queue_| and |min_deadline_|
+  static size_t PopTimers(TimerShard* shard, Time now, Time* new_min_deadline,
+                          ExpiredClosures* expired);
+  // Runs the inline closures of |expired| and posts the others to the
+  // TaskRunner as a single task. REQUIRED: |mutex_| unlocked
+  static void RunExpired(ExpiredClosures* expired);
+
+  Time poll_deadline() const {
+    int64_t us = poll_deadline_us_.load(std::memory_order_acquire);
+    return Time::Zero() + Time::Delta::FromMicroseconds(us);
+  }
+  // REQUIRES: |mutex_| locked.
+  void set_poll_deadline(Time deadline) {
+    poll_deadline_us_.store(deadline.ToDebuggingValue(),
+                            std::memory_order_release);
+  }
+
+  IOManager* const io_manager_;
+  // Protects |shard_queue_| and writes to |poll_deadline_us_|
   Mutex mutex_;
+  // The earliest deadline of all shards, i.e. the deadline the reactor is
+  // sleeping for. Only a timer earlier than this needs to wake it up, and
+  // TimerCheck() reads it without |mutex_| to find out whether anything is
+  // due at all.
+  std::atomic<int64_t> poll_deadline_us_;
+  std::atomic<uint64_t> num_kicks_;
   // Array of timer shards. Whenever a timer is added, its address is hashed to
   // select the timer shard to add the timer to.
   std::vector<TimerShard> shards_;
@@ -4,12 +4,31 @@
 #include <gtest/gtest.h>
 #include <math.h>
 
+#include <atomic>
+
 #include "iomgr/time.h"
 #include "iomgr/timer.h"
 #include "util/notification.h"
 
 namespace iomgr {
 
+class TimerManagerTest : public testing::Test {
+ protected:
+  // Expires the pending timer of |controller| as if TimerCheck() ran at |now|
+  // and returns its next deadline.
+  static Time ExpireAt(TimerManager* mgr, Timer::Controller* controller,
+                       Time now) {
+    mgr->TimerCancel(controller);
+    Timer* timer = controller->timer();
+    TimerManager::TimerShard* shard = mgr->GetShard(timer);
+    MutexLock lock(&shard->mutex);
+    TimerManager::RescheduleRepeating(shard, timer, now);
+    return timer->deadline();
+  }
+
+  static Mutex* mutex(TimerManager* mgr) { return &mgr->mutex_; }
+};
+
 void SimpleClosure() {}
 
 TEST(TimerManager, Ctor) { TimerManager mgr; }
@@ -26,6 +45,218 @@ TEST(TimerManager, TimerInit) {
   EXPECT_FALSE(controller.pending());
 }
 
+TEST_F(TimerManagerTest, RepeatingSkipMissed) {
+  TimerManager mgr;
+  Timer::Controller controller;
+  Time::Delta period = Time::Delta::FromSeconds(10);
+  mgr.TimerInit(period, period, Timer::Options(), std::bind(SimpleClosure),
+                &controller);
+  EXPECT_TRUE(controller.repeating());
+
+  Time first = controller.deadline();
+  // Expired on time
+  EXPECT_EQ(first + period, ExpireAt(&mgr, &controller, first));
+  // Three and a half periods late, the missed expiries are skipped and the
+  // timer stays aligned with its first deadline.
+  Time second = controller.deadline();
+  EXPECT_EQ(second + period * 4,
+            ExpireAt(&mgr, &controller, second + period * 3.5));
+  EXPECT_TRUE(controller.pending());
+  mgr.TimerCancel(&controller);
+  EXPECT_FALSE(controller.pending());
+}
+
+TEST_F(TimerManagerTest, RepeatingFireAll) {
+  TimerManager mgr;
+  Timer::Controller controller;
+  Time::Delta period = Time::Delta::FromSeconds(10);
+  Timer::Options options;
+  options.catch_up_policy = Timer::kFireAll;
+  mgr.TimerInit(period, period, options, std::bind(SimpleClosure),
+                &controller);
+
+  // Every missed period is kept so that the closure runs once for each.
+  Time first = controller.deadline();
+  EXPECT_EQ(first + period,
+            ExpireAt(&mgr, &controller, first + period * 3.5));
+  mgr.TimerCancel(&controller);
+}
+
+// Counts the runs of a closure and how often it was copied
+struct CopyCounter {
+  CopyCounter(int* copies, int* runs) : copies(copies), runs(runs) {}
+  CopyCounter(const CopyCounter& other)
+      : copies(other.copies), runs(other.runs) {
+    ++*copies;
+  }
+
+  void operator()() const { ++*runs; }
+
+  int* copies;
+  int* runs;
+};
+
+TEST(TimerManager, RepeatingClosureNotCopied) {
+  TimerManager mgr;
+  int copies = 0;
+  int runs = 0;
+  Timer::Controller controller;
+  Timer::Options options;
+  options.dispatch = Timer::kRunInline;
+  Time::Delta period = Time::Delta::FromSeconds(1);
+  mgr.TimerInit(period, period, options, CopyCounter(&copies, &runs),
+                &controller);
+  int armed_copies = copies;
+  for (int i = 0; i < 5; ++i) {
+    mgr.TimerCheck(controller.deadline());
+  }
+  EXPECT_EQ(5, runs);
+  // Expiring shares the closure of the timer
+  EXPECT_EQ(armed_copies, copies);
+  mgr.TimerCancel(&controller);
+}
+
+TEST(TimerManager, ApplySlack) {
+  Time now = Time::Now();
+  EXPECT_EQ(now, TimerManager::ApplySlack(now, Time::Delta::Zero()));
+  EXPECT_EQ(Time::Infinite(),
+            TimerManager::ApplySlack(Time::Infinite(),
+                                     Time::Delta::FromSeconds(1)));
+
+  Time::Delta slack = Time::Delta::FromMilliseconds(10);
+  Time first = TimerManager::ApplySlack(now, slack);
+  EXPECT_LE(now, first);
+  EXPECT_LE(first - now, slack);
+  // Deadlines close to each other are coalesced into the same bucket.
+  EXPECT_EQ(first, TimerManager::ApplySlack(
+                       first - Time::Delta::FromMicroseconds(1), slack));
+}
+
+TEST(TimerManager, KickOnlyForEarlierDeadline) {
+  TimerManager mgr;
+  // Nothing armed, the reactor would sleep forever
+  EXPECT_TRUE(mgr.TimerCheck().IsInfinite());
+
+  Timer::Controller first, later, earlier;
+  mgr.TimerInit(Time::Delta::FromSeconds(10), std::bind(SimpleClosure),
+                &first);
+  EXPECT_EQ(1u, mgr.num_kicks());
+  mgr.TimerInit(Time::Delta::FromSeconds(20), std::bind(SimpleClosure),
+                &later);
+  EXPECT_EQ(1u, mgr.num_kicks());
+  mgr.TimerInit(Time::Delta::FromSeconds(5), std::bind(SimpleClosure),
+                &earlier);
+  EXPECT_EQ(2u, mgr.num_kicks());
+
+  mgr.TimerCancel(&first);
+  mgr.TimerCancel(&later);
+  mgr.TimerCancel(&earlier);
+}
+
+void Increment(int* count) { ++*count; }
+
+TEST(TimerManager, RunInline) {
+  TimerManager mgr;
+  int count = 0;
+  Timer::Controller controller;
+  Timer::Options options;
+  options.dispatch = Timer::kRunInline;
+  mgr.TimerInit(Time::Delta::Zero(), Time::Delta::Zero(), options,
+                std::bind(Increment, &count), &controller);
+  mgr.TimerCheck();
+  EXPECT_EQ(1, count);
+  EXPECT_FALSE(controller.pending());
+}
+
+TEST(TimerManager, ResetLater) {
+  TimerManager mgr;
+  int count = 0;
+  Timer::Controller controller;
+  Timer::Options options;
+  options.dispatch = Timer::kRunInline;
+  mgr.TimerInit(Time::Delta::FromSeconds(1), Time::Delta::Zero(), options,
+                std::bind(Increment, &count), &controller);
+  Time old_deadline = controller.deadline();
+  EXPECT_TRUE(mgr.TimerReset(Time::Delta::FromSeconds(10), &controller));
+  Time new_deadline = controller.deadline();
+  EXPECT_GE(new_deadline, old_deadline + Time::Delta::FromSeconds(9));
+
+  // The old deadline only requeues the timer
+  Time::Delta timeout = mgr.TimerCheck(old_deadline);
+  EXPECT_EQ(0, count);
+  EXPECT_TRUE(controller.pending());
+  EXPECT_EQ(new_deadline - old_deadline, timeout);
+
+  mgr.TimerCheck(new_deadline);
+  EXPECT_EQ(1, count);
+  EXPECT_FALSE(controller.pending());
+}
+
+TEST(TimerManager, ResetEarlier) {
+  TimerManager mgr;
+  int count = 0;
+  Timer::Controller controller;
+  Timer::Options options;
+  options.dispatch = Timer::kRunInline;
+  mgr.TimerInit(Time::Delta::FromSeconds(10), Time::Delta::Zero(), options,
+                std::bind(Increment, &count), &controller);
+  EXPECT_TRUE(mgr.TimerReset(Time::Delta::FromSeconds(1), &controller));
+  Time deadline = controller.deadline();
+  // The reactor now sleeps until the earlier deadline only
+  Time now = Time::Now();
+  EXPECT_EQ(deadline - now, mgr.TimerCheck(now));
+
+  mgr.TimerCheck(deadline);
+  EXPECT_EQ(1, count);
+  EXPECT_FALSE(controller.pending());
+}
+
+TEST(TimerManager, ResetNotPending) {
+  TimerManager mgr;
+  Timer::Controller controller;
+  EXPECT_FALSE(mgr.TimerReset(Time::Delta::FromSeconds(1), &controller));
+  EXPECT_FALSE(controller.pending());
+}
+
+void CountAndNotify(std::atomic<int>* count, int expected,
+                    Notification* notification);
+
+TEST(TimerManager, PostExpiredInOneBatch) {
+  static const int kNumTimers = 100;
+  static std::atomic<int> count(0);
+  static Notification notification;
+  TimerManager mgr;
+  Timer::Controller controllers[kNumTimers];
+  for (int i = 0; i < kNumTimers; ++i) {
+    mgr.TimerInit(Time::Delta::Zero(),
+                  std::bind(CountAndNotify, &count, kNumTimers, &notification),
+                  &controllers[i]);
+  }
+  mgr.TimerCheck();
+  for (int i = 0; i < kNumTimers; ++i) {
+    EXPECT_FALSE(controllers[i].pending());
+  }
+  notification.WaitForNotification();
+  EXPECT_EQ(kNumTimers, count.load());
+}
+
+TEST_F(TimerManagerTest, CheckWithoutLockWhenNothingDue) {
+  TimerManager mgr;
+  Timer::Controller controller;
+  Time now = Time::Now();
+  mgr.TimerInit(Time::Delta::FromSeconds(10), std::bind(SimpleClosure),
+                &controller);
+  {
+    // TimerCheck() must not need the lock (it would deadlock here) as long
+    // as no timer is due.
+    MutexLock lock(mutex(&mgr));
+    Time::Delta timeout = mgr.TimerCheck(now);
+    EXPECT_GE(timeout, Time::Delta::FromSeconds(10));
+    EXPECT_LT(timeout, Time::Delta::FromSeconds(11));
+  }
+  mgr.TimerCancel(&controller);
+}
+
 TEST(TimerController, Ctor) {
   Timer::Controller controller;
   EXPECT_FALSE(controller.pending());
@@ -49,6 +280,29 @@ TEST(Timer, Start) {
   notification.WaitForNotification();
 }
 
+void CountAndNotify(std::atomic<int>* count, int expected,
+                    Notification* notification) {
+  if (++*count == expected) {
+    notification->Notify();
+  }
+}
+
+TEST(Timer, StartRepeating) {
+  // An expiry that was already posted may still run after Cancel(), so keep
+  // the state alive beyond the test body.
+  static std::atomic<int> count(0);
+  static Notification notification;
+  Timer::Controller controller;
+  Timer::StartRepeating(Time::Delta::FromMilliseconds(10),
+                        std::bind(CountAndNotify, &count, 3, &notification),
+                        &controller);
+  notification.WaitForNotification();
+  EXPECT_TRUE(controller.pending());
+  controller.Cancel();
+  EXPECT_FALSE(controller.pending());
+  EXPECT_GE(count.load(), 3);
+}
+
 }  // namespace iomgr
 
 int main(int argc, char** argv) {
@@ -58,6 +58,22 @@ Status FileOp::pipe(int fds[2], bool non_blocking) {
   return Status();
 }
 
+StatusOr<int> FileOp::get_pipe_size(int fd) {
+  int size = ::fcntl(fd, F_GETPIPE_SZ);
+  if (size == -1) {
+    return StatusOr<int>(MapSystemError(errno));
+  }
+  return StatusOr<int>(size);
+}
+
+StatusOr<int> FileOp::set_pipe_size(int fd, int size) {
+  int set = ::fcntl(fd, F_SETPIPE_SZ, size);
+  if (set == -1) {
+    return StatusOr<int>(MapSystemError(errno));
+  }
+  return StatusOr<int>(set);
+}
+
 Status FileOp::set_non_blocking(int fd) {
   const int flags = fcntl(fd, F_GETFL);
   if (flags == -1) {
@@ -103,6 +119,32 @@ StatusOr<int> FileOp::write(int fd, const void* buf, size_t count) {
   return StatusOr<int>(wrote);
 }
 
+StatusOr<int> FileOp::readv(int fd, const struct iovec* iov, int iovcnt) {
+  int read = TEMP_FAILURE_RETRY(::readv(fd, iov, iovcnt));
+  if (read == -1) {
+    return StatusOr<int>(MapSystemError(errno));
+  }
+  return StatusOr<int>(read);
+}
+
+StatusOr<int> FileOp::writev(int fd, const struct iovec* iov, int iovcnt) {
+  int wrote = TEMP_FAILURE_RETRY(::writev(fd, iov, iovcnt));
+  if (wrote == -1) {
+    return StatusOr<int>(MapSystemError(errno));
+  }
+  return StatusOr<int>(wrote);
+}
+
+StatusOr<int> FileOp::splice(int in_fd, int out_fd, size_t count) {
+  ssize_t moved = TEMP_FAILURE_RETRY(::splice(
+      in_fd, nullptr, out_fd, nullptr, count,
+      SPLICE_F_MOVE | SPLICE_F_NONBLOCK));
+  if (moved == -1) {
+    return StatusOr<int>(MapSystemError(errno));
+  }
+  return StatusOr<int>(static_cast<int>(moved));
+}
+
 Status FileOp::close(int fd) {
   DCHECK_NE(-1, fd);
   if (TEMP_FAILURE_RETRY(::close(fd)) == -1) {
@@ -1,6 +1,8 @@
 #ifndef LIBIOMGR_UTIL_FILE_OP_H_
 #define LIBIOMGR_UTIL_FILE_OP_H_
 
+#include <sys/uio.h>
+
 #include "iomgr/status.h"
 #include "iomgr/statusor.h"
 
@@ -13,10 +15,20 @@ class FileOp {
   static Status eventfd_write(int fd, uint64_t value);
   static StatusOr<int> epoll();
   static Status pipe(int fds[2], bool non_blocking);
+  // Capacity of the pipe |fd| in bytes. The kernel rounds |size| up to a
+  // power-of-two number of pages, and returns the capacity set.
+  static StatusOr<int> get_pipe_size(int fd);
+  static StatusOr<int> set_pipe_size(int fd, int size);
   static Status set_non_blocking(int fd);
   static Status set_close_exec(int fd);
   static StatusOr<int> read(int fd, void* buf, size_t count);
   static StatusOr<int> write(int fd, const void* buf, size_t count);
+  static StatusOr<int> readv(int fd, const struct iovec* iov, int iovcnt);
+  static StatusOr<int> writev(int fd, const struct iovec* iov, int iovcnt);
+  // Moves up to |count| bytes from |in_fd| to |out_fd| within the kernel,
+  // one of which must be a pipe. Page references are moved instead of the
+  // bytes where possible. Does not block on the pipe.
+  static StatusOr<int> splice(int in_fd, int out_fd, size_t count);
   static Status close(int fd);
 };
 
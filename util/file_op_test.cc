@@ -27,6 +27,70 @@ TEST(FileOpTest, Pipe) {
   EXPECT_EQ(0, ::close(fds[1]));
 }
 
+TEST(FileOpTest, ReadvWritev) {
+  int fds[2];
+  CHECK(FileOp::pipe(fds, true).ok());
+
+  std::string hello = "hello ";
+  std::string world = "world";
+  struct iovec wiov[2] = {{&hello[0], hello.size()}, {&world[0], world.size()}};
+  StatusOr<int> wrote = FileOp::writev(fds[1], wiov, 2);
+  EXPECT_TRUE(wrote.ok());
+  EXPECT_EQ(11, wrote.value());
+
+  std::string first(4, 0);
+  std::string second(100, 0);
+  struct iovec riov[2] = {{&first[0], first.size()},
+                          {&second[0], second.size()}};
+  StatusOr<int> read = FileOp::readv(fds[0], riov, 2);
+  EXPECT_TRUE(read.ok());
+  EXPECT_EQ(11, read.value());
+  EXPECT_EQ("hell", first);
+  second.resize(7);
+  EXPECT_EQ("o world", second);
+
+  read = FileOp::readv(fds[0], riov, 2);
+  EXPECT_TRUE(read.status().IsTryAgain());
+
+  EXPECT_EQ(0, ::close(fds[0]));
+  EXPECT_EQ(0, ::close(fds[1]));
+}
+
+TEST(FileOpTest, Splice) {
+  int in[2];
+  int out[2];
+  CHECK(FileOp::pipe(in, true).ok());
+  CHECK(FileOp::pipe(out, true).ok());
+
+  StatusOr<int> size = FileOp::set_pipe_size(in[1], 1 << 20);
+  EXPECT_TRUE(size.ok());
+  EXPECT_LE(1 << 20, size.value());
+  size = FileOp::get_pipe_size(in[0]);
+  EXPECT_TRUE(size.ok());
+  EXPECT_LE(1 << 20, size.value());
+
+  const std::string testw = "hello world";
+  EXPECT_TRUE(FileOp::write(in[1], testw.data(), testw.size()).ok());
+  StatusOr<int> moved = FileOp::splice(in[0], out[1], 5);
+  EXPECT_TRUE(moved.ok());
+  EXPECT_EQ(5, moved.value());
+
+  std::string testr(100, 0);
+  StatusOr<int> read = FileOp::read(out[0], &testr[0], testr.size());
+  EXPECT_TRUE(read.ok());
+  EXPECT_EQ(5, read.value());
+  testr.resize(5);
+  EXPECT_EQ("hello", testr);
+
+  // Nothing left to move once the source is drained
+  EXPECT_TRUE(FileOp::splice(in[0], out[1], 100).ok());
+  EXPECT_TRUE(FileOp::splice(in[0], out[1], 100).status().IsTryAgain());
+
+  for (int fd : {in[0], in[1], out[0], out[1]}) {
+    EXPECT_EQ(0, ::close(fd));
+  }
+}
+
 TEST(FileOpTest, Eventfd) {
   StatusOr<int> eventfd = FileOp::eventfd(0, true);
   EXPECT_TRUE(eventfd.ok());
@@ -55,6 +55,26 @@ Status MapSocketAcceptError(int os_errno) {
   }
 }
 
+Status MapSocketWriteError(int os_errno) {
+  switch (os_errno) {
+    // A TCP Fast Open write that started the handshake without a cookie
+    case EINPROGRESS:
+      return Status::TryAgain("IO pending", strerror(os_errno));
+    default:
+      return MapSystemError(os_errno);
+  }
+}
+
+Status MapSocketZeroCopyError(int os_errno) {
+  switch (os_errno) {
+    // Out of option memory to track the completions
+    case ENOBUFS:
+      return Status::OutOfMemory("Zero copy limit", strerror(os_errno));
+    default:
+      return MapSocketWriteError(os_errno);
+  }
+}
+
 Status MapSocketConnectError(int os_errno) {
   switch (os_errno) {
     case EINPROGRESS:
@@ -11,6 +11,10 @@ Status MapSocketAcceptError(int os_errno);
 
 Status MapSocketConnectError(int os_errno);
 
+Status MapSocketWriteError(int os_errno);
+
+Status MapSocketZeroCopyError(int os_errno);
+
 }  // namespace iomgr
 
 #endif  // LIBIOMGR_UTIL_OS_ERROR_H_
\ No newline at end of file
@@ -0,0 +1,40 @@
+#include "util/os_error.h"
+
+#include <errno.h>
+#include <gtest/gtest.h>
+
+namespace iomgr {
+
+TEST(OSError, WouldBlock) {
+  EXPECT_TRUE(MapSystemError(EAGAIN).IsTryAgain());
+  EXPECT_TRUE(MapSocketWriteError(EAGAIN).IsTryAgain());
+}
+
+// Only connect() and writes that start a TCP Fast Open handshake wait for
+// EINPROGRESS to pass
+TEST(OSError, InProgress) {
+  EXPECT_FALSE(MapSystemError(EINPROGRESS).IsTryAgain());
+  EXPECT_TRUE(MapSocketConnectError(EINPROGRESS).IsTryAgain());
+  EXPECT_TRUE(MapSocketWriteError(EINPROGRESS).IsTryAgain());
+}
+
+TEST(OSError, WriteErrors) {
+  EXPECT_TRUE(MapSocketWriteError(ECONNRESET).IsIOError());
+  EXPECT_TRUE(MapSocketWriteError(EINVAL).IsInvalidArg());
+  EXPECT_TRUE(MapSocketWriteError(ENOBUFS).IsIOError());
+}
+
+// A zero-copy write out of option memory falls back to copying
+TEST(OSError, ZeroCopyErrors) {
+  EXPECT_TRUE(MapSocketZeroCopyError(ENOBUFS).IsOutOfMemory());
+  EXPECT_TRUE(MapSocketZeroCopyError(EAGAIN).IsTryAgain());
+  EXPECT_TRUE(MapSocketZeroCopyError(EINPROGRESS).IsTryAgain());
+  EXPECT_TRUE(MapSocketZeroCopyError(ECONNRESET).IsIOError());
+}
+
+}  // namespace iomgr
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -115,6 +115,18 @@ class CheckRefCountedNULL : public RefCounted<CheckRefCountedNULL> {
   RefPtr<CheckRefCountedNULL>* ptr_{nullptr};
 };
 
+class ThreadUnsafe : public RefCountedThreadUnsafe<ThreadUnsafe> {
+ public:
+  explicit ThreadUnsafe(bool* destroyed) : destroyed_(destroyed) {}
+
+ private:
+  friend class RefCountedThreadUnsafe<ThreadUnsafe>;
+
+  ~ThreadUnsafe() { *destroyed_ = true; }
+
+  bool* destroyed_;
+};
+
 TEST(RefCountedTest, TestSelfAssignment) {
   SelfAssign* p = new SelfAssign;
   RefPtr<SelfAssign> var(p);
@@ -429,6 +441,49 @@ TEST(RefCountedTest, CheckAutoRefptrNullBeforeObjectDestruction) {
   EXPECT_EQ(obj.get(), nullptr);
 }
 
+TEST(RefCountedTest, HasAtLeastOneRefDoesNotAddRef) {
+  RefPtr<Other> obj = MakeRefCounted<Other>();
+  EXPECT_TRUE(obj->HasAtLeastOneRef());
+  EXPECT_TRUE(obj->HasAtLeastOneRef());
+  EXPECT_TRUE(obj->HasOneRef());
+}
+
+TEST(RefCountedTest, AdoptRef) {
+  RefPtr<Other> obj = AdoptRef(new Other);
+  EXPECT_TRUE(obj->HasOneRef());
+  RefPtr<Other> copy = obj;
+  EXPECT_FALSE(obj->HasOneRef());
+  copy = nullptr;
+  EXPECT_TRUE(obj->HasOneRef());
+
+  EXPECT_EQ(nullptr, AdoptRef<Other>(nullptr).get());
+}
+
+TEST(RefCountedTest, MakeRefCountedWithRefToSelf) {
+  RefCountedPtrToSelf::reset_was_destroyed();
+  RefPtr<RefCountedPtrToSelf> obj = MakeRefCounted<RefCountedPtrToSelf>();
+  // Held by |obj| and by itself
+  EXPECT_FALSE(obj->HasOneRef());
+  obj->self_ptr_ = nullptr;
+  EXPECT_TRUE(obj->HasOneRef());
+  obj = nullptr;
+  EXPECT_TRUE(RefCountedPtrToSelf::was_destroyed());
+}
+
+TEST(RefCountedTest, ThreadUnsafe) {
+  bool destroyed = false;
+  RefPtr<ThreadUnsafe> obj = MakeRefCounted<ThreadUnsafe>(&destroyed);
+  EXPECT_TRUE(obj->HasOneRef());
+  {
+    RefPtr<ThreadUnsafe> copy = obj;
+    EXPECT_FALSE(obj->HasOneRef());
+    EXPECT_TRUE(copy->HasAtLeastOneRef());
+  }
+  EXPECT_TRUE(obj->HasOneRef());
+  obj = nullptr;
+  EXPECT_TRUE(destroyed);
+}
+
 }  // namespace iomgr
 
 int main(int argc, char** argv) {
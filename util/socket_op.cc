@@ -1,7 +1,13 @@
 #include "util/socket_op.h"
 
+#include <glog/logging.h>
+#include <linux/filter.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
+#include <netinet/udp.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <unistd.h>
 
 #include "util/os_error.h"
 
@@ -45,6 +51,15 @@ StatusOr<int> SocketOp::accept(int fd, sockaddr* addr, socklen_t* addrlen) {
   return StatusOr<int>(accepted_fd);
 }
 
+StatusOr<int> SocketOp::accept4(int fd, sockaddr* addr, socklen_t* addrlen) {
+  int accepted_fd = TEMP_FAILURE_RETRY(
+      ::accept4(fd, addr, addrlen, SOCK_NONBLOCK | SOCK_CLOEXEC));
+  if (accepted_fd == -1) {
+    return StatusOr<int>(MapSocketAcceptError(errno));
+  }
+  return StatusOr<int>(accepted_fd);
+}
+
 StatusOr<int> SocketOp::recv(int fd, void* buf, size_t count, int flags) {
   int ret = TEMP_FAILURE_RETRY(::recv(fd, buf, count, flags));
   if (ret == -1) {
@@ -53,6 +68,84 @@ StatusOr<int> SocketOp::recv(int fd, void* buf, size_t count, int flags) {
   return StatusOr<int>(ret);
 }
 
+StatusOr<int> SocketOp::recvmsg(int fd, struct msghdr* msg, int flags) {
+  int ret = TEMP_FAILURE_RETRY(::recvmsg(fd, msg, flags));
+  if (ret == -1) {
+    return StatusOr<int>(MapSystemError(errno));
+  }
+  return StatusOr<int>(ret);
+}
+
+StatusOr<int> SocketOp::send(int fd, const void* buf, size_t count,
+                             int flags) {
+  int ret = TEMP_FAILURE_RETRY(::send(fd, buf, count, flags));
+  if (ret == -1) {
+    return StatusOr<int>(MapSocketWriteError(errno));
+  }
+  return StatusOr<int>(ret);
+}
+
+StatusOr<int> SocketOp::sendmsg(int fd, const struct msghdr* msg, int flags) {
+  int ret = TEMP_FAILURE_RETRY(::sendmsg(fd, msg, flags));
+  if (ret == -1) {
+    return StatusOr<int>(MapSocketWriteError(errno));
+  }
+  return StatusOr<int>(ret);
+}
+
+StatusOr<int> SocketOp::sendmsg_zerocopy(int fd, const struct msghdr* msg) {
+  int ret = TEMP_FAILURE_RETRY(::sendmsg(fd, msg, MSG_ZEROCOPY));
+  if (ret == -1) {
+    return StatusOr<int>(MapSocketZeroCopyError(errno));
+  }
+  return StatusOr<int>(ret);
+}
+
+StatusOr<int> SocketOp::writev(int fd, const struct iovec* iov, int iovcnt) {
+  int ret = TEMP_FAILURE_RETRY(::writev(fd, iov, iovcnt));
+  if (ret == -1) {
+    return StatusOr<int>(MapSocketWriteError(errno));
+  }
+  return StatusOr<int>(ret);
+}
+
+StatusOr<int> SocketOp::sendfile(int out_fd, int in_fd, uint64_t* offset,
+                                 size_t count) {
+  off_t off = static_cast<off_t>(*offset);
+  ssize_t sent = TEMP_FAILURE_RETRY(::sendfile(out_fd, in_fd, &off, count));
+  if (sent == -1) {
+    return StatusOr<int>(MapSocketWriteError(errno));
+  }
+  *offset = static_cast<uint64_t>(off);
+  return StatusOr<int>(static_cast<int>(sent));
+}
+
+StatusOr<int> SocketOp::recvmmsg(int fd, struct mmsghdr* msgvec,
+                                 unsigned int vlen, int flags) {
+  int ret = TEMP_FAILURE_RETRY(::recvmmsg(fd, msgvec, vlen, flags, nullptr));
+  if (ret == -1) {
+    return StatusOr<int>(MapSystemError(errno));
+  }
+  return StatusOr<int>(ret);
+}
+
+StatusOr<int> SocketOp::sendmmsg(int fd, struct mmsghdr* msgvec,
+                                 unsigned int vlen, int flags) {
+  int ret = TEMP_FAILURE_RETRY(::sendmmsg(fd, msgvec, vlen, flags));
+  if (ret == -1) {
+    return StatusOr<int>(MapSystemError(errno));
+  }
+  return StatusOr<int>(ret);
+}
+
+StatusOr<int> SocketOp::bytes_available(int fd) {
+  int bytes = 0;
+  if (::ioctl(fd, FIONREAD, &bytes) == -1) {
+    return StatusOr<int>(MapSystemError(errno));
+  }
+  return StatusOr<int>(bytes);
+}
+
 Status SocketOp::shutdown(int fd, int how) {
   if (::shutdown(fd, how) == -1) {
     return MapSystemError(errno);
@@ -82,6 +175,55 @@ Status SocketOp::set_nodelay(int fd, bool enable) {
   return Status();
 }
 
+Status SocketOp::set_fast_open(int fd, int queue_length) {
+  if (::setsockopt(fd, IPPROTO_TCP, TCP_FASTOPEN, &queue_length,
+                   sizeof(queue_length)) == -1) {
+    return MapSystemError(errno);
+  }
+  return Status();
+}
+
+Status SocketOp::set_defer_accept(int fd, int seconds) {
+  if (::setsockopt(fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, &seconds,
+                   sizeof(seconds)) == -1) {
+    return MapSystemError(errno);
+  }
+  return Status();
+}
+
+Status SocketOp::set_fast_open_connect(int fd, bool enable) {
+  int on = enable ? 1 : 0;
+  if (::setsockopt(fd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, &on, sizeof(on)) ==
+      -1) {
+    return MapSystemError(errno);
+  }
+  return Status();
+}
+
+Status SocketOp::get_tcp_info(int fd, struct tcp_info* info) {
+  socklen_t len = sizeof(*info);
+  if (::getsockopt(fd, IPPROTO_TCP, TCP_INFO, info, &len) == -1) {
+    return MapSystemError(errno);
+  }
+  return Status();
+}
+
+Status SocketOp::set_zerocopy(int fd, bool enable) {
+  int on = enable ? 1 : 0;
+  if (::setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &on, sizeof(on)) == -1) {
+    return MapSystemError(errno);
+  }
+  return Status();
+}
+
+Status SocketOp::set_udp_gro(int fd, bool enable) {
+  int on = enable ? 1 : 0;
+  if (::setsockopt(fd, SOL_UDP, UDP_GRO, &on, sizeof(on)) == -1) {
+    return MapSystemError(errno);
+  }
+  return Status();
+}
+
 Status SocketOp::set_reuse_addr(int fd, bool enable) {
   int on = enable ? 1 : 0;
   if (::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) == -1) {
@@ -90,6 +232,34 @@ Status SocketOp::set_reuse_addr(int fd, bool enable) {
   return Status();
 }
 
+Status SocketOp::set_reuse_port(int fd, bool enable) {
+  int on = enable ? 1 : 0;
+  if (::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) == -1) {
+    return MapSystemError(errno);
+  }
+  return Status();
+}
+
+Status SocketOp::attach_reuse_port_cpu_filter(int fd, unsigned int sockets) {
+  DCHECK_LT(0u, sockets);
+  struct sock_filter code[] = {
+      // A = the CPU processing the packet
+      {BPF_LD | BPF_W | BPF_ABS, 0, 0,
+       static_cast<__u32>(SKF_AD_OFF + SKF_AD_CPU)},
+      {BPF_ALU | BPF_MOD | BPF_K, 0, 0, sockets},
+      // Index of the socket in the group
+      {BPF_RET | BPF_A, 0, 0, 0},
+  };
+  struct sock_fprog program;
+  program.len = sizeof(code) / sizeof(code[0]);
+  program.filter = code;
+  if (::setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &program,
+                   sizeof(program)) == -1) {
+    return MapSystemError(errno);
+  }
+  return Status();
+}
+
 Status SocketOp::set_keep_alive(int fd, bool enable, int delay) {
   int on = enable ? 1 : 0;
   if (::setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on)) == -1) {
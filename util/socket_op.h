@@ -1,7 +1,9 @@
 #ifndef LIBIOMGR_UTIL_SOCKET_OP_H_
 #define LIBIOMGR_UTIL_SOCKET_OP_H_
 
+#include <netinet/tcp.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 
 #include "iomgr/status.h"
 #include "iomgr/statusor.h"
@@ -15,15 +17,58 @@ class SocketOp {
   static Status connect(int fd, const struct sockaddr* addr, socklen_t addrlen);
   static Status listen(int fd, int backlog);
   static StatusOr<int> accept(int fd, sockaddr* addr, socklen_t* addrlen);
+  // accept() with SOCK_NONBLOCK and SOCK_CLOEXEC set on the new socket
+  static StatusOr<int> accept4(int fd, sockaddr* addr, socklen_t* addrlen);
   static StatusOr<int> recv(int fd, void *buf, size_t count, int flags);
+  static StatusOr<int> recvmsg(int fd, struct msghdr* msg, int flags);
+  // Writes to a connected socket. A write that starts the handshake of TCP
+  // Fast Open returns TryAgain, like connect().
+  static StatusOr<int> send(int fd, const void* buf, size_t count, int flags);
+  static StatusOr<int> sendmsg(int fd, const struct msghdr* msg, int flags);
+  static StatusOr<int> writev(int fd, const struct iovec* iov, int iovcnt);
+  // sendmsg() with MSG_ZEROCOPY. Returns OutOfMemory when the socket has too
+  // many pages pinned already, where a copying write still succeeds.
+  static StatusOr<int> sendmsg_zerocopy(int fd, const struct msghdr* msg);
+  // Copies up to |count| bytes of |in_fd| from |*offset| to the socket
+  // |out_fd| within the kernel, and advances |*offset|. The file position is
+  // left alone.
+  static StatusOr<int> sendfile(int out_fd, int in_fd, uint64_t* offset,
+                                size_t count);
+  // Batches of up to |vlen| messages in one call. Each returns the number of
+  // messages done, and sets their msg_len.
+  static StatusOr<int> recvmmsg(int fd, struct mmsghdr* msgvec,
+                                unsigned int vlen, int flags);
+  static StatusOr<int> sendmmsg(int fd, struct mmsghdr* msgvec,
+                                unsigned int vlen, int flags);
+  // Number of bytes queued for reading, from ioctl(FIONREAD)
+  static StatusOr<int> bytes_available(int fd);
   static Status shutdown(int fd, int how);
   static Status get_local_name(int fd, sockaddr* addr, socklen_t* addrlen);
   static Status get_peer_name(int fd, sockaddr* addr, socklen_t* addrlen);
   static Status set_nodelay(int fd, bool enable);
   static Status set_reuse_addr(int fd, bool enable);
+  static Status set_reuse_port(int fd, bool enable);
+  // Attaches a classic BPF program to the SO_REUSEPORT group of |fd| that
+  // hands a connection to the socket whose index in the group is the CPU
+  // that received it, modulo |sockets|.
+  static Status attach_reuse_port_cpu_filter(int fd, unsigned int sockets);
   static Status set_keep_alive(int fd, bool enable, int delay);
   static Status set_receive_buffer_size(int fd, int size);
   static Status set_send_buffer_size(int fd, int size);
+  // Server side TCP Fast Open, with up to |queue_length| pending requests
+  static Status set_fast_open(int fd, int queue_length);
+  // Wakes the listener only once a connection has data, or after about
+  // |seconds| of waiting for it (TCP_DEFER_ACCEPT). Zero turns it off.
+  static Status set_defer_accept(int fd, int seconds);
+  // Client side TCP Fast Open: connect() returns at once and the first
+  // write carries its data in the SYN
+  static Status set_fast_open_connect(int fd, bool enable);
+  static Status get_tcp_info(int fd, struct tcp_info* info);
+  // Allows sendmsg() with MSG_ZEROCOPY
+  static Status set_zerocopy(int fd, bool enable);
+  // Lets the kernel hand over datagrams of one flow coalesced into a single
+  // read (UDP_GRO), with their size in a UDP_GRO control message
+  static Status set_udp_gro(int fd, bool enable);
 };
 
 }  // namespace iomgr